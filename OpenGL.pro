@@ -1,25 +1,57 @@
-QT       += core gui opengl
-LIBS     += -lopengl32
-LIBS     += -lglu32
+QT       += core gui opengl concurrent network
+win32:LIBS += -lopengl32 -lglu32
+unix:LIBS  += -lGL -lGLU
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++11
+CONFIG += c++2a
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    cli.cpp \
     cube.cpp \
+    cubebatch.cpp \
+    cubedraw.cpp \
+    cubegrid.cpp \
+    framestats.cpp \
     main.cpp \
     mainwindow.cpp \
-    oglwidget.cpp
+    movearchive.cpp \
+    notation.cpp \
+    offscreen.cpp \
+    oglwidget.cpp \
+    renderer.cpp \
+    renderthread.cpp \
+    scrambler.cpp \
+    server.cpp \
+    solutioncache.cpp \
+    solver.cpp \
+    statebuffer.cpp \
+    transposition.cpp
 
 HEADERS += \
+    algorithm.h \
+    cli.h \
     cube.h \
+    cubebatch.h \
+    cubegrid.h \
+    framestats.h \
     mainwindow.h \
-    oglwidget.h
+    movearchive.h \
+    notation.h \
+    offscreen.h \
+    oglwidget.h \
+    renderer.h \
+    renderthread.h \
+    scrambler.h \
+    server.h \
+    solutioncache.h \
+    solver.h \
+    statebuffer.h \
+    transposition.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
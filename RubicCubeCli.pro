@@ -0,0 +1,35 @@
+# Headless build of the command line (--solve, --batch, --serve, --table-bench) for the Linux workers: no widgets and
+# no OpenGL, so it needs neither a display nor the GL libraries. --render is only in the application (OpenGL.pro).
+
+TEMPLATE  = app
+TARGET    = RubicCubeCli
+CONFIG   += console c++2a
+CONFIG   -= app_bundle
+QT       += core gui concurrent network
+DEFINES  += CLI_ONLY
+
+SOURCES += \
+    cli.cpp \
+    cube.cpp \
+    cubebatch.cpp \
+    main.cpp \
+    movearchive.cpp \
+    notation.cpp \
+    scrambler.cpp \
+    server.cpp \
+    solutioncache.cpp \
+    solver.cpp \
+    transposition.cpp
+
+HEADERS += \
+    algorithm.h \
+    cli.h \
+    cube.h \
+    cubebatch.h \
+    movearchive.h \
+    notation.h \
+    scrambler.h \
+    server.h \
+    solutioncache.h \
+    solver.h \
+    transposition.h
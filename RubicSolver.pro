@@ -0,0 +1,29 @@
+# Shared library with the C interface of the solver (solverapi.h) for programs in other languages.
+# Only the solver is built: the cube reports to a view (TCubeView) instead of the widget and its GL drawing is in
+# cubedraw.cpp of the application, so the library needs neither the widgets nor OpenGL.
+
+TEMPLATE  = lib
+TARGET    = rubicsolver
+CONFIG   += shared c++2a
+QT       += core gui concurrent
+
+SOURCES += \
+    cube.cpp \
+    cubebatch.cpp \
+    notation.cpp \
+    scrambler.cpp \
+    solutioncache.cpp \
+    solver.cpp \
+    solverapi.cpp \
+    transposition.cpp
+
+HEADERS += \
+    algorithm.h \
+    cube.h \
+    cubebatch.h \
+    notation.h \
+    scrambler.h \
+    solutioncache.h \
+    solver.h \
+    solverapi.h \
+    transposition.h
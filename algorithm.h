@@ -0,0 +1,146 @@
+#ifndef ALGORITHM_H
+#define ALGORITHM_H
+
+#include "cube.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#define ALG_MAX_MOVES            32                                             // the longest algorithm which can be written as a literal
+#define FACELETS                 (6*cube_size*cube_size)                        // number of the visible sides of all pieces of the cube
+
+void invalidAlgorithmNotation(void);                                            // not defined: calling it stops the compilation of a wrong literal
+
+//---------------------------------------------------------------------------
+// The facelet is a visible side of a piece. Its index is side*cube_size*cube_size + a*cube_size + b, where (a,b) is
+// the position of the piece on the side: (y,z) on the right and left side, (x,z) on the top and bottom side, (x,y) on the
+// front and back side. For rotating, the facelet is written as a point with doubled coordinates, centred in the middle
+// of the cube: the pieces are at -(cube_size-1)..(cube_size-1) and the coordinate of the side is -cube_size or cube_size
+//---------------------------------------------------------------------------
+constexpr void faceletToPoint(int nFacelet, int* v)
+{
+    int nSide = nFacelet / (cube_size*cube_size);
+    int nAxis = nSide / 2;                                                      // the sides are ordered in pairs: x, y, z axis
+    int a = 2*((nFacelet / cube_size) % cube_size) - (cube_size-1);
+    int b = 2*(nFacelet % cube_size) - (cube_size-1);
+
+    v[nAxis] = (nSide & 1) ? -cube_size : cube_size;
+    v[nAxis == 0 ? 1 : 0] = a;
+    v[nAxis == 2 ? 1 : 2] = b;
+}
+
+//---------------------------------------------------------------------------
+constexpr int faceletFromPoint(const int* v)
+{
+    int nAxis = (v[0] == cube_size || v[0] == -cube_size) ? 0 : ((v[1] == cube_size || v[1] == -cube_size) ? 1 : 2);
+    int nSide = 2*nAxis + (v[nAxis] < 0 ? 1 : 0);
+    int a = (v[nAxis == 0 ? 1 : 0] + cube_size-1) / 2;
+    int b = (v[nAxis == 2 ? 1 : 2] + cube_size-1) / 2;
+
+    return (nSide*cube_size + a)*cube_size + b;
+}
+
+//---------------------------------------------------------------------------
+// Permutation of the facelets: after it the facelet i has the color which the facelet m_nFrom[i] had before
+//---------------------------------------------------------------------------
+class TFaceletPermutation {
+public:
+    unsigned short m_nFrom[FACELETS];
+
+    constexpr TFaceletPermutation() : m_nFrom()
+    {
+        for (int i=0; i<FACELETS; i++) m_nFrom[i] = i;
+    }
+
+    constexpr TFaceletPermutation(ROTATIONS nMove) : m_nFrom()                  // permutation of a single move, the same as makeMove()
+    {
+        const int nAxes[] = { 0, 0, 2, 2, 1, 1 };                               // R L F B D U: rotated axis (x, y, z), section
+        const int nSections[] = { cube_size-1, 0, cube_size-1, 0, 0, cube_size-1 };    // and direction of the section rotation,
+        const bool bClockwise[] = { false, true, false, true, true, false };    // the same as in the RotateR ... RotateU macros
+        int nAxis = nAxes[nMove/2], nSection = nSections[nMove/2];
+        bool bCW = bClockwise[nMove/2] != ((nMove & 1) != 0);                   // the counterclockwise move rotates the other way
+        int i = (nAxis + 1) % 3, j = (nAxis + 2) % 3;
+        int v[3] = { 0, 0, 0 };
+
+        for (int nFacelet=0; nFacelet<FACELETS; nFacelet++) {
+            faceletToPoint(nFacelet, v);
+            int nPos = v[nAxis] > cube_size-1 ? cube_size-1 : (v[nAxis] < -(cube_size-1) ? -(cube_size-1) : v[nAxis]);
+            if ((nPos + cube_size-1) / 2 == nSection) {                         // the facelet is in the rotated section
+                int t = v[i];
+                if (bCW) { v[i] = -v[j]; v[j] = t; }                            // the same direction as rotate?Section(nSection, TRUE)
+                else     { v[i] = v[j]; v[j] = -t; }
+            }
+            m_nFrom[faceletFromPoint(v)] = nFacelet;
+        }
+    }
+
+    constexpr TFaceletPermutation then(const TFaceletPermutation& next) const  // this permutation followed by the next one
+    {
+        TFaceletPermutation result;
+        for (int i=0; i<FACELETS; i++) result.m_nFrom[i] = m_nFrom[next.m_nFrom[i]];
+        return result;
+    }
+};
+
+//---------------------------------------------------------------------------
+// Fixed algorithm written in the usual notation, e.g. "F L D L' D' F'"_alg. The literal is parsed during the compilation
+// and keeps both the list of moves (a half turn "F2" is two quarter turns, because the queue has only quarter turns)
+// and the net permutation of the facelets, so the whole algorithm can be applied to a cube at once
+//---------------------------------------------------------------------------
+class TAlgorithm {
+public:
+    ROTATIONS m_nMoves[ALG_MAX_MOVES];
+    int m_nLength;
+    TFaceletPermutation m_Permutation;
+
+    constexpr TAlgorithm() : m_nMoves(), m_nLength(0), m_Permutation()         // empty algorithm
+    {
+    }
+
+    consteval TAlgorithm(const char* pNotation, size_t nSize) : m_nMoves(), m_nLength(0), m_Permutation()
+    {
+        size_t i = 0;
+
+        while (i < nSize) {
+            int nMove = 0;
+            switch (pNotation[i++]) {
+            case ' ' : continue;
+            case 'R' : nMove = ROT_R; break;
+            case 'L' : nMove = ROT_L; break;
+            case 'F' : nMove = ROT_F; break;
+            case 'B' : nMove = ROT_B; break;
+            case 'D' : nMove = ROT_D; break;
+            case 'U' : nMove = ROT_U; break;
+            default  : invalidAlgorithmNotation();
+            }
+            int nTurns = 1;
+            if (i < nSize && pNotation[i] == '\'') { nMove++; i++; }
+            else if (i < nSize && pNotation[i] == '2') { nTurns = 2; i++; }
+            while (nTurns--) {
+                if (m_nLength == ALG_MAX_MOVES) invalidAlgorithmNotation();
+                m_nMoves[m_nLength++] = (ROTATIONS)nMove;
+                m_Permutation = m_Permutation.then(TFaceletPermutation((ROTATIONS)nMove));
+            }
+        }
+    }
+
+    constexpr int length(void) const                    { return m_nLength; };
+    constexpr const ROTATIONS* begin(void) const        { return m_nMoves; };
+    constexpr const ROTATIONS* end(void) const          { return m_nMoves + m_nLength; };
+};
+
+consteval TAlgorithm operator""_alg(const char* pNotation, size_t nSize)
+{
+    return TAlgorithm(pNotation, nSize);
+}
+
+//---------------------------------------------------------------------------
+inline QVector<ROTATIONS>& operator+=(QVector<ROTATIONS>& moves, const TAlgorithm& alg)   // the moves are appended in one copy
+{
+    int nLength = moves.length();
+    moves.resize(nLength + alg.length());
+    std::copy(alg.begin(), alg.end(), moves.begin() + nLength);
+    return moves;
+}
+
+#endif // ALGORITHM_H
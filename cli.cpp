@@ -0,0 +1,322 @@
+#include "cli.h"
+#include "movearchive.h"
+#include "notation.h"
+#include "server.h"
+#include "solutioncache.h"
+#ifndef CLI_ONLY
+#include "offscreen.h"                                                          // --render, only in the application with OpenGL
+#endif
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+//---------------------------------------------------------------------------
+TCommandLine::TCommandLine()
+{
+    m_nStrategy = STRATEGY_COLOUR_NEUTRAL;
+    m_nThreads = 0;
+    m_nPort = 0;
+    m_nTableBench = 0;
+    m_FramesOutput = "frames";
+    m_nTurnDuration = DEFAULT_TURN_DURATION;
+#ifndef CLI_ONLY
+    m_nFrameWidth = DEFAULT_FRAME_WIDTH;
+    m_nFrameHeight = DEFAULT_FRAME_HEIGHT;
+    m_nFrameRate = DEFAULT_FRAME_RATE;
+#else
+    m_nFrameWidth = 0;
+    m_nFrameHeight = 0;
+    m_nFrameRate = 0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+// Checked before any application object is created, so the GUI is not started at all in the headless mode
+//---------------------------------------------------------------------------
+bool TCommandLine::isRequested(int argc, char* argv[])
+{
+    for (int i=1; i<argc; i++) {
+        if (!strcmp(argv[i], "--solve") || !strcmp(argv[i], "--batch") || !strcmp(argv[i], "--serve") ||
+            !strcmp(argv[i], "--port") || !strcmp(argv[i], "--table-bench") || !strcmp(argv[i], "--help")) return true;
+    }
+    return isRenderRequested(argc, argv);
+}
+
+//---------------------------------------------------------------------------
+bool TCommandLine::isRenderRequested(int argc, char* argv[])
+{
+    for (int i=1; i<argc; i++) {
+        if (!strcmp(argv[i], "--render")) return true;
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------
+int TCommandLine::usage(const QString& error)
+{
+    if (!error.isEmpty()) fprintf(stderr, "%s\n", error.toLocal8Bit().constData());
+    fprintf(stderr, "Usage: RubicCube --solve \"<scramble>\" [--strategy lbl|colour-neutral|pre-moves]\n"
+                    "       RubicCube --batch <file>|- [--strategy lbl|colour-neutral|pre-moves] [--threads <n>] [--archive <file>]\n"
+                    "       RubicCube --serve <socket name> | --port <n> [--strategy lbl|colour-neutral|pre-moves] [--threads <n>]\n"
+                    "       any of them with --cache <file>: the solutions of repeated states are taken from the file\n"
+                    "       RubicCube --table-bench <max threads>\n"
+                    "       RubicCube --render \"<scramble>\" [--frames <directory>|<file.rgba>|-] [--size <w>x<h>] [--turn-ms <n>] [--fps <n>]\n"
+                    "The results are written to the standard output, one JSON object per line.\n");
+    return error.isEmpty() ? 0 : 2;
+}
+
+//---------------------------------------------------------------------------
+int TCommandLine::run(const QStringList& arguments)
+{
+    static const char* strategies[] = { "lbl", "colour-neutral", "pre-moves" };      // the order of SOLVERSTRATEGY
+    int i, j;
+
+    for (i=1; i<arguments.length(); i++) {
+        const QString& option = arguments.at(i);
+        if (option == "--help") return usage("");
+        if (i+1 == arguments.length()) return usage(QString("Missing value of %1").arg(option));
+        const QString& value = arguments.at(++i);
+        if (option == "--solve") m_Scramble = value;
+        else if (option == "--batch") m_BatchFile = value;
+        else if (option == "--archive") m_ArchiveFile = value;
+        else if (option == "--cache") m_CacheFile = value;
+        else if (option == "--serve") m_ServerName = value;
+        else if (option == "--port") {
+            bool bOk;
+            m_nPort = value.toInt(&bOk);
+            if (!bOk || m_nPort <= 0 || m_nPort > 0xFFFF) return usage(QString("Wrong port: %1").arg(value));
+        }
+        else if (option == "--table-bench") {
+            bool bOk;
+            m_nTableBench = value.toInt(&bOk);
+            if (!bOk || m_nTableBench <= 0) return usage(QString("Wrong number of threads: %1").arg(value));
+        }
+        else if (option == "--render") m_RenderScramble = value;
+        else if (option == "--frames") m_FramesOutput = value;
+        else if (option == "--size") {
+            QStringList size = value.split('x');
+            bool bOk = size.length() == 2;
+            if (bOk) m_nFrameWidth = size.at(0).toInt(&bOk);
+            if (bOk) m_nFrameHeight = size.at(1).toInt(&bOk);
+            if (!bOk || m_nFrameWidth <= 0 || m_nFrameHeight <= 0) return usage(QString("Wrong frame size: %1").arg(value));
+        }
+        else if (option == "--turn-ms") {
+            bool bOk;
+            m_nTurnDuration = value.toInt(&bOk);
+            if (!bOk || m_nTurnDuration < 0) return usage(QString("Wrong turn duration: %1").arg(value));
+        }
+        else if (option == "--fps") {
+            bool bOk;
+            m_nFrameRate = value.toInt(&bOk);
+            if (!bOk || m_nFrameRate <= 0) return usage(QString("Wrong frame rate: %1").arg(value));
+        }
+        else if (option == "--threads") {
+            bool bOk;
+            m_nThreads = value.toInt(&bOk);
+            if (!bOk || m_nThreads < 0) return usage(QString("Wrong number of threads: %1").arg(value));
+        }
+        else if (option == "--strategy") {
+            for (j=0; j<STRATEGIES && value != strategies[j]; j++);
+            if (j == STRATEGIES) return usage(QString("Unknown strategy: %1").arg(value));
+            m_nStrategy = (SOLVERSTRATEGY)j;
+        }
+        else return usage(QString("Unknown option: %1").arg(option));
+    }
+
+    if (m_nTableBench) {                                                        // scaling of the transposition table
+        fputs(TTranspositionTable::benchmark(m_nTableBench).toLocal8Bit().constData(), stdout);
+        return 0;
+    }
+    if (m_ServerName.isEmpty() && !m_nPort && m_BatchFile.isEmpty() && m_Scramble.isEmpty() && m_RenderScramble.isEmpty()) return usage("Nothing to solve");
+
+    TSolutionCache cache;                                                       // used by all solving below
+    if (!m_CacheFile.isEmpty()) {
+        if (!cache.open(m_CacheFile)) return usage(QString("Cannot open the cache %1").arg(m_CacheFile));
+        TBatchSolver::setCache(&cache);
+    }
+    int nResult;
+    if (!m_ServerName.isEmpty() || m_nPort) nResult = runServer();
+    else if (!m_BatchFile.isEmpty()) nResult = runBatch();
+    else if (!m_RenderScramble.isEmpty()) nResult = runRender();
+    else nResult = runSolve();
+    TBatchSolver::setCache(NULL);
+    return nResult;
+}
+
+//---------------------------------------------------------------------------
+// The cube is created without a widget: nothing is drawn or animated, the moves are only made on the pieces
+//---------------------------------------------------------------------------
+TCliResult TCommandLine::solveScramble(std::string_view scramble) const
+{
+    TCliResult result;
+    QElapsedTimer timer;
+    TCube cube(NULL);
+
+    result.scramble = scramble;
+    result.bValid = TNotation::apply(scramble, cube);                           // parsed into a buffer on the stack, nothing is allocated
+    if (!result.bValid) return result;
+
+    timer.start();
+    result.bSolved = TBatchSolver::solveCube(m_nStrategy, cube, result.solution);
+    result.nTime = timer.nsecsElapsed() / 1000;
+
+    if (result.bSolved) {                                                       // the solution is verified before it is written
+        for (int i=0; i<result.solution.length(); i++) cube.makeMove(result.solution.at(i), FALSE);
+        result.bSolved = cube.check();
+    }
+    if (!result.bSolved) result.solution.clear();
+    return result;
+}
+
+//---------------------------------------------------------------------------
+QByteArray TCommandLine::resultToJson(const TCliResult& result)
+{
+    QJsonObject object;
+
+    object["scramble"] = QString::fromUtf8(result.scramble.data(), (int)result.scramble.size());
+    if (!result.bValid) {
+        object["error"] = QString("invalid notation");
+    }
+    else {
+        object["solved"] = result.bSolved;
+        object["moves"] = result.solution.length();
+        object["solution"] = movesToString(result.solution);
+        object["time_us"] = result.nTime;
+    }
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+//---------------------------------------------------------------------------
+void TCommandLine::writeLine(const QByteArray& line)                            // the line is flushed at once, so the results stream
+{
+    fwrite(line.constData(), 1, line.size(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+//---------------------------------------------------------------------------
+int TCommandLine::runSolve(void) const
+{
+    QByteArray text = m_Scramble.toUtf8();
+    TCliResult result = solveScramble(std::string_view(text.constData(), text.size()));
+
+    writeLine(resultToJson(result));
+    if (!result.bValid) return 2;
+    return result.bSolved ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
+// One scramble per line, empty lines and lines starting with '#' are skipped. The file is mapped and the scrambles
+// are read in place. They are solved in parallel, but the results are written in the order of the file, each as soon
+// as it and all before it are ready. The last line is a summary of the whole batch
+//---------------------------------------------------------------------------
+int TCommandLine::runBatch(void) const
+{
+    TScrambleFile file;
+    QByteArray input;                                                           // the standard input cannot be mapped
+    std::string_view text;
+    QVector<std::string_view> scrambles;
+    QElapsedTimer timer;
+    int i, nSolved = 0, nInvalid = 0;
+
+    if (m_BatchFile == "-") {
+        QFile in;
+        in.open(stdin, QIODevice::ReadOnly);
+        input = in.readAll();
+        text = std::string_view(input.constData(), input.size());
+    }
+    else {
+        if (!file.open(m_BatchFile)) return usage(QString("Cannot open %1").arg(m_BatchFile));
+        text = file.data();
+    }
+    TScrambleFile::split(text, scrambles);
+
+    TMoveArchiveWriter archive;                                                 // one record for each scramble, empty if not solved
+    if (!m_ArchiveFile.isEmpty() && !archive.open(m_ArchiveFile)) return usage(QString("Cannot create %1").arg(m_ArchiveFile));
+
+    timer.start();
+    if (m_nThreads > 0) QThreadPool::globalInstance()->setMaxThreadCount(m_nThreads);
+    std::function<TCliResult(const std::string_view&)> solve = [this](const std::string_view& scramble) { return solveScramble(scramble); };
+    QFuture<TCliResult> results = QtConcurrent::mapped(scrambles, solve);
+
+    for (i=0; i<scrambles.length(); i++) {
+        TCliResult result = results.resultAt(i);                                // waits only for this scramble
+        if (!result.bValid) nInvalid++;
+        else if (result.bSolved) nSolved++;
+        writeLine(resultToJson(result));
+        if (!m_ArchiveFile.isEmpty()) archive.append(result.solution);
+    }
+    if (!m_ArchiveFile.isEmpty() && !archive.close()) fprintf(stderr, "Cannot write %s\n", m_ArchiveFile.toLocal8Bit().constData());
+
+    double fWallTime = timer.nsecsElapsed() / 1e6;
+    QJsonObject summary;
+    summary["cubes"] = scrambles.length();
+    summary["solved"] = nSolved;
+    summary["invalid"] = nInvalid;
+    summary["threads"] = QThreadPool::globalInstance()->maxThreadCount();
+    summary["wall_ms"] = fWallTime;
+    summary["solves_per_s"] = nSolved * 1000.0 / qMax(fWallTime, 1e-3);
+    if (TBatchSolver::cache()) summary["cache_hits"] = TBatchSolver::cache()->hits();
+    writeLine(QJsonDocument(summary).toJson(QJsonDocument::Compact));
+
+    return nSolved == scrambles.length() ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
+// The server runs until the process is stopped; the event loop of the application serves all clients
+//---------------------------------------------------------------------------
+int TCommandLine::runServer(void) const
+{
+    TSolveServer server(m_nStrategy, m_nThreads);
+
+    if (!m_ServerName.isEmpty() && !server.listenLocal(m_ServerName)) return usage(QString("Cannot listen on %1").arg(m_ServerName));
+    if (m_nPort && !server.listenTcp(m_nPort)) return usage(QString("Cannot listen on port %1").arg(m_nPort));
+    fprintf(stderr, "Serving%s%s%s%s\n", m_ServerName.isEmpty() ? "" : " on ", m_ServerName.toLocal8Bit().constData(),
+            m_nPort ? " on localhost:" : "", m_nPort ? QByteArray::number(m_nPort).constData() : "");
+    return QCoreApplication::exec();
+}
+
+//---------------------------------------------------------------------------
+// The scrambled cube and its solution are played in frames; the summary goes to the standard error when the raw
+// frames are written to the standard output. The headless build (RubicCubeCli.pro) has no OpenGL to render with
+//---------------------------------------------------------------------------
+int TCommandLine::runRender(void) const
+{
+#ifdef CLI_ONLY
+    return usage("--render needs the application built with OpenGL (OpenGL.pro)");
+#else
+    QByteArray text = m_RenderScramble.toUtf8();
+    TCliResult result = solveScramble(std::string_view(text.constData(), text.size()));
+    TOffscreenRenderer renderer(m_nFrameWidth, m_nFrameHeight, m_nTurnDuration, m_nFrameRate);
+    TCube cube(NULL);
+
+    if (!result.bValid) return usage(QString("Invalid scramble: %1").arg(m_RenderScramble));
+    TNotation::apply(std::string_view(text.constData(), text.size()), cube);
+    if (!renderer.open(m_FramesOutput)) return usage(renderer.error());
+    bool bOk = renderer.play(cube, result.solution);
+    renderer.close();
+
+    QJsonObject summary;
+    summary["scramble"] = m_RenderScramble;
+    summary["solved"] = result.bSolved;
+    summary["moves"] = result.solution.length();
+    summary["frames"] = renderer.frames();
+    summary["width"] = m_nFrameWidth;
+    summary["height"] = m_nFrameHeight;
+    summary["frames_per_s"] = renderer.framesPerSecond();
+    summary["frame_stats"] = renderer.frameStats().toJson();
+    if (!bOk) summary["error"] = renderer.error();
+    QByteArray line = QJsonDocument(summary).toJson(QJsonDocument::Compact);
+    if (m_FramesOutput == "-") fprintf(stderr, "%s\n", line.constData());
+    else writeLine(line);
+    return bOk && result.bSolved ? 0 : 1;
+#endif
+}
@@ -0,0 +1,65 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <QStringList>
+#include <string_view>
+#include "cube.h"
+#include "solver.h"
+
+class TCliResult {
+public:
+    std::string_view scramble;                                                  // view of the command line or of the mapped file
+    bool bValid;                                                                // the scramble was written in the correct notation
+    bool bSolved;                                                               // solved and verified
+    QVector<ROTATIONS> solution;
+    qint64 nTime;                                                               // [us]
+    TCliResult()                                        { bValid=false; bSolved=false; nTime=0; };
+};
+
+//---------------------------------------------------------------------------
+// Headless mode: the scrambles given on the command line or in a file are solved without creating any window or GL
+// context (the cubes have no widget), and every result is written to the standard output as one JSON line (NDJSON)
+//
+//   RubicCube --solve "<scramble>" [--strategy lbl|colour-neutral|pre-moves]
+//   RubicCube --batch <file>|- [--strategy ...] [--threads <n>] [--archive <file>]
+//   RubicCube --serve <socket name> | --port <n> [--strategy ...] [--threads <n>]
+//   any of them with --cache <file>
+//   RubicCube --table-bench <max threads>
+//   RubicCube --render "<scramble>" [--frames <directory>|<file.rgba>|-] [--size <w>x<h>] [--turn-ms <n>] [--fps <n>]
+//
+// Only --render needs a GL context; it is made on an offscreen surface, so no window is opened either
+//---------------------------------------------------------------------------
+class TCommandLine {
+protected:
+    SOLVERSTRATEGY m_nStrategy;
+    int m_nThreads;                                                             // 0 - all cores
+    QString m_Scramble;
+    QString m_BatchFile;                                                        // "-" - the standard input
+    QString m_ArchiveFile;                                                      // binary archive of the batch solutions
+    QString m_CacheFile;                                                        // persistent cache of the solutions
+    QString m_ServerName;                                                       // local socket of the solving server
+    int m_nPort;                                                                // localhost TCP port of the solving server, 0 - none
+    int m_nTableBench;                                                          // threads of the table benchmark, 0 - none
+    QString m_RenderScramble;                                                   // its solution is rendered offscreen
+    QString m_FramesOutput;
+    int m_nFrameWidth, m_nFrameHeight;
+    int m_nTurnDuration;                                                        // [ms] of the rendered turns
+    int m_nFrameRate;
+
+    TCliResult solveScramble(std::string_view scramble) const;
+    int runSolve(void) const;
+    int runBatch(void) const;
+    int runServer(void) const;
+    int runRender(void) const;
+    static void writeLine(const QByteArray& line);
+    static QByteArray resultToJson(const TCliResult& result);
+    static int usage(const QString& error);
+
+public:
+    TCommandLine();
+    int run(const QStringList& arguments);                                      // returns the exit code of the program
+    static bool isRequested(int argc, char* argv[]);                            // any of the headless options is given
+    static bool isRenderRequested(int argc, char* argv[]);                      // the offscreen rendering is given
+};
+
+#endif // CLI_H
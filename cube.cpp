@@ -1,18 +1,17 @@
 #include "cube.h"
-#include "oglwidget.h"
+#include "algorithm.h"
+#include "scrambler.h"
+#include "notation.h"
 
-#include <QtOpenGL>
-#include <GL/GLU.h>
 #include <QtGlobal>
 #include <QThread>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QDateTime>
 #include <algorithm>
 #include <cfloat>
 
-float g_fMinMouseLength = 0.5f;                                                 // the minimum length of the mouse displacement vector needed to rotate the cube section
-float g_fMaxMouseAngle = 135.0f;                                                // how close the mouse's displacement vector must be to the cube to rotate the cube
-UINT  g_nRotationSteps = 150;                                                   // number of animation frames at 90 degrees ankle rotation
-
-inline float toDegs(float fRadians)     { return fRadians*360/(2*M_PI); };
+float g_fMinMouseLength = 0.5f;                                                 // [px] the minimum length of the mouse displacement vector needed to rotate the cube section
 
 //---------------------------------------------------------------------------
 QString cubeSideToString(SIDE s)
@@ -30,137 +29,101 @@ QString cubeSideToString(SIDE s)
 }
 
 //---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-//---------------------------------------------------------------------------
-float Vec2DDot(QVector2D& v1, QVector2D& v2)
+QString cubeColorToString(SIDECOLOR c)
 {
-    return v1.x()*v2.x() + v1.y()*v2.y();
-}
+    switch (c) {
+    case RED    : return "RED";
+    case GREEN  : return "GREEN";
+    case BLUE   : return "BLUE";
+    case PURPLE : return "PURPLE";
+    case ORANGE : return "ORANGE";
+    case YELLOW : return "YELLOW";
+    case BLACK  : return "BLACK";
+    case WHITE  : return "WHITE";
+    }
 
-//---------------------------------------------------------------------------
-float Vec2DAngle(QVector2D& v1, QVector2D& v2)                                  // Get angle in degrees between unit vectors v1 and v2
-{
-    float d;
-    d = Vec2DDot(v1,v2);
-    if (d<-1.0f || d>1.0f) return 0.0/0.0;                                      // return NaN
-    return toDegs((float)acos(d));
+    return "";
 }
 
 //---------------------------------------------------------------------------
-// Checking which side of the line a given point is located
-// The function returns: 1 if the point is on the right, 0 if the point is on the line, -1 if the point is on the left
-//---------------------------------------------------------------------------
-int lineTest(const PT2D& ptLineStart, const PT2D& ptLineEnd, const int ptX, const int ptY)
+SIDE moveSide(ROTATIONS nMove)                                                  // side of the cube turned by the move
 {
-    double dx = ptLineEnd.x - ptLineStart.x;
-    double dy = ptLineEnd.y - ptLineStart.y;
-    if (fabs(dx)>fabs(dy)) {
-        double yOnline = dy/dx * (ptX - ptLineStart.x) + ptLineStart.y;
-        return ptY >  yOnline ? 1 : (ptY < yOnline ? -1 : 0);
-    }
-    else {
-        double xOnline = dx/dy * (ptY - ptLineStart.y) + ptLineStart.x;
-        return ptX >  xOnline ? 1 : (ptX < xOnline ? -1 : 0);
-    }
+    static const SIDE sides[] = { SD_RIGHT, SD_LEFT, SD_FRONT, SD_BACK, SD_BOTTOM, SD_TOP };
+    return sides[nMove/2];                                                      // the moves are ordered in pairs: clockwise, counterclockwise
 }
 
 //---------------------------------------------------------------------------
-// The function checks whether the given point fits into the given quadrilateral
-//---------------------------------------------------------------------------
-bool poly4InsideTest(const PT2D* ptCorners, const int ptX, const int ptY)
+ROTATIONS sideMove(SIDE side, bool bCCW)                                        // move turning the given side of the cube
 {
-    int nResult1, nResult2;
-    nResult1 = lineTest(ptCorners[0], ptCorners[1], ptX, ptY);
-    nResult2 = lineTest(ptCorners[2], ptCorners[3], ptX, ptY);
-    if (((nResult1 > 0) && (nResult2 > 0)) || ((nResult1 < 0) && (nResult2 < 0))) return FALSE;
-    nResult1 = lineTest(ptCorners[0], ptCorners[3], ptX, ptY);
-    nResult2 = lineTest(ptCorners[1], ptCorners[2], ptX, ptY);
-    if (((nResult1 > 0) && (nResult2 > 0)) || ((nResult1 < 0) && (nResult2 < 0))) return FALSE;
-    return TRUE;
+    static const ROTATIONS moves[] = { ROT_R, ROT_L, ROT_U, ROT_D, ROT_F, ROT_B };
+    return (ROTATIONS)(moves[side] + (bCCW ? 1 : 0));
 }
 
 //---------------------------------------------------------------------------
-// The function checks whether the given point is located in the given quadrilateral (in this case, the z coordinate is ignored)
+// Reading the moves written in the usual notation at run time (see TNotation, also wide turns, slices and rotations)
 //---------------------------------------------------------------------------
-BOOL poly4InsideTest(PT3D* pt3Corners, const int ptX, const int ptY)
+bool parseMoves(const QString& notation, QVector<ROTATIONS>& moves)
 {
-    PT2D pt2Corners[4];
-    for (int i=0; i<4; i++) pt2Corners[i] = pt3Corners[i];
-    return poly4InsideTest(pt2Corners, ptX, ptY);
-}
+    QByteArray text = notation.toLatin1();
 
-//---------------------------------------------------------------------------
-// The function checks in which section of the cube on the X axis the given point is located
-//---------------------------------------------------------------------------
-UINT8 getXsection(PT2D* ptCorners, const int ptX, const int ptY)
-{
-    int i, rc[cube_size];
-    double dx, dy;
-    PT2D ptLineStart, ptLineEnd;
-    dx = (ptCorners[1].x - ptCorners[0].x)/cube_size;                           // divide the given segment into the number of sections
-    dy = (ptCorners[1].y - ptCorners[0].y)/cube_size;
-    //Now that we know point isn't in the center strip, test a line down the center
-    ptLineStart.x = ptCorners[0].x;                                             // we calculate the first section
-    ptLineStart.y = ptCorners[0].y;
-    ptLineEnd.x   = ptCorners[3].x;
-    ptLineEnd.y   = ptCorners[3].y;
-    for (i=0; i<cube_size; i++) {
-        rc[i] = lineTest(ptLineStart, ptLineEnd, ptX, ptY);                     // perform a point position test for all received segments
-        ptLineStart.x += dx;                                                    // we calculate the next section
-        ptLineStart.y += dy;
-        ptLineEnd.x   += dx;
-        ptLineEnd.y   += dy;
-    }
-    for (i=0; i<cube_size; i++) if (rc[i]==0) return i;                         // we check whether the point was located on one of the segments
-    for (i=0; i<cube_size-1; i++) if (rc[i]!=rc[i+1]) return i;                 // we check whether the point lies between some segments by checking the signs
-    return cube_size-1;
+    return TNotation::parse(std::string_view(text.constData(), text.size()), moves);
 }
 
 //---------------------------------------------------------------------------
-// The function checks in which section of the cube on the X axis the given point is located
-// In this case, the 3-dimensional coordinates are changed to 2-dimensional coordinates (z coordinates are ignored)
-//---------------------------------------------------------------------------
-UINT8 getXsection(PT3D* pt3Corners, const int ptX, const int ptY)
+QString movesToString(const QVector<ROTATIONS>& moves)                          // two equal quarter turns are written as a half turn
 {
-    PT2D pt2Corners[4];
-    for (int i=0; i<4; i++) pt2Corners[i] = pt3Corners[i];
-    return getXsection(pt2Corners, ptX, ptY);
-}
+    static const char* names[] = { "R", "R'", "L", "L'", "F", "F'", "B", "B'", "D", "D'", "U", "U'" };
+    QString text;
 
-//---------------------------------------------------------------------------
-// The function checks in which section of the cube on the Y axis the given point is located
-//---------------------------------------------------------------------------
-UINT8 getYsection(PT2D* ptCorners, const int ptX, const int ptY)
-{
-    int i, rc[cube_size];
-    double dx, dy;
-    PT2D ptLineStart, ptLineEnd;
-    dx = (ptCorners[2].x - ptCorners[1].x)/cube_size;                           // divide the given segment into the number of sections
-    dy = (ptCorners[2].y - ptCorners[1].y)/cube_size;
-    ptLineStart.x = ptCorners[0].x;                                             // we calculate the first section
-    ptLineStart.y = ptCorners[0].y;
-    ptLineEnd.x   = ptCorners[1].x;
-    ptLineEnd.y   = ptCorners[1].y;
-    for (i=0; i<cube_size; i++) {
-        rc[i] = lineTest(ptLineStart, ptLineEnd, ptX, ptY);                     // perform a point position test for all received segments
-        ptLineStart.x += dx;                                                    // we calculate the next section
-        ptLineStart.y += dy;
-        ptLineEnd.x   += dx;
-        ptLineEnd.y   += dy;
+    for (int i=0; i<moves.length(); i++) {
+        if (!text.isEmpty()) text += ' ';
+        if (i+1 < moves.length() && moves.at(i+1) == moves.at(i)) {
+            text += names[moves.at(i) & ~1];
+            text += '2';
+            i++;
+        }
+        else text += names[moves.at(i)];
     }
-    for (i=0; i<cube_size; i++) if (rc[i]==0) return i;                         // we check whether the point was located on one of the segments
-    for (i=0; i<cube_size-1; i++) if (rc[i]!=rc[i+1]) return i;                 // we check whether the point lies between some segments by checking the signs
-    return cube_size-1;
+    return text;
 }
+
 //---------------------------------------------------------------------------
-// The function checks in which section of the cube on the Y axis the given point is located
-// In this case, the 3-dimensional coordinates are changed to 2-dimensional coordinates (z coordinates are ignored)
+// Optimisation of the move sequence. The moves of the opposite sides commute, so every run of moves on one axis
+// is reduced to the net quarter turns of its two sides and written in a fixed order (R L, F B, D U).
+// A run which cancels out is removed, so the runs around it meet and can cancel as well (e.g. R U U' R')
 //---------------------------------------------------------------------------
-UINT8 getYsection(PT3D* pt3Corners, const int ptX, const int ptY)
+int optimizeMoves(QVector<ROTATIONS>& moves)                                    // removes redundant moves, returns the number of removed moves
 {
-    PT2D pt2Corners[4];
-    for (int i=0; i<4; i++) pt2Corners[i] = pt3Corners[i];
-    return getYsection(pt2Corners, ptX, ptY);
+    struct RUN {
+        int nAxis;                                                              // 0: R L, 1: F B, 2: D U - the order of the ROTATIONS
+        int nTurns[2];                                                          // net clockwise quarter turns (mod 4) of both sides
+    };
+    QVector<RUN> runs;
+    int i, j, nLength = moves.length();
+
+    for (i=0; i<nLength; i++) {
+        int nSide = moves.at(i) / 2;
+        if (runs.isEmpty() || runs.last().nAxis != nSide/2) {
+            RUN run = { nSide/2, { 0, 0 } };
+            runs.append(run);
+        }
+        RUN& run = runs.last();
+        run.nTurns[nSide & 1] = (run.nTurns[nSide & 1] + ((moves.at(i) & 1) ? 3 : 1)) % 4;
+        if (run.nTurns[0] == 0 && run.nTurns[1] == 0) runs.removeLast();
+    }
+
+    moves.clear();
+    for (i=0; i<runs.length(); i++) {
+        for (j=0; j<2; j++) {
+            ROTATIONS nMove = (ROTATIONS)((runs.at(i).nAxis*2 + j)*2);          // clockwise move of the side
+            switch (runs.at(i).nTurns[j]) {
+            case 1 : moves.append(nMove); break;
+            case 2 : moves.append(nMove); moves.append(nMove); break;           // there is no half turn in the queue
+            case 3 : moves.append((ROTATIONS)(nMove+1)); break;
+            }
+        }
+    }
+    return nLength - moves.length();
 }
 
 //---------------------------------------------------------------------------
@@ -242,113 +205,51 @@ void TCubePiece::rotateZ(bool bCW)
 }
 
 //---------------------------------------------------------------------------
-void TCubePiece::draw(float x,float y,float z)                                  // drawing a piece of cube
-{
-    glPushMatrix();                                                             // first we rotate such a piece of cube (needed for animation)
-    if (m_fRotationAngle) {
-        glRotatef(m_fRotationAngle, m_vRotation.x(), m_vRotation.y(), m_vRotation.z());
-    }
-    glTranslatef(x,y,z);                                                        // and then we start drawing in the right place
-    glBegin(GL_QUADS);
-        glColor3ub(MAKECOLOR(m_nSideColor[SD_RIGHT]));
-        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Right)
-        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Right)
-        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Right)
-        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Right)
-        glColor3ub(MAKECOLOR(m_nSideColor[SD_BOTTOM]));
-        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Top Right Of The Quad (Bottom)
-        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Top Left Of The Quad (Bottom)
-        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Bottom)
-        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Bottom)
-        glColor3ub(MAKECOLOR(m_nSideColor[SD_FRONT]));
-        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Front)
-        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Front)
-        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Front)
-        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Front)
-        glColor3ub(MAKECOLOR(m_nSideColor[SD_TOP]));
-        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Top)
-        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Top)
-        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Bottom Left Of The Quad (Top)
-        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Bottom Right Of The Quad (Top)
-        glColor3ub(MAKECOLOR(m_nSideColor[SD_LEFT]));
-        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Left)
-        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Left)
-        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Left)
-        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Left)
-        glColor3ub(MAKECOLOR(m_nSideColor[SD_BACK]));
-        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Top Right Of The Quad (Back)
-        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Top Left Of The Quad (Back)
-        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Bottom Left Of The Quad (Back)
-        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Bottom Right Of The Quad (Back)
-    glEnd();
-    glColor3ub(MAKECOLOR(BLACK));
-    if (m_nSideColor[SD_RIGHT]!=BLACK) {                                        // we check whether the color of the right side of the cube is not black
-        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
-        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Right)
-        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Right)
-        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Right)
-        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Right)
-        glEnd();
-    }
-    if (m_nSideColor[SD_BOTTOM]!=BLACK) {                                       // we check whether the color of the underside of the piece of cube is not black
-        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
-        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Top Right Of The Quad (Bottom)
-        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Top Left Of The Quad (Bottom)
-        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Bottom)
-        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Bottom)
-        glEnd();
-    }
-    if (m_nSideColor[SD_FRONT]!=BLACK) {                                        // we check whether the color of the front side of the cube piece is not black
-        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
-        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Front)
-        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Front)
-        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Front)
-        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Front)
-        glEnd();
-    }
-    if (m_nSideColor[SD_TOP]!=BLACK) {                                          // we check whether the color of the upper side of the cube piece is not black
-        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
-        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Top)
-        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Top)
-        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Bottom Left Of The Quad (Top)
-        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Bottom Right Of The Quad (Top)
-        glEnd();
-    }
-    if (m_nSideColor[SD_LEFT]!=BLACK) {                                         // we check whether the color of the left side of the cube is not black
-        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
-        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Left)
-        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Left)
-        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Left)
-        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Left)
-        glEnd();
-    }
-    if (m_nSideColor[SD_BACK]!=BLACK) {                                         // we check whether the color of the back side of the piece of cube is not black
-        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
-        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Top Right Of The Quad (Back)
-        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Top Left Of The Quad (Back)
-        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Bottom Left Of The Quad (Back)
-        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Bottom Right Of The Quad (Back)
-        glEnd();
-    }
-    glPopMatrix();
-}
-
-//---------------------------------------------------------------------------
-TCube::TCube(OGLWidget *widget)
-{
-    this->widget = widget;
-    memset(m_pPieces, 0, sizeof(TCubePiece*)*cube_size*cube_size*cube_size);    // we create zero pointers to the pieces of the cube
+TCube::TCube(TCubeView *view)
+{
+    this->view = view;
+    m_nTurnDuration = view ? DEFAULT_TURN_DURATION : 0;                       // a headless cube is animated only when asked for
+    m_nAnimationAxis = -1;
+    blueEdgeOrientation = false;
+    clearMoveCounts();
     reset();
     //Random();
 }
 
+//---------------------------------------------------------------------------
+// Copy of the cube state, used to check the effects of moves before they are added to the queue
+// The copy is not connected to any view, so it is never animated
+//---------------------------------------------------------------------------
+TCube::TCube(const TCube& cube)
+{
+    this->view = NULL;
+    m_nTurnDuration = 0;
+    m_nAnimationAxis = -1;
+    clearMoveCounts();
+    copyState(cube);
+}
+
 //---------------------------------------------------------------------------
 TCube::~TCube()
 {
+}
+
+//---------------------------------------------------------------------------
+// Copying the arrangement of the pieces and the solving stage of another cube (the move queue is not copied)
+// The pieces are stored inside the cube, so the copy does not need any memory allocation
+//---------------------------------------------------------------------------
+void TCube::copyState(const TCube& cube)
+{
+    const TCubePiece* pSource = &cube.m_Pieces[0][0][0];
+    TCubePiece* pDest = &m_Pieces[0][0][0];
+
+    blueEdgeOrientation = cube.blueEdgeOrientation;
+    markAllSections();
     for (int x=0; x<cube_size; x++) {
         for (int y=0; y<cube_size; y++) {
             for (int z=0; z<cube_size; z++) {
-                if (m_pPieces[x][y][z]) delete m_pPieces[x][y][z];              // we create the appropriate piece of the cube and save its index in the piece matrix
+                m_Pieces[x][y][z] = cube.m_Pieces[x][y][z];                     // we copy the pieces
+                m_pPieces[x][y][z] = pDest + (cube.m_pPieces[x][y][z] - pSource);   // and point to the same piece as in the copied cube
             }
         }
     }
@@ -357,11 +258,12 @@ TCube::~TCube()
 //---------------------------------------------------------------------------
 void TCube::reset(void)                                                         // cube reset - all colors arranged
 {
+    markAllSections();
     for (int x=0; x<cube_size; x++) {
         for (int y=0; y<cube_size; y++) {
             for (int z=0; z<cube_size; z++) {
-                if (m_pPieces[x][y][z]) delete m_pPieces[x][y][z];              // If there were any pieces of cube, remove them
-                m_pPieces[x][y][z] = new TCubePiece(BYTEVEC(x,y,z));            // create new cube pieces in the correct position
+                m_pPieces[x][y][z] = &m_Pieces[x][y][z];
+                *m_pPieces[x][y][z] = TCubePiece(BYTEVEC(x,y,z));               // create new cube pieces in the correct position
             }
         }
     }
@@ -370,149 +272,87 @@ void TCube::reset(void)
 //---------------------------------------------------------------------------
 void TCube::random(void)                                                        // randomly rearranging the cube
 {
-    bool bCW;
-    UINT8 nSection, nAxis;
+    random((quint64)QDateTime::currentMSecsSinceEpoch());
+}
 
-    QTime time = QTime::currentTime();
-    qsrand((uint)time.msec());
-    for (int i=0; i<100; i++) {                                                 // We randomly rearrange the sections of the cube 100 times
-        bCW = (bool)(qrand() % 2);                                              // we randomly choose whether the rotation should be clockwise or not
-        nSection =  qrand() % cube_size;                                        // randomly choose a section number
-        nAxis = qrand() % 3;                                                    // randomly choose axis
-        if (nAxis==0) rotateXSection(nSection, bCW, FALSE);                     // we translate the cube sections on the X axis
-        else if (nAxis==1) rotateYSection(nSection, bCW, FALSE);                // we translate the cube sections on the Y axis
-        else rotateZSection(nSection, bCW, FALSE);                              // we translate the cube sections on the Z axis
-    }
+//---------------------------------------------------------------------------
+// Setting the cube to a random state, every legal state equally probable; the same seed always gives the same cube
+//---------------------------------------------------------------------------
+void TCube::random(quint64 nSeed)
+{
+    TScrambler scrambler(nSeed);
 
+    reset();
+    scrambler.scramble(*this);
     blueEdgeOrientation = false;
 }
 
 //---------------------------------------------------------------------------
-// Cube section rotation based on mouse direction and display window size
+// Ray through a point of the window (y down) in the space of the cube, from the inverse of projection * model
 //---------------------------------------------------------------------------
-bool TCube::rotate(GLdouble* mxProjection, GLdouble* mxModel, GLint* nViewPort,
-            int wndSizeX, int wndSizeY, int ptMouseWndX, int ptMouseWndY, int ptLastMouseWndX, int ptLastMouseWndY, OGLWidget *widget)
+static void windowRay(const QMatrix4x4& mxInverse, int wndSizeX, int wndSizeY, int ptX, int ptY, QVector3D& vOrigin, QVector3D& vDirection)
 {
-    int i;
-    double fTmp, fMinZ = DBL_MAX;
-    float xMin=FLT_MAX, yMin=FLT_MAX;
-    float xMax=FLT_MIN, yMax=FLT_MIN;
-    int ptMouseX=ptMouseWndX, ptMouseY=wndSizeY-ptMouseWndY;                    // We change the y direction of the mouse to match the display coordinates
-    int ptLastMouseX=ptLastMouseWndX, ptLastMouseY=wndSizeY-ptLastMouseWndY;
-
-    (void)wndSizeX;
-    this->widget = widget;
-    SIDE nSide = (SIDE)-1;
-    // First, we check whether the mouse is on the cube or not
-    // We save all edge points of the designed cube into a variable
-    PT3D vCubeCorner[8];
-    // Front wall
-    gluProject( cube_size/2.0, cube_size/2.0, cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[0].x, &vCubeCorner[0].y, &vCubeCorner[0].z);
-    gluProject( cube_size/2.0,-cube_size/2.0, cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[1].x, &vCubeCorner[1].y, &vCubeCorner[1].z);
-    gluProject(-cube_size/2.0,-cube_size/2.0, cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[2].x, &vCubeCorner[2].y, &vCubeCorner[2].z);
-    gluProject(-cube_size/2.0, cube_size/2.0, cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[3].x, &vCubeCorner[3].y, &vCubeCorner[3].z);
-    // Back wall
-    gluProject( cube_size/2.0, cube_size/2.0,-cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[4].x, &vCubeCorner[4].y, &vCubeCorner[4].z);
-    gluProject( cube_size/2.0,-cube_size/2.0,-cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[5].x, &vCubeCorner[5].y, &vCubeCorner[5].z);
-    gluProject(-cube_size/2.0,-cube_size/2.0,-cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[6].x, &vCubeCorner[6].y, &vCubeCorner[6].z);
-    gluProject(-cube_size/2.0, cube_size/2.0,-cube_size/2.0, mxModel, mxProjection, nViewPort, &vCubeCorner[7].x, &vCubeCorner[7].y, &vCubeCorner[7].z);
-
-    for (i=0; i<8; i++) {                                                       // we calculate the minimum and maximum X and Y coordinates to check the mouse position
-        xMin = std::min(xMin, (float)vCubeCorner[i].x);
-        yMin = std::min(yMin, (float)vCubeCorner[i].y);
-        xMax = std::max(xMax, (float)vCubeCorner[i].x);
-        yMax = std::max(yMax, (float)vCubeCorner[i].y);
-    }
-    if (!(xMin<=ptLastMouseX && ptLastMouseX<=xMax &&
-          yMin<=ptLastMouseY && ptLastMouseY<=yMax)) {                          // we check whether the mouse pointer is on the cube
-        return FALSE;                                                           // if not, we leave
-    }
-    // We build an array consisting of all the edges of the cube
-    PT3D vCorner[6][4] = {
-        {vCubeCorner[5], vCubeCorner[1], vCubeCorner[0], vCubeCorner[4]},       // Right
-        {vCubeCorner[6], vCubeCorner[2], vCubeCorner[3], vCubeCorner[7]},       // Left
-        {vCubeCorner[7], vCubeCorner[4], vCubeCorner[0], vCubeCorner[3]},       // Up
-        {vCubeCorner[6], vCubeCorner[5], vCubeCorner[1], vCubeCorner[2]},       // Bottom
-        {vCubeCorner[2], vCubeCorner[1], vCubeCorner[0], vCubeCorner[3]},       // Front
-        {vCubeCorner[6], vCubeCorner[5], vCubeCorner[4], vCubeCorner[7]},       // Rear
-        };
-
-    // we check whether the mouse pointer was on any side of the cube
-    for (i=0; i<6; i++) {
-        if (poly4InsideTest(vCorner[i], ptLastMouseX, ptLastMouseY)) {
-            fTmp = std::min(std::min(std::min(vCorner[i][0].z, vCorner[i][1].z), vCorner[i][2].z), vCorner[i][3].z);
-            if (fTmp < fMinZ) {
-                nSide = (SIDE)i;
-                fMinZ = fTmp;
-            }
-        }
-    }
+    float x = 2.0f*ptX/wndSizeX - 1.0f;
+    float y = 1.0f - 2.0f*ptY/wndSizeY;
 
-    if ((int)nSide==-1) return FALSE;                                           // the mouse pointer was not on any side of the cube
-
-    // Once we have checked the side of the cube, we now check the direction of rotation of the section
-    QVector2D vX((float)(vCorner[nSide][1].x - vCorner[nSide][0].x),(float)(vCorner[nSide][1].y - vCorner[nSide][0].y));
-    QVector2D vY((float)(vCorner[nSide][2].x - vCorner[nSide][1].x),(float)(vCorner[nSide][2].y - vCorner[nSide][1].y));
-    QVector2D vMouse((float)(ptMouseX-ptLastMouseX),(float)(ptMouseY-ptLastMouseY));    // we calculate the mouse displacement vector
-    if (vMouse.length() < g_fMinMouseLength) return FALSE;                      // we check whether the mouse movement is not too small, if so, we cancel this movement
-    vX.normalize();                                                             // we check the direction of movement by checking
-    vY.normalize();                                                             // mouse movement vector
-    vMouse.normalize();                                                         // and the X/Y vector of the cube side
-
-    float xDiff, yDiff;
-    xDiff = Vec2DAngle(vX, vMouse); if (_isnan(xDiff)) return FALSE;
-    yDiff = Vec2DAngle(vY, vMouse); if (_isnan(yDiff)) return FALSE;
-    float minDiff = (float)std::min(std::min(std::min(fabs(xDiff), fabs(yDiff)), fabs(xDiff-180)), fabs(yDiff-180));
-    if (minDiff > g_fMaxMouseAngle) return FALSE;                                   // If the kata turns out to be too large to qualify the direction of rotation, we cancel it
-
-    // Now we check which section of the cube should be rotated
-    UINT8 nSection;
-    minDiff += ALMOST_ZERO;                                                     // we increase the value to compare with the original value
-    if (fabs(xDiff) <= minDiff) {                                               // we check whether the angle of the mouse movement vector is consistent with any of the angles of the page vector
-       nSection = getYsection(vCorner[nSide], ptLastMouseX, ptLastMouseY);      // we calculate the section number to be rotated
-       switch (nSide) {
-          case SD_FRONT:    rotateYSection(nSection, TRUE, TRUE);  break;
-          case SD_BACK:     rotateYSection(nSection, FALSE, TRUE); break;
-          case SD_LEFT:     rotateYSection(nSection, TRUE, TRUE);  break;
-          case SD_RIGHT:    rotateYSection(nSection, FALSE, TRUE); break;
-          case SD_TOP:      rotateZSection(nSection, FALSE, TRUE); break;
-          case SD_BOTTOM:   rotateZSection(nSection, TRUE, TRUE);  break;
-       }
-    }
-    else if (fabs(xDiff-180) <= minDiff) {                                      // we check whether the angle of the mouse movement vector is consistent with any of the angles of the page vector
-       nSection = getYsection(vCorner[nSide], ptLastMouseX, ptLastMouseY);      // we calculate the section number to be rotated
-       switch (nSide) {
-          case SD_FRONT:    rotateYSection(nSection, FALSE, TRUE); break;
-          case SD_BACK:     rotateYSection(nSection, TRUE, TRUE);  break;
-          case SD_LEFT:     rotateYSection(nSection, FALSE, TRUE); break;
-          case SD_RIGHT:    rotateYSection(nSection, TRUE, TRUE);  break;
-          case SD_TOP:      rotateZSection(nSection, TRUE, TRUE);  break;
-          case SD_BOTTOM:   rotateZSection(nSection, FALSE, TRUE); break;
-       }
-    }
-    else if (fabs(yDiff) <= minDiff) {                                          // we check whether the angle of the mouse movement vector is consistent with any of the angles of the page vector
-       nSection = getXsection(vCorner[nSide], ptLastMouseX, ptLastMouseY);      // we calculate the section number to be rotated
-       switch (nSide) {
-          case SD_FRONT:    rotateXSection(nSection, FALSE, TRUE); break;
-          case SD_BACK:     rotateXSection(nSection, TRUE,  TRUE); break;
-          case SD_LEFT:     rotateZSection(nSection, FALSE, TRUE); break;
-          case SD_RIGHT:    rotateZSection(nSection, TRUE, TRUE);  break;
-          case SD_TOP:      rotateXSection(nSection, TRUE,  TRUE); break;
-          case SD_BOTTOM:   rotateXSection(nSection, FALSE, TRUE); break;
-       }
-    }
-    else if (fabs(yDiff-180) <= minDiff) {                                      // we check whether the angle of the mouse movement vector is consistent with any of the angles of the page vector
-       nSection = getXsection(vCorner[nSide], ptLastMouseX, ptLastMouseY);      // we calculate the section number to be rotated
-       switch (nSide) {
-          case SD_FRONT:    rotateXSection(nSection, TRUE,  TRUE); break;
-          case SD_BACK:     rotateXSection(nSection, FALSE, TRUE); break;
-          case SD_LEFT:     rotateZSection(nSection, TRUE, TRUE);  break;
-          case SD_RIGHT:    rotateZSection(nSection, FALSE, TRUE); break;
-          case SD_TOP:      rotateXSection(nSection, FALSE, TRUE); break;
-          case SD_BOTTOM:   rotateXSection(nSection, TRUE,  TRUE); break;
-       }
-    }
-    else return false;
+    vOrigin = mxInverse.map(QVector3D(x, y, -1.0f));                            // on the near plane
+    vDirection = mxInverse.map(QVector3D(x, y, 1.0f)) - vOrigin;                // to the far plane
+}
+
+//---------------------------------------------------------------------------
+// Cube section rotation based on mouse direction: the ray of the press point hits the box of the cube (-N/2 .. N/2
+// on each axis) on the side it enters first; the ray of the release point is cut with the plane of that side, which
+// gives the drag on the side. The turned axis is perpendicular to the side and to the main direction of the drag,
+// the section is the one of the hit point, and the turn moves the hit point along the drag. Only the matrices
+// kept by the widget are used, no GL state is read
+//---------------------------------------------------------------------------
+bool TCube::rotate(const QMatrix4x4& mxViewProjection, int wndSizeX, int wndSizeY,
+                   int ptMouseWndX, int ptMouseWndY, int ptLastMouseWndX, int ptLastMouseWndY, TCubeView *view)
+{
+    const float fHalf = cube_size/2.0f;
+    QVector3D vOrigin, vDirection, vHit, vDrag;
+    float fEnter = -FLT_MAX, fExit = FLT_MAX;
+    bool bInvertible;
+    int i, nSide = -1;
+
+    this->view = view;
+    if (wndSizeX <= 0 || wndSizeY <= 0) return false;
+    if (QVector2D(ptMouseWndX-ptLastMouseWndX, ptMouseWndY-ptLastMouseWndY).length() < g_fMinMouseLength) return false;
+    QMatrix4x4 mxInverse = mxViewProjection.inverted(&bInvertible);
+    if (!bInvertible) return false;
+
+    windowRay(mxInverse, wndSizeX, wndSizeY, ptLastMouseWndX, ptLastMouseWndY, vOrigin, vDirection);
+    for (i=0; i<3; i++) {                                                       // the slabs of the box, one per axis
+        if (fabs(vDirection[i]) < ALMOST_ZERO) {
+            if (fabs(vOrigin[i]) > fHalf) return false;                         // parallel to the slab and outside of it
+            continue;
+        }
+        float fNear = (-fHalf - vOrigin[i]) / vDirection[i];
+        float fFar = (fHalf - vOrigin[i]) / vDirection[i];
+        if (fNear > fFar) std::swap(fNear, fFar);
+        if (fNear > fEnter) {
+            fEnter = fNear;
+            nSide = i;
+        }
+        fExit = std::min(fExit, fFar);
+    }
+    if (nSide < 0 || fEnter > fExit) return false;                              // the mouse pointer was not on the cube
+    vHit = vOrigin + fEnter*vDirection;
+
+    windowRay(mxInverse, wndSizeX, wndSizeY, ptMouseWndX, ptMouseWndY, vOrigin, vDirection);
+    if (fabs(vDirection[nSide]) < ALMOST_ZERO) return false;                    // the side is seen edge-on
+    vDrag = vOrigin + (vHit[nSide] - vOrigin[nSide]) / vDirection[nSide] * vDirection - vHit;
+
+    int nU = (nSide + 1) % 3, nV = (nSide + 2) % 3;
+    int nAxis = fabs(vDrag[nU]) >= fabs(vDrag[nV]) ? nV : nU;                   // the axis of the turn is across the drag
+    QVector3D vAxis(nAxis == 0, nAxis == 1, nAxis == 2);
+    UINT8 nSection = (UINT8)qBound(0, (int)floor(vHit[nAxis] + fHalf), cube_size-1);
+    BOOL bCW = QVector3D::dotProduct(QVector3D::crossProduct(vAxis, vHit), vDrag) > 0;  // the positive turn (bCW) moves the hit point along the drag
+    switch (nAxis) {
+      case 0:   rotateXSection(nSection, bCW, TRUE); break;
+      case 1:   rotateYSection(nSection, bCW, TRUE); break;
+      default:  rotateZSection(nSection, bCW, TRUE); break;
+    }
     return TRUE;
 }
 
@@ -523,10 +363,11 @@ void TCube::rotateXSection(UINT8 nSection, BOOL bCW, BOOL bAnimate)
     TCubePiece* TmpPiece[cube_size-1];
     float fAngle = bCW ? 90.0f : -90.0f;
     if (nSection>=cube_size) return;
+    if (isAnimating()) finishAnimation();                                       // the previous turn jumps to its end
     TCubePiece* pieces[cube_size*cube_size];
     for (i=0, y=0; y<cube_size; y++)
         for (z=0; z<cube_size; z++) pieces[i++]=m_pPieces[x][y][z];             // we remember which pieces of the cube will be rotated
-    if (bAnimate) animateRotation(pieces, ELEMENTS_OF(pieces), QVector3D(1,0,0), fAngle); // we animate the rotation of these pieces
+    markSection(0, nSection);                                                   // the renderer uploads the colors of this section again
     for (i=0; i<(int)ELEMENTS_OF(pieces); i++) pieces[i]->rotateX(bCW);         // We rotate each piece separately
     if (bCW) {                                                                  // or rotation of the cube sections clockwise
         size = cube_size-1;                                                     // we move the pieces of the cube section clockwise
@@ -550,6 +391,7 @@ void TCube::rotateXSection(UINT8 nSection, BOOL bCW, BOOL bAnimate)
             size -= 2;
         }
     }
+    if (bAnimate) startAnimation(0, nSection, fAngle);                          // the turn is shown by the next frames
 }
 
 //---------------------------------------------------------------------------
@@ -559,10 +401,11 @@ void TCube::rotateYSection(UINT8 nSection, BOOL bCW, BOOL bAnimate)
     TCubePiece* TmpPiece[cube_size-1];
     float fAngle = bCW ? 90.0f : -90.0f;
     if (nSection>=cube_size) return;
+    if (isAnimating()) finishAnimation();                                       // the previous turn jumps to its end
     TCubePiece* pieces[cube_size*cube_size];
     for (i=0, x=0; x<cube_size; x++)
         for (z=0; z<cube_size; z++) pieces[i++]=m_pPieces[x][y][z];             // we remember which pieces of the cube will be rotated
-    if (bAnimate) animateRotation(pieces, ELEMENTS_OF(pieces), QVector3D(0,1,0), fAngle); // we animate the rotation of these pieces
+    markSection(1, nSection);                                                   // the renderer uploads the colors of this section again
     for (i=0; i<(int)ELEMENTS_OF(pieces); i++) pieces[i]->rotateY(bCW);         // We rotate each piece separately
     if (bCW) {                                                                  // or rotation of the cube sections clockwise
         size = cube_size-1;                                                     // we move the pieces of the cube section clockwise
@@ -586,6 +429,7 @@ void TCube::rotateYSection(UINT8 nSection, BOOL bCW, BOOL bAnimate)
             size -= 2;
         }
     }
+    if (bAnimate) startAnimation(1, nSection, fAngle);                          // the turn is shown by the next frames
 }
 
 //---------------------------------------------------------------------------
@@ -595,10 +439,11 @@ void TCube::rotateZSection(UINT8 nSection, BOOL bCW, BOOL bAnimate)
     TCubePiece* TmpPiece[cube_size-1];
     float fAngle = bCW ? 90.0f : -90.0f;
     if (nSection>=cube_size) return;
+    if (isAnimating()) finishAnimation();                                       // the previous turn jumps to its end
     TCubePiece* pieces[cube_size*cube_size];
     for (i=0, x=0; x<cube_size; x++)
         for (y=0; y<cube_size; y++) pieces[i++]=m_pPieces[x][y][z];             // we remember which pieces of the cube will be rotated
-    if (bAnimate) animateRotation(pieces, ELEMENTS_OF(pieces), QVector3D(0,0,1), fAngle); // we animate the rotation of these pieces
+    markSection(2, nSection);                                                   // the renderer uploads the colors of this section again
     for (i=0; i<(int)ELEMENTS_OF(pieces); i++) pieces[i]->rotateZ(bCW);         // We rotate each piece separately
     if (bCW) {                                                                  // or rotation of the cube sections clockwise
         size = cube_size-1;                                                     // we move the pieces of the cube section clockwise
@@ -622,44 +467,180 @@ void TCube::rotateZSection(UINT8 nSection, BOOL bCW, BOOL bAnimate)
             size -= 2;
         }
     }
+    if (bAnimate) startAnimation(2, nSection, fAngle);                          // the turn is shown by the next frames
+}
+
+//---------------------------------------------------------------------------
+void TCube::makeMove(ROTATIONS nMove, BOOL bAnimate)                            // execution of a single move from the queue
+{
+    switch (nMove) {
+    case ROT_R    : RotateR(bAnimate); break;
+    case ROT_RCCW : RotateRCCW(bAnimate); break;
+    case ROT_L    : RotateL(bAnimate); break;
+    case ROT_LCCW : RotateLCCW(bAnimate); break;
+    case ROT_F    : RotateF(bAnimate); break;
+    case ROT_FCCW : RotateFCCW(bAnimate); break;
+    case ROT_B    : RotateB(bAnimate); break;
+    case ROT_BCCW : RotateBCCW(bAnimate); break;
+    case ROT_D    : RotateD(bAnimate); break;
+    case ROT_DCCW : RotateDCCW(bAnimate); break;
+    case ROT_U    : RotateU(bAnimate); break;
+    case ROT_UCCW : RotateUCCW(bAnimate); break;
+    }
 }
 
 //---------------------------------------------------------------------------
-void TCube::animateRotation(TCubePiece* piece[], int ctPieces, QVector3D v, float fAngle)
+// Piece with the facelet (the visible side of a piece) of the index used by TFaceletPermutation
+//---------------------------------------------------------------------------
+TCubePiece* TCube::faceletPiece(int nFacelet) const
+{
+    int k, v[3], nPos[3];
+
+    faceletToPoint(nFacelet, v);
+    for (k=0; k<3; k++) nPos[k] = (qBound(-(cube_size-1), v[k], cube_size-1) + cube_size-1) / 2;
+    return m_pPieces[nPos[0]][nPos[1]][nPos[2]];
+}
+
+//---------------------------------------------------------------------------
+SIDECOLOR TCube::faceletColor(int nFacelet) const
+{
+    return faceletPiece(nFacelet)->m_nSideColor[nFacelet / (cube_size*cube_size)];
+}
+
+//---------------------------------------------------------------------------
+void TCube::getFacelets(SIDECOLOR* nColors) const                               // nColors must hold FACELETS colors
+{
+    for (int i=0; i<FACELETS; i++) nColors[i] = faceletColor(i);
+}
+
+//---------------------------------------------------------------------------
+// Setting the colors of all facelets; the pieces stay in their places, only the colors of their visible sides change
+//---------------------------------------------------------------------------
+void TCube::setFacelets(const SIDECOLOR* nColors)
+{
+    for (int i=0; i<FACELETS; i++) faceletPiece(i)->m_nSideColor[i / (cube_size*cube_size)] = nColors[i];
+    markAllSections();
+}
+
+//---------------------------------------------------------------------------
+// Moving the colors of all facelets at once (e.g. the net permutation of an algorithm), without animation
+//---------------------------------------------------------------------------
+void TCube::applyPermutation(const TFaceletPermutation& permutation)
 {
-    int i,x;
+    SIDECOLOR nColors[FACELETS];
+    SIDECOLOR nPermuted[FACELETS];
 
-    if (g_nRotationSteps <= 1) return;
-    for (i=0; (UINT)i<g_nRotationSteps; i++) {                                  // execute individual animation frames in a loop
-        float fRotAngle = fAngle * i/g_nRotationSteps;                          // calculate the appropriate angle of inclination of the cube section
-        for (int x=0; x<ctPieces; x++) piece[x]->setRotation(fRotAngle, v);     // and write down the angle for all pieces in this section of the cube
-        if (widget) {
-            widget->updateGL();
+    getFacelets(nColors);
+    for (int i=0; i<FACELETS; i++) nPermuted[i] = nColors[permutation.m_nFrom[i]];
+    setFacelets(nPermuted);
+}
+
+//---------------------------------------------------------------------------
+// Rotation of the whole cube (all sections, without animation) so that the given side is on the top
+//---------------------------------------------------------------------------
+void TCube::turnSideToTop(SIDE side)
+{
+    for (int i=0; i<cube_size; i++) {
+        switch (side) {
+        case SD_RIGHT  : rotateZSection(i, TRUE, FALSE); break;
+        case SD_LEFT   : rotateZSection(i, FALSE, FALSE); break;
+        case SD_TOP    : break;
+        case SD_BOTTOM : rotateXSection(i, TRUE, FALSE); rotateXSection(i, TRUE, FALSE); break;
+        case SD_FRONT  : rotateXSection(i, FALSE, FALSE); break;
+        case SD_BACK   : rotateXSection(i, TRUE, FALSE); break;
         }
     }
-    for (x=0; x<ctPieces; x++) piece[x]->clrRotation();                         // at the end of the animation, reset the inclination angles of all pieces from the rotated cube section
 }
 
 //---------------------------------------------------------------------------
-void TCube::draw(void)                                                          // drawing the whole cube
+// Changing the colors of all pieces, nColorMap gives the new color for each old color
+//---------------------------------------------------------------------------
+void TCube::relabelColors(const SIDECOLOR* nColorMap)
 {
-    int x, y, z;
-    float posx, posy, posz;
-    posx = -(cube_size-1)/2.0;                                                  // We initially count the x positions for a piece of the cube
-    for (x=0; x<cube_size; x++) {
-        posy = -(cube_size-1)/2.0;                                              // We initially count the y positions for a piece of the cube
-        for (y=0; y<cube_size; y++) {
-            posz = -(cube_size-1)/2.0;                                          // We initially count the z positions for a piece of the cube
-            for (z=0; z<cube_size; z++) {
-                m_pPieces[x][y][z]->draw(posx, posy, posz);                     // draw the appropriate piece of the cube in the designated position
-                posz += 1.0;                                                    // increase position z piece of cubez
+    markAllSections();
+    for (int x=0; x<cube_size; x++) {
+        for (int y=0; y<cube_size; y++) {
+            for (int z=0; z<cube_size; z++) {
+                for (int i=0; i<6; i++) m_Pieces[x][y][z].m_nSideColor[i] = nColorMap[m_Pieces[x][y][z].m_nSideColor[i]];
             }
-            posy += 1.0;                                                        // increase position y piece of cubez
         }
-        posx += 1.0;                                                            // increase position x piece of cube
     }
 }
 
+//---------------------------------------------------------------------------
+// The turn is already made, the pieces of the section are only drawn turned back by the part of the angle which
+// is still to come. The frames call animate(); nothing waits for them, so the event loop keeps running
+//---------------------------------------------------------------------------
+void TCube::startAnimation(int nAxis, UINT8 nSection, float fAngle)
+{
+    if (m_nTurnDuration <= 0) return;                                           // the copies are never animated
+    m_nAnimationAxis = nAxis;
+    m_nAnimationSection = nSection;
+    m_fAnimationAngle = fAngle;
+    m_nAnimationStart = -1;
+    setSectionRotation(-fAngle);
+    if (view) view->cubeChanged();
+}
+
+//---------------------------------------------------------------------------
+// Angle of the animated section at the time nTime [ms] of the frame clock; false when the turn has ended
+//---------------------------------------------------------------------------
+bool TCube::animate(qint64 nTime)
+{
+    if (!isAnimating()) return false;
+    if (m_nAnimationStart < 0) m_nAnimationStart = nTime;                       // the first frame of the turn
+    qint64 nElapsed = nTime - m_nAnimationStart;
+    if (m_nTurnDuration <= 0 || nElapsed >= m_nTurnDuration) {                  // also a turn whose duration was set to 0 meanwhile
+        finishAnimation();
+        return false;
+    }
+    float fDone = (float)nElapsed / m_nTurnDuration;
+    setSectionRotation(m_fAnimationAngle * (fDone - 1.0f));
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TCube::finishAnimation(void)
+{
+    setSectionRotation(0);
+    m_nAnimationAxis = -1;
+}
+
+//---------------------------------------------------------------------------
+void TCube::setSectionRotation(float fAngle)
+{
+    QVector3D v(m_nAnimationAxis == 0, m_nAnimationAxis == 1, m_nAnimationAxis == 2);
+
+    for (int i=0; i<cube_size; i++) {
+        for (int j=0; j<cube_size; j++) {
+            TCubePiece* pPiece;
+            switch (m_nAnimationAxis) {
+            case 0  : pPiece = m_pPieces[m_nAnimationSection][i][j]; break;
+            case 1  : pPiece = m_pPieces[i][m_nAnimationSection][j]; break;
+            default : pPiece = m_pPieces[i][j][m_nAnimationSection]; break;
+            }
+            if (fAngle) pPiece->setRotation(fAngle, v);
+            else pPiece->clrRotation();
+        }
+    }
+    markSection(m_nAnimationAxis, m_nAnimationSection);
+}
+
+//---------------------------------------------------------------------------
+// Sections changed since the last call (by moves, animation frames or new colors); the masks are cleared
+//---------------------------------------------------------------------------
+bool TCube::takeDirtySections(quint32* nSections)
+{
+    bool bDirty = false;
+
+    for (int i=0; i<3; i++) {
+        nSections[i] = m_nDirtySections[i];
+        m_nDirtySections[i] = 0;
+        bDirty |= nSections[i] != 0;
+    }
+    return bDirty;
+}
+
 //---------------------------------------------------------------------------
 bool TCube::check(void)                                                         // checks whether the cube has been solved
 {
@@ -692,6 +673,20 @@ bool TCube::check(void)
     return true;
 }
 
+//---------------------------------------------------------------------------
+SIDECOLOR TCube::centerColor(SIDE side) const                                  // color of the center of the given side
+{
+    switch (side) {
+    case SD_RIGHT  : return m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT];
+    case SD_LEFT   : return m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT];
+    case SD_TOP    : return m_pPieces[cube_mid_pos][cube_size-1][cube_mid_pos]->m_nSideColor[SD_TOP];
+    case SD_BOTTOM : return m_pPieces[cube_mid_pos][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM];
+    case SD_FRONT  : return m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT];
+    case SD_BACK   : return m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK];
+    }
+    return BLACK;
+}
+
 //---------------------------------------------------------------------------
 SIDE TCube::findWhiteCrossSide(void)
 {
@@ -704,6 +699,13 @@ SIDE TCube::findWhiteCrossSide(void)
     return (SIDE)-1;
 }
 
+//---------------------------------------------------------------------------
+// The sides around the white cross on the top; seen from the top, the next side is on the left of each side
+//---------------------------------------------------------------------------
+static const SIDE g_nAroundSides[4] = { SD_RIGHT, SD_FRONT, SD_LEFT, SD_BACK };
+static const int g_nSidePos[4][2] = { { cube_size-1, cube_mid_pos }, { cube_mid_pos, cube_size-1 }, { 0, cube_mid_pos }, { cube_mid_pos, 0 } };   // x, z of the middle of each side
+static const int g_nSlotPos[4][2] = { { cube_size-1, cube_size-1 }, { 0, cube_size-1 }, { 0, 0 }, { cube_size-1, 0 } };   // x, z between a side and the next one
+
 //---------------------------------------------------------------------------
 bool TCube::checkWhiteCross(SIDE whiteCrossSide)
 {
@@ -725,6 +727,9 @@ bool TCube::checkWhiteCross(SIDE whiteCrossSide)
         if (m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_TOP] != WHITE) return false;
         if (m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_TOP] != WHITE) return false;
         if (m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] != WHITE) return false;
+        for (int i=0; i<4; i++) {                                               // each edge also below the center of its color
+            if (m_pPieces[g_nSidePos[i][0]][cube_size-1][g_nSidePos[i][1]]->m_nSideColor[g_nAroundSides[i]] != centerColor(g_nAroundSides[i])) return false;
+        }
         break;
     case SD_BOTTOM :
         if (m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM] != WHITE) return false;
@@ -769,6 +774,11 @@ bool TCube::checkWhiteCrossCorners(SIDE whiteCrossSide)
         if (m_pPieces[cube_size-1][cube_size-1][0]->m_nSideColor[SD_TOP] != WHITE) return false;
         if (m_pPieces[cube_size-1][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] != WHITE) return false;
         if (m_pPieces[0][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] != WHITE) return false;
+        for (int i=0; i<4; i++) {                                               // each corner also between the centers of its colors
+            const TCubePiece* pCorner = m_pPieces[g_nSlotPos[i][0]][cube_size-1][g_nSlotPos[i][1]];
+            if (pCorner->m_nSideColor[g_nAroundSides[i]] != centerColor(g_nAroundSides[i])) return false;
+            if (pCorner->m_nSideColor[g_nAroundSides[(i+1)%4]] != centerColor(g_nAroundSides[(i+1)%4])) return false;
+        }
         break;
     case SD_BOTTOM :
         if (m_pPieces[0][0][0]->m_nSideColor[SD_BOTTOM] != WHITE) return false;
@@ -842,51 +852,34 @@ bool TCube::checkEdgePermutationOfBlueCross(SIDE whiteCrossSide)
 }
 
 //---------------------------------------------------------------------------
-bool TCube::checkPermutationOfBlueCorners(SIDE whiteCrossSide)
+// Counting the corners of the bottom layer which are in their places (in any orientation)
+//---------------------------------------------------------------------------
+int TCube::placedBlueCorners(void)
 {
-    SIDECOLOR color1, color2, color3;
-    SIDECOLOR colorBottom, colorLeft, colorBack, colorRight, colorFront;
+    static const int nCornerPos[4][2] = { { 0, 0 }, { cube_size-1, 0 }, { cube_size-1, cube_size-1 }, { 0, cube_size-1 } };   // x, z
+    SIDECOLOR color1, color2, color3, colorX, colorZ;
+    int i, x, z, nPlaced = 0;
+
+    for (i=0; i<4; i++) {
+        x = nCornerPos[i][0];
+        z = nCornerPos[i][1];
+        colorX = m_pPieces[x][cube_mid_pos][cube_mid_pos]->m_nSideColor[x ? SD_RIGHT : SD_LEFT];
+        colorZ = m_pPieces[cube_mid_pos][cube_mid_pos][z]->m_nSideColor[z ? SD_FRONT : SD_BACK];
+        color1 = m_pPieces[x][0][z]->m_nSideColor[SD_BOTTOM];
+        color2 = m_pPieces[x][0][z]->m_nSideColor[x ? SD_RIGHT : SD_LEFT];
+        color3 = m_pPieces[x][0][z]->m_nSideColor[z ? SD_FRONT : SD_BACK];
+        if (((color1 == BLUE) || (color1 == colorX) || (color1 == colorZ)) &&
+            ((color2 == BLUE) || (color2 == colorX) || (color2 == colorZ)) &&
+            ((color3 == BLUE) || (color3 == colorX) || (color3 == colorZ))) nPlaced++;
+    }
+    return nPlaced;
+}
 
+//---------------------------------------------------------------------------
+bool TCube::checkPermutationOfBlueCorners(SIDE whiteCrossSide)
+{
     (void)whiteCrossSide;
-    colorBottom = BLUE;
-    colorLeft   = m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT];
-    colorBack   = m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK];
-    colorRight  = m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT];
-    colorFront  = m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT];
-
-    color1 = m_pPieces[0][0][0]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[0][0][0]->m_nSideColor[SD_LEFT];
-    color3 = m_pPieces[0][0][0]->m_nSideColor[SD_BACK];
-
-    if (!((color1 == colorBottom) || (color1 == colorLeft) || (color1 == colorBack))) return false;
-    if (!((color2 == colorBottom) || (color2 == colorLeft) || (color2 == colorBack))) return false;
-    if (!((color3 == colorBottom) || (color3 == colorLeft) || (color3 == colorBack))) return false;
-
-    color1 = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_RIGHT];
-    color3 = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_BACK];
-
-    if (!((color1 == colorBottom) || (color1 == colorRight) || (color1 == colorBack))) return false;
-    if (!((color2 == colorBottom) || (color2 == colorRight) || (color2 == colorBack))) return false;
-    if (!((color3 == colorBottom) || (color3 == colorRight) || (color3 == colorBack))) return false;
-
-    color1 = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_RIGHT];
-    color3 = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_FRONT];
-
-    if (!((color1 == colorBottom) || (color1 == colorRight) || (color1 == colorFront))) return false;
-    if (!((color2 == colorBottom) || (color2 == colorRight) || (color2 == colorFront))) return false;
-    if (!((color3 == colorBottom) || (color3 == colorRight) || (color3 == colorFront))) return false;
-
-    color1 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_LEFT];
-    color3 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_FRONT];
-
-    if (!((color1 == colorBottom) || (color1 == colorLeft) || (color1 == colorFront))) return false;
-    if (!((color2 == colorBottom) || (color2 == colorLeft) || (color2 == colorFront))) return false;
-    if (!((color3 == colorBottom) || (color3 == colorLeft) || (color3 == colorFront))) return false;
-
-    return true;
+    return placedBlueCorners() == 4;
 }
 
 //---------------------------------------------------------------------------
@@ -960,8 +953,7 @@ void TCube::arrangeWhiteCross(void)
     if (m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM] == WHITE) {            // bottom
         color = m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT];
         if (color == m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) {
-            moves.append(ROT_F);
-            moves.append(ROT_F);
+            moves += "F2"_alg;
             return;
         }
         else {
@@ -971,8 +963,7 @@ void TCube::arrangeWhiteCross(void)
     if (m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BOTTOM] == WHITE) {                      // up
         color = m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK];
         if (color == m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK]) {
-            moves.append(ROT_B);
-            moves.append(ROT_B);
+            moves += "B2"_alg;
             return;
         }
         else {
@@ -982,8 +973,7 @@ void TCube::arrangeWhiteCross(void)
     if (m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM] == WHITE) {            // right
         color = m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT];
         if (color == m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT]) {
-            moves.append(ROT_R);
-            moves.append(ROT_R);
+            moves += "R2"_alg;
             return;
         }
         else {
@@ -993,8 +983,7 @@ void TCube::arrangeWhiteCross(void)
     if (m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM] == WHITE) {                      // left
         color = m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT];
         if (color == m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT]) {
-            moves.append(ROT_L);
-            moves.append(ROT_L);
+            moves += "L2"_alg;
             return;
         }
         else {
@@ -1011,43 +1000,39 @@ void TCube::arrangeWhiteCross(void)
     if (m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] == WHITE) {     // bottom
         color = m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT];
         if (color != m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) {
-            moves.append(ROT_F);
-            moves.append(ROT_F);
+            moves += "F2"_alg;
             return;
         }
     }
     if (m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_TOP] == WHITE) {               // up
         color = m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_BACK];
         if (color != m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK]) {
-            moves.append(ROT_B);
-            moves.append(ROT_B);
+            moves += "B2"_alg;
             return;
         }
     }
     if (m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_TOP] == WHITE) {     // right
         color = m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_RIGHT];
         if (color != m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT]) {
-            moves.append(ROT_R);
-            moves.append(ROT_R);
+            moves += "R2"_alg;
             return;
         }
     }
     if (m_pPieces[0][cube_size-1][cube_mid_pos]->m_nSideColor[SD_TOP] == WHITE) {               // left
         color = m_pPieces[0][cube_size-1][cube_mid_pos]->m_nSideColor[SD_LEFT];
         if (color != m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT]) {
-            moves.append(ROT_L);
-            moves.append(ROT_L);
+            moves += "L2"_alg;
             return;
         }
     }
 
     // SD_RIGHT
     if (m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT] == WHITE) {             // bottom
-        moves.append(ROT_R); moves.append(ROT_F); moves.append(ROT_D); moves.append(ROT_FCCW);
+        moves += "R F D F'"_alg;
         return;
     }
     if (m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_RIGHT] == WHITE) {   // up
-        moves.append(ROT_R); moves.append(ROT_BCCW); moves.append(ROT_D); moves.append(ROT_B);
+        moves += "R B' D B"_alg;
         return;
     }
     if (m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_RIGHT] == WHITE) {             // right
@@ -1056,9 +1041,7 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_B);
         }
         else {
-            moves.append(ROT_BCCW);
-            moves.append(ROT_D);
-            moves.append(ROT_B);
+            moves += "B' D B"_alg;
         }
         return;
     }
@@ -1068,20 +1051,18 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_FCCW);
         }
         else {
-            moves.append(ROT_F);
-            moves.append(ROT_D);
-            moves.append(ROT_FCCW);
+            moves += "F D F'"_alg;
         }
         return;
     }
 
     // SD_LEFT
     if (m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT] == WHITE) {                        // bottom
-        moves.append(ROT_L); moves.append(ROT_B); moves.append(ROT_D); moves.append(ROT_BCCW);
+        moves += "L B D B'"_alg;
         return;
     }
     if (m_pPieces[0][cube_size-1][cube_mid_pos]->m_nSideColor[SD_LEFT] == WHITE) {              // up
-        moves.append(ROT_L); moves.append(ROT_FCCW); moves.append(ROT_D); moves.append(ROT_F);
+        moves += "L F' D F"_alg;
         return;
     }
     if (m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_LEFT] == WHITE) {              // right
@@ -1090,9 +1071,7 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_F);
         }
         else {
-            moves.append(ROT_FCCW);
-            moves.append(ROT_D);
-            moves.append(ROT_F);
+            moves += "F' D F"_alg;
         }
         return;
     }
@@ -1102,20 +1081,18 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_BCCW);
         }
         else {
-            moves.append(ROT_B);
-            moves.append(ROT_D);
-            moves.append(ROT_BCCW);
+            moves += "B D B'"_alg;
         }
         return;
     }
 
     // SD_FRONT
     if (m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT] == WHITE) {             // bottom
-        moves.append(ROT_F); moves.append(ROT_L); moves.append(ROT_D); moves.append(ROT_LCCW);
+        moves += "F L D L'"_alg;
         return;
     }
     if (m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT] == WHITE) {   // up
-        moves.append(ROT_F); moves.append(ROT_RCCW); moves.append(ROT_D); moves.append(ROT_R);
+        moves += "F R' D R"_alg;
         return;
     }
     if (m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] == WHITE) {   // right
@@ -1124,9 +1101,7 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_R);
         }
         else {
-            moves.append(ROT_RCCW);
-            moves.append(ROT_D);
-            moves.append(ROT_R);
+            moves += "R' D R"_alg;
         }
         return;
     }
@@ -1136,20 +1111,18 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_LCCW);
         }
         else {
-            moves.append(ROT_L);
-            moves.append(ROT_D);
-            moves.append(ROT_LCCW);
+            moves += "L D L'"_alg;
         }
         return;
     }
 
     // SD_BACK
     if (m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK] == WHITE) {                        // bottom
-        moves.append(ROT_B); moves.append(ROT_R); moves.append(ROT_D); moves.append(ROT_RCCW);
+        moves += "B R D R'"_alg;
         return;
     }
     if (m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_BACK] == WHITE) {              // up
-        moves.append(ROT_B); moves.append(ROT_LCCW); moves.append(ROT_D); moves.append(ROT_L);
+        moves += "B L' D L"_alg;
         return;
     }
     if (m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_BACK] == WHITE) {                        // right
@@ -1158,9 +1131,7 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_L);
         }
         else {
-            moves.append(ROT_LCCW);
-            moves.append(ROT_D);
-            moves.append(ROT_L);
+            moves += "L' D L"_alg;
         }
         return;
     }
@@ -1170,378 +1141,104 @@ void TCube::arrangeWhiteCross(void)
             moves.append(ROT_RCCW);
         }
         else {
-            moves.append(ROT_R);
-            moves.append(ROT_D);
-            moves.append(ROT_RCCW);
+            moves += "R D R'"_alg;
         }
         return;
     }
 
 }
 
+//---------------------------------------------------------------------------
+// A corner of the bottom layer with the WHITE color is turned under the place between the centers of its other two
+// colors and inserted by the algorithm of the side its WHITE faces. When there is no such corner, a wrong corner of
+// the top layer is taken out to the bottom. Every call adds one algorithm or one turn of D, so the stage cannot loop
 //---------------------------------------------------------------------------
 void TCube::arrangeWhiteCrossCorners(void)
 {
-    SIDECOLOR color;
-    bool RotDownSide = false;
-
-    secondLayerBottomRotations = 0;
-
-    // SD_RIGHT
-    color = m_pPieces[cube_size-1][cube_size-1][cube_size-1]->m_nSideColor[SD_RIGHT];
-    if ((color == WHITE) ||
-        ((m_pPieces[cube_size-1][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_RIGHT] != color)))  {  //TL
-        moves.append(ROT_RCCW); moves.append(ROT_DCCW); moves.append(ROT_R);
-        return;
-    }
-    color = m_pPieces[cube_size-1][cube_size-1][0]->m_nSideColor[SD_RIGHT];
-    if ((color == WHITE) ||
-        ((m_pPieces[cube_size-1][cube_size-1][0]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_RIGHT] != color)))  {  //TR
-        moves.append(ROT_R); moves.append(ROT_D); moves.append(ROT_RCCW);
-        return;
-    }
-    if (m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_RIGHT] == WHITE) {                            // BR
-        color = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_BACK];
-        if (color == (m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_BACK])) {
-            moves.append(ROT_DCCW); moves.append(ROT_BCCW); moves.append(ROT_D); moves.append(ROT_B);
-            return;
-        }
-        else {
-            RotDownSide = true;
-        }
-    }
-    if (m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_RIGHT] == WHITE) {                  // BL
-        color = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_FRONT];
-        if (color == (m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT])) {
-            moves.append(ROT_D); moves.append(ROT_F); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
-            return;
-        }
-        else {
-            RotDownSide = true;
-        }
-    }
-
-    // SD_LEFT
-    color = m_pPieces[0][cube_size-1][0]->m_nSideColor[SD_LEFT];
-    if ((color == WHITE) ||
-        ((m_pPieces[0][cube_size-1][0]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[0][cube_size-1][cube_mid_pos]->m_nSideColor[SD_LEFT] != color)))  {             // TL
-        moves.append(ROT_LCCW); moves.append(ROT_DCCW); moves.append(ROT_L);
-        return;
-    }
-    color = m_pPieces[0][cube_size-1][cube_size-1]->m_nSideColor[SD_LEFT];
-    if ((color == WHITE) ||
-        ((m_pPieces[0][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[0][cube_size-1][cube_mid_pos]->m_nSideColor[SD_LEFT] != color)))  {             // TR
-        moves.append(ROT_L); moves.append(ROT_D); moves.append(ROT_LCCW);
-        return;
-    }
-    if (m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_LEFT] == WHITE) {                             // BR
-        color = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_FRONT];
-        if (color == (m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT])) {
-            moves.append(ROT_DCCW); moves.append(ROT_FCCW); moves.append(ROT_D); moves.append(ROT_F);
-            return;
-        }
-        else {
-            RotDownSide = true;
-        }
-    }
-    if (m_pPieces[0][0][0]->m_nSideColor[SD_LEFT] == WHITE) {                                       // BL
-        color = m_pPieces[0][0][0]->m_nSideColor[SD_BACK];
-        if (color == (m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_BACK])) {
-            moves.append(ROT_D); moves.append(ROT_B); moves.append(ROT_DCCW); moves.append(ROT_BCCW);
-            return;
-        }
-        else {
-            RotDownSide = true;
-        }
-    }
+    static const TAlgorithm whiteOnSide[4] = { "R' D' R"_alg, "F' D' F"_alg, "L' D' L"_alg, "B' D' B"_alg };
+    static const TAlgorithm whiteOnNext[4] = { "F D F'"_alg, "L D L'"_alg, "B D B'"_alg, "R D R'"_alg };
+    static const TAlgorithm whiteOnBottom[4] = { "R' D2 R D R' D' R"_alg, "F' D2 F D F' D' F"_alg, "L' D2 L D L' D' L"_alg, "B' D2 B D B' D' B"_alg };
+    SIDECOLOR center[4];
+    bool bBottomCorner = false;
+    int i;
 
-    // SD_FRONT
-    color = m_pPieces[0][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT];
-    if ((color == WHITE) ||
-        ((m_pPieces[0][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT] != color)))  {  // TL
-        moves.append(ROT_FCCW); moves.append(ROT_DCCW); moves.append(ROT_F);
+    for (i=0; i<4; i++) center[i] = centerColor(g_nAroundSides[i]);
+
+    for (i=0; i<4; i++) {
+        const TCubePiece* pCorner = m_pPieces[g_nSlotPos[i][0]][0][g_nSlotPos[i][1]];
+        SIDECOLOR sideColor = pCorner->m_nSideColor[g_nAroundSides[i]];
+        SIDECOLOR nextColor = pCorner->m_nSideColor[g_nAroundSides[(i+1)%4]];
+        SIDECOLOR bottomColor = pCorner->m_nSideColor[SD_BOTTOM];
+        if (sideColor != WHITE && nextColor != WHITE && bottomColor != WHITE) continue;
+        bBottomCorner = true;
+        int nMatching = (sideColor == center[i] || sideColor == center[(i+1)%4]) +
+                        (nextColor == center[i] || nextColor == center[(i+1)%4]) +
+                        (bottomColor == center[i] || bottomColor == center[(i+1)%4]);
+        if (nMatching < 2) continue;                                            // not under its place yet
+        if (sideColor == WHITE) moves += whiteOnSide[i];
+        else if (nextColor == WHITE) moves += whiteOnNext[i];
+        else moves += whiteOnBottom[i];
         return;
     }
-    color = m_pPieces[cube_size-1][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT];
-    if ((color == WHITE) ||
-        ((m_pPieces[cube_size-1][cube_size-1][cube_size-1]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[cube_mid_pos][cube_size-1][cube_size-1]->m_nSideColor[SD_FRONT] != color)))  {  // TR
-        moves.append(ROT_F); moves.append(ROT_D); moves.append(ROT_FCCW);
+    if (bBottomCorner) {
+        moves.append(ROT_D);
         return;
     }
-    if (m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_FRONT] == WHITE) {                  // BR
-        color = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_RIGHT];
-        if (color == (m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_RIGHT])) {
-            moves.append(ROT_DCCW); moves.append(ROT_RCCW); moves.append(ROT_D); moves.append(ROT_R);
-            return;
-        }
-        else {
-            RotDownSide = true;
-        }
-    }
-    if (m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_FRONT] == WHITE) {                            // BL
-        color = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_LEFT];
-        if (color == (m_pPieces[0][cube_size-1][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-            moves.append(ROT_D); moves.append(ROT_L); moves.append(ROT_DCCW); moves.append(ROT_LCCW);
-            return;
-        }
-        else {
-            RotDownSide = true;
-        }
-    }
 
-    // SD_BACK
-    color = m_pPieces[cube_size-1][cube_size-1][0]->m_nSideColor[SD_BACK];
-    if ((color == WHITE) ||
-        ((m_pPieces[cube_size-1][cube_size-1][0]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_BACK] != color)))  {             // TL
-        moves.append(ROT_BCCW); moves.append(ROT_DCCW); moves.append(ROT_B);
-        return;
-    }
-    color = m_pPieces[0][cube_size-1][0]->m_nSideColor[SD_BACK];
-    if ((color == WHITE) ||
-        ((m_pPieces[0][cube_size-1][0]->m_nSideColor[SD_TOP] == WHITE) &&
-         (m_pPieces[cube_mid_pos][cube_size-1][0]->m_nSideColor[SD_BACK] != color)))  {             // TR
-        moves.append(ROT_B); moves.append(ROT_D); moves.append(ROT_BCCW);
-        return;
-    }
-    if (m_pPieces[0][0][0]->m_nSideColor[SD_BACK] == WHITE) {                                       // BR
-        color = m_pPieces[0][0][0]->m_nSideColor[SD_LEFT];
-        if (color == (m_pPieces[0][cube_size-1][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-            moves.append(ROT_DCCW); moves.append(ROT_LCCW); moves.append(ROT_D); moves.append(ROT_L);
-            return;
-        }
-        else {
-            RotDownSide = true;
-        }
-    }
-    if (m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_BACK] == WHITE) {                             // BL
-        color = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_RIGHT];
-        if (color == (m_pPieces[cube_size-1][cube_size-1][cube_mid_pos]->m_nSideColor[SD_RIGHT])) {
-            moves.append(ROT_D); moves.append(ROT_R); moves.append(ROT_DCCW); moves.append(ROT_RCCW);
+    for (i=0; i<4; i++) {
+        const TCubePiece* pCorner = m_pPieces[g_nSlotPos[i][0]][cube_size-1][g_nSlotPos[i][1]];
+        if (pCorner->m_nSideColor[SD_TOP] != WHITE || pCorner->m_nSideColor[g_nAroundSides[i]] != center[i] ||
+            pCorner->m_nSideColor[g_nAroundSides[(i+1)%4]] != center[(i+1)%4]) {
+            moves += whiteOnSide[i];                                            // the same turns take the corner down
             return;
         }
-        else {
-            RotDownSide = true;
-        }
-    }
-
-    if (RotDownSide) {
-        moves.append(ROT_D);
-        return;
-    }
-
-    // SD_BOTTOM
-    if (m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_BOTTOM] == WHITE) {                           // TL
-        moves.append(ROT_FCCW); moves.append(ROT_D); moves.append(ROT_F);
-        return;
-    }
-    if (m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_BOTTOM] == WHITE) {                 // TR
-        moves.append(ROT_F); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
-        return;
-    }
-    if (m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_BOTTOM] == WHITE) {                           // BR
-        moves.append(ROT_R); moves.append(ROT_D); moves.append(ROT_RCCW);
-        return;
-    }
-    if (m_pPieces[0][0][0]->m_nSideColor[SD_BOTTOM] == WHITE) {                                     // BL
-        moves.append(ROT_LCCW); moves.append(ROT_DCCW); moves.append(ROT_L);
-        return;
     }
 }
 
+//---------------------------------------------------------------------------
+// An edge of the bottom layer without the BLUE color is turned under the center of its side color and inserted to
+// the side of its bottom color. When there is no such edge, a wrong edge of the second layer is taken out by
+// inserting any bottom edge in its place. Every call adds one algorithm or one turn of D, so the stage cannot loop
 //---------------------------------------------------------------------------
 void TCube::arrangeSecondLayer(void)
 {
-    SIDECOLOR color;
-    SIDECOLOR color2;
-    bool RotDownSide = false;
-
-    color = m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT];
+    static const TAlgorithm toNext[4] = {                                       // the edge under a side to the slot of the next side
+        "D F D' F' R F' R' F"_alg, "D L D' L' F L' F' L"_alg, "D B D' B' L B' L' B"_alg, "D R D' R' B R' B' R"_alg };
+    static const TAlgorithm toPrevious[4] = {                                   // and to the slot of the previous side
+        "D' B' D B R' B R B'"_alg, "D' R' D R F' R F R'"_alg, "D' F' D F L' F L F'"_alg, "D' L' D L B' L B L'"_alg };
+    SIDECOLOR center[4];
+    bool bBottomEdge = false;
+    int i;
 
-    if (secondLayerBottomRotations > 3) {
-        if (color != m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_RIGHT]) {
-            moves.append(ROT_DCCW); moves.append(ROT_BCCW); moves.append(ROT_D); moves.append(ROT_B);
-            moves.append(ROT_RCCW); moves.append(ROT_B); moves.append(ROT_R); moves.append(ROT_BCCW);
+    for (i=0; i<4; i++) center[i] = centerColor(g_nAroundSides[i]);
+
+    for (i=0; i<4; i++) {
+        const TCubePiece* pEdge = m_pPieces[g_nSidePos[i][0]][0][g_nSidePos[i][1]];
+        SIDECOLOR sideColor = pEdge->m_nSideColor[g_nAroundSides[i]];
+        SIDECOLOR bottomColor = pEdge->m_nSideColor[SD_BOTTOM];
+        if (sideColor == BLUE || bottomColor == BLUE) continue;                 // an edge of the last layer
+        bBottomEdge = true;
+        if (sideColor != center[i]) continue;
+        if (bottomColor == center[(i+1)%4]) {
+            moves += toNext[i];
             return;
         }
-        if (color != m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_RIGHT]) {
-            moves.append(ROT_D); moves.append(ROT_F); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
-            moves.append(ROT_R); moves.append(ROT_FCCW); moves.append(ROT_RCCW); moves.append(ROT_F);
+        if (bottomColor == center[(i+3)%4]) {
+            moves += toPrevious[i];
             return;
         }
     }
-
-
-    if (color == m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT]) {
-        color = m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM];
-        if (color != BLUE) {
-            if (color == m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK]) {
-                moves.append(ROT_DCCW); moves.append(ROT_BCCW); moves.append(ROT_D); moves.append(ROT_B);
-                moves.append(ROT_RCCW); moves.append(ROT_B); moves.append(ROT_R); moves.append(ROT_BCCW);
-                return;
-            }
-            if (color == m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) {
-                moves.append(ROT_D); moves.append(ROT_F); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
-                moves.append(ROT_R); moves.append(ROT_FCCW); moves.append(ROT_RCCW); moves.append(ROT_F);
-                return;
-            }
-        }
-    }
-    else {
-        RotDownSide = true;
-    }
-
-    color = m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT];
-    if (color == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT]) {
-        color = m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM];
-        if (color != BLUE) {
-            if (color == m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) {
-                moves.append(ROT_DCCW); moves.append(ROT_FCCW); moves.append(ROT_D); moves.append(ROT_F);
-                moves.append(ROT_LCCW); moves.append(ROT_F); moves.append(ROT_L); moves.append(ROT_FCCW);
-                return;
-            }
-            if (color == m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK]) {
-                moves.append(ROT_D); moves.append(ROT_B); moves.append(ROT_DCCW); moves.append(ROT_BCCW);
-                moves.append(ROT_L); moves.append(ROT_BCCW); moves.append(ROT_LCCW); moves.append(ROT_B);
-                return;
-            }
-        }
-    }
-    else {
-        RotDownSide = true;
-    }
-
-    color = m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT];
-    if (color == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) {
-        color = m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM];
-        if (color != BLUE) {
-            if (color == m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT]) {
-                moves.append(ROT_DCCW); moves.append(ROT_RCCW); moves.append(ROT_D); moves.append(ROT_R);
-                moves.append(ROT_FCCW); moves.append(ROT_R); moves.append(ROT_F); moves.append(ROT_RCCW);
-                return;
-            }
-            if (color == m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT]) {
-                moves.append(ROT_D); moves.append(ROT_L); moves.append(ROT_DCCW); moves.append(ROT_LCCW);
-                moves.append(ROT_F); moves.append(ROT_LCCW); moves.append(ROT_FCCW); moves.append(ROT_L);
-                return;
-            }
-        }
-    }
-    else {
-        RotDownSide = true;
-    }
-
-    color = m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK];
-    if (color == m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK]) {
-        color = m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BOTTOM];
-        if (color != BLUE) {
-            if (color == m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT]) {
-                moves.append(ROT_DCCW); moves.append(ROT_LCCW); moves.append(ROT_D); moves.append(ROT_L);
-                moves.append(ROT_BCCW); moves.append(ROT_L); moves.append(ROT_B); moves.append(ROT_LCCW);
-                return;
-            }
-            if (color == m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT]) {
-                moves.append(ROT_D); moves.append(ROT_R); moves.append(ROT_DCCW); moves.append(ROT_RCCW);
-                moves.append(ROT_B); moves.append(ROT_RCCW); moves.append(ROT_BCCW); moves.append(ROT_R);
-                return;
-            }
-        }
-    }
-    else {
-        RotDownSide = true;
-    }
-
-
-    color = m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT];
-    color2 = m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK];
-    if (((color == m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_BACK]) &&
-         (color2 == m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_RIGHT])) ||
-        ((color == m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_RIGHT]) &&
-         (color2 != m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_BACK]))) {
-        moves.append(ROT_DCCW); moves.append(ROT_BCCW); moves.append(ROT_D); moves.append(ROT_B);
-        moves.append(ROT_RCCW); moves.append(ROT_B); moves.append(ROT_R); moves.append(ROT_BCCW);
-        return;
-    }
-    color2 = m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT];
-    if (((color == m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) &&
-         (color2 == m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_RIGHT])) ||
-        ((color == m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_RIGHT]) &&
-         (color2 != m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]))) {
-        moves.append(ROT_D); moves.append(ROT_F); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
-        moves.append(ROT_R); moves.append(ROT_FCCW); moves.append(ROT_RCCW); moves.append(ROT_F);
-        return;
-    }
-
-    color = m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT];
-    color2 = m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT];
-    if (((color == m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) &&
-         (color2 == m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_LEFT]))  ||
-        ((color == m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_LEFT]) &&
-         (color2 != m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]))) {
-        moves.append(ROT_DCCW); moves.append(ROT_FCCW); moves.append(ROT_D); moves.append(ROT_F);
-        moves.append(ROT_LCCW); moves.append(ROT_F); moves.append(ROT_L); moves.append(ROT_FCCW);
-        return;
-    }
-    color2 = m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK];
-    if (((color == m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_BACK]) &&
-         (color2 == m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_LEFT]))  ||
-        ((color == m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_LEFT]) &&
-         (color2 != m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_BACK]))) {
-        moves.append(ROT_D); moves.append(ROT_B); moves.append(ROT_DCCW); moves.append(ROT_BCCW);
-        moves.append(ROT_L); moves.append(ROT_BCCW); moves.append(ROT_LCCW); moves.append(ROT_B);
-        return;
-    }
-
-    color = m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT];
-    color2 = m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT];
-    if (((color == m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_RIGHT]) &&
-         (color2 == m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]))  ||
-        ((color == m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) &&
-         (color2 != m_pPieces[cube_size-1][cube_mid_pos][cube_size-1]->m_nSideColor[SD_RIGHT]))) {
-        moves.append(ROT_DCCW); moves.append(ROT_RCCW); moves.append(ROT_D); moves.append(ROT_R);
-        moves.append(ROT_FCCW); moves.append(ROT_R); moves.append(ROT_F); moves.append(ROT_RCCW);
-        return;
-    }
-    color2 = m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT];
-    if (((color == m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_LEFT]) &&
-         (color2 == m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]))  ||
-        ((color == m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT]) &&
-         (color2 != m_pPieces[0][cube_mid_pos][cube_size-1]->m_nSideColor[SD_LEFT]))) {
-        moves.append(ROT_D); moves.append(ROT_L); moves.append(ROT_DCCW); moves.append(ROT_LCCW);
-        moves.append(ROT_F); moves.append(ROT_LCCW); moves.append(ROT_FCCW); moves.append(ROT_L);
-        return;
-    }
-
-    color = m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK];
-    color2 = m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT];
-    if (((color == m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_LEFT]) &&
-         (color2 == m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_BACK]))  ||
-        ((color == m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_BACK]) &&
-         (color2 != m_pPieces[0][cube_mid_pos][0]->m_nSideColor[SD_LEFT]))) {
-        moves.append(ROT_DCCW); moves.append(ROT_LCCW); moves.append(ROT_D); moves.append(ROT_L);
-        moves.append(ROT_BCCW); moves.append(ROT_L); moves.append(ROT_B); moves.append(ROT_LCCW);
-        return;
-    }
-    color2 = m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT];
-    if (((color == m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_RIGHT]) &&
-         (color2 == m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_BACK]))  ||
-        ((color == m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_BACK]) &&
-         (color2 != m_pPieces[cube_size-1][cube_mid_pos][0]->m_nSideColor[SD_RIGHT]))) {
-        moves.append(ROT_D); moves.append(ROT_R); moves.append(ROT_DCCW); moves.append(ROT_RCCW);
-        moves.append(ROT_B); moves.append(ROT_RCCW); moves.append(ROT_BCCW); moves.append(ROT_R);
+    if (bBottomEdge) {                                                          // no edge is under its center yet
+        moves.append(ROT_D);
         return;
     }
 
-    if (RotDownSide) {
-        moves.append(ROT_D);
-        secondLayerBottomRotations++;
-        return;
+    for (i=0; i<4; i++) {
+        const TCubePiece* pSlot = m_pPieces[g_nSlotPos[i][0]][cube_mid_pos][g_nSlotPos[i][1]];
+        if (pSlot->m_nSideColor[g_nAroundSides[i]] != center[i] || pSlot->m_nSideColor[g_nAroundSides[(i+1)%4]] != center[(i+1)%4]) {
+            moves += toNext[i];                                                 // the wrong edge goes down, a last layer edge takes its place
+            return;
+        }
     }
 }
 
@@ -1553,8 +1250,7 @@ void TCube::arrangeBlueCross(void)
         (BLUE != m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM]) &&
         (BLUE != m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM])) {
 
-        moves.append(ROT_F); moves.append(ROT_L); moves.append(ROT_D);
-        moves.append(ROT_LCCW); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
+        moves += "F L D L' D' F'"_alg;
         return;
     }
 
@@ -1563,8 +1259,7 @@ void TCube::arrangeBlueCross(void)
         (BLUE != m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM]) &&
         (BLUE != m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM])) {
 
-        moves.append(ROT_F); moves.append(ROT_L); moves.append(ROT_D);
-        moves.append(ROT_LCCW); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
+        moves += "F L D L' D' F'"_alg;
         return;
     }
 
@@ -1573,8 +1268,7 @@ void TCube::arrangeBlueCross(void)
         (BLUE == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM]) &&
         (BLUE != m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM])) {
 
-        moves.append(ROT_L); moves.append(ROT_B); moves.append(ROT_D);
-        moves.append(ROT_BCCW); moves.append(ROT_DCCW); moves.append(ROT_LCCW);
+        moves += "L B D B' D' L'"_alg;
         return;
     }
 
@@ -1583,8 +1277,7 @@ void TCube::arrangeBlueCross(void)
         (BLUE != m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM]) &&
         (BLUE == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM])) {
 
-        moves.append(ROT_R); moves.append(ROT_F); moves.append(ROT_D);
-        moves.append(ROT_FCCW); moves.append(ROT_DCCW); moves.append(ROT_RCCW);
+        moves += "R F D F' D' R'"_alg;
         return;
     }
 
@@ -1593,8 +1286,7 @@ void TCube::arrangeBlueCross(void)
         (BLUE == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM]) &&
         (BLUE == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM])) {
 
-        moves.append(ROT_B); moves.append(ROT_R); moves.append(ROT_D);
-        moves.append(ROT_RCCW); moves.append(ROT_DCCW); moves.append(ROT_BCCW);
+        moves += "B R D R' D' B'"_alg;
         return;
     }
 
@@ -1603,8 +1295,7 @@ void TCube::arrangeBlueCross(void)
         (BLUE != m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM]) &&
         (BLUE == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM])) {
 
-        moves.append(ROT_F); moves.append(ROT_L); moves.append(ROT_D);
-        moves.append(ROT_LCCW); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
+        moves += "F L D L' D' F'"_alg;
         return;
     }
 
@@ -1613,14 +1304,17 @@ void TCube::arrangeBlueCross(void)
         (BLUE == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_BOTTOM]) &&
         (BLUE != m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_BOTTOM])) {
 
-        moves.append(ROT_L); moves.append(ROT_B); moves.append(ROT_D);
-        moves.append(ROT_BCCW); moves.append(ROT_DCCW); moves.append(ROT_LCCW);
+        moves += "L B D B' D' L'"_alg;
         return;
     }
 }
 
 //---------------------------------------------------------------------------
-void TCube::arrangeEdgePermutationOfBlueCross(void)
+// Checking which case of the edge permutation matches the current alignment of the bottom layer
+// The function returns false if no case matches; the algorithm for the matching case is written to alg
+// (an empty one when the edges are already in place)
+//---------------------------------------------------------------------------
+bool TCube::edgePermutationOfBlueCrossCase(TAlgorithm& alg)
 {
     int cnt = 0;
 
@@ -1629,133 +1323,136 @@ void TCube::arrangeEdgePermutationOfBlueCross(void)
     if (m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) cnt++;
     if (m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT] == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT]) cnt++;
 
-    if (cnt < 2) {
-        moves.append(ROT_D);
-        return;
-    }
+    alg = TAlgorithm();
+    if (cnt == 4) return true;                                                  // the edges are already in place
+    if (cnt < 2) return false;
 
     if ((m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK] != m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK]) &&
         (m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT] != m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT]) &&
         (m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) &&
         (m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT] == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-        moves.append(ROT_F); moves.append(ROT_D); moves.append(ROT_FCCW); moves.append(ROT_D);
-        moves.append(ROT_F); moves.append(ROT_D); moves.append(ROT_D); moves.append(ROT_FCCW); moves.append(ROT_D);
-        return;
+        alg = "F D F' D F D2 F' D"_alg;
+        return true;
     }
 
     if ((m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK] == m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK]) &&
         (m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT] != m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT]) &&
         (m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] != m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) &&
         (m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT] == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-        moves.append(ROT_L); moves.append(ROT_D); moves.append(ROT_LCCW); moves.append(ROT_D);
-        moves.append(ROT_L); moves.append(ROT_D); moves.append(ROT_D); moves.append(ROT_LCCW); moves.append(ROT_D);
-        return;
+        alg = "L D L' D L D2 L' D"_alg;
+        return true;
     }
 
     if ((m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK] == m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK]) &&
         (m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT] == m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT]) &&
         (m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] != m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) &&
         (m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT] != m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-        moves.append(ROT_B); moves.append(ROT_D); moves.append(ROT_BCCW); moves.append(ROT_D);
-        moves.append(ROT_B); moves.append(ROT_D); moves.append(ROT_D); moves.append(ROT_BCCW); moves.append(ROT_D);
-        return;
+        alg = "B D B' D B D2 B' D"_alg;
+        return true;
     }
 
     if ((m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK] != m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK]) &&
         (m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT] == m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT]) &&
         (m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) &&
         (m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT] != m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-        moves.append(ROT_R); moves.append(ROT_D); moves.append(ROT_RCCW); moves.append(ROT_D);
-        moves.append(ROT_R); moves.append(ROT_D); moves.append(ROT_D); moves.append(ROT_RCCW); moves.append(ROT_D);
-        return;
+        alg = "R D R' D R D2 R' D"_alg;
+        return true;
     }
 
     if ((m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK] == m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK]) &&
         (m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] == m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) &&
         (m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT] != m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT]) &&
         (m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT] != m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-        moves.append(ROT_L); moves.append(ROT_D); moves.append(ROT_LCCW); moves.append(ROT_D);
-        moves.append(ROT_L); moves.append(ROT_D); moves.append(ROT_D); moves.append(ROT_LCCW);
-        return;
+        alg = "L D L' D L D2 L'"_alg;
+        return true;
     }
 
     if ((m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK] != m_pPieces[cube_mid_pos][0][0]->m_nSideColor[SD_BACK]) &&
         (m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT] != m_pPieces[cube_mid_pos][0][cube_size-1]->m_nSideColor[SD_FRONT]) &&
         (m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT] == m_pPieces[cube_size-1][0][cube_mid_pos]->m_nSideColor[SD_RIGHT]) &&
         (m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT] == m_pPieces[0][0][cube_mid_pos]->m_nSideColor[SD_LEFT])) {
-        moves.append(ROT_F); moves.append(ROT_D); moves.append(ROT_FCCW); moves.append(ROT_D);
-        moves.append(ROT_F); moves.append(ROT_D); moves.append(ROT_D); moves.append(ROT_FCCW);
-        return;
+        alg = "F D F' D F D2 F'"_alg;
+        return true;
     }
 
+    return false;
 }
 
 //---------------------------------------------------------------------------
-void TCube::permutationOfBlueCorners(void)
+// Appending the bottom layer rotation that brings it to the given alignment (number of ROT_D turns)
+//---------------------------------------------------------------------------
+static void appendBottomAlignment(QVector<ROTATIONS>& alg, int nAlignment)
 {
-    SIDECOLOR color1, color2, color3;
-    SIDECOLOR colorBottom, colorLeft, colorBack, colorRight, colorFront;
-
-    colorBottom = BLUE;
-    colorLeft   = m_pPieces[0][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_LEFT];
-    colorBack   = m_pPieces[cube_mid_pos][cube_mid_pos][0]->m_nSideColor[SD_BACK];
-    colorRight  = m_pPieces[cube_size-1][cube_mid_pos][cube_mid_pos]->m_nSideColor[SD_RIGHT];
-    colorFront  = m_pPieces[cube_mid_pos][cube_mid_pos][cube_size-1]->m_nSideColor[SD_FRONT];
-
-    color1 = m_pPieces[0][0][0]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[0][0][0]->m_nSideColor[SD_LEFT];
-    color3 = m_pPieces[0][0][0]->m_nSideColor[SD_BACK];
-
-    if (((color1 == colorBottom) || (color1 == colorLeft) || (color1 == colorBack)) &&
-        ((color2 == colorBottom) || (color2 == colorLeft) || (color2 == colorBack)) &&
-        ((color3 == colorBottom) || (color3 == colorLeft) || (color3 == colorBack))) {
-        moves.append(ROT_D); moves.append(ROT_F); moves.append(ROT_DCCW); moves.append(ROT_BCCW);
-        moves.append(ROT_D); moves.append(ROT_FCCW); moves.append(ROT_DCCW); moves.append(ROT_B);
-        return;
+    switch (nAlignment & 3) {
+    case 1 : alg.append(ROT_D); break;
+    case 2 : alg += "D2"_alg; break;
+    case 3 : alg.append(ROT_DCCW); break;
     }
+}
 
-    color1 = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_RIGHT];
-    color3 = m_pPieces[cube_size-1][0][0]->m_nSideColor[SD_BACK];
-
-    if (((color1 == colorBottom) || (color1 == colorRight) || (color1 == colorBack)) &&
-        ((color2 == colorBottom) || (color2 == colorRight) || (color2 == colorBack)) &&
-        ((color3 == colorBottom) || (color3 == colorRight) || (color3 == colorBack))) {
-        moves.append(ROT_D); moves.append(ROT_R); moves.append(ROT_DCCW); moves.append(ROT_LCCW);
-        moves.append(ROT_D); moves.append(ROT_RCCW); moves.append(ROT_DCCW); moves.append(ROT_L);
-        return;
+//---------------------------------------------------------------------------
+// All four alignments of the bottom layer are checked on a copy of the cube. The algorithm of each matching case is
+// applied to the copy at once by its facelet permutation, so the alignments after which the edges are really in place
+// are preferred; of them the shortest pre-alignment together with the algorithm is added to the queue in one step
+//---------------------------------------------------------------------------
+void TCube::arrangeEdgePermutationOfBlueCross(void)
+{
+    static const int nAlignmentMoves[] = { 0, 1, 2, 1 };                        // number of moves needed for each alignment
+    TCube state(*this), result(*this);
+    TAlgorithm alg, bestAlg;
+    int nCost, nBestCost = -1, nBestAlignment = 0;
+
+    for (int nAlignment=0; nAlignment<4; nAlignment++) {
+        if (state.edgePermutationOfBlueCrossCase(alg)) {
+            result.copyState(state);
+            result.applyPermutation(alg.m_Permutation);
+            nCost = nAlignmentMoves[nAlignment] + alg.length();
+            if (!result.checkEdgePermutationOfBlueCross(SD_TOP)) nCost += ALG_MAX_MOVES;   // the next pass of this stage will be needed
+            if (nBestCost < 0 || nCost < nBestCost) {
+                nBestCost = nCost;
+                nBestAlignment = nAlignment;
+                bestAlg = alg;
+            }
+        }
+        state.RotateD(FALSE);                                                   // ROT_D on the copy, without animation
     }
 
-    color1 = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_RIGHT];
-    color3 = m_pPieces[cube_size-1][0][cube_size-1]->m_nSideColor[SD_FRONT];
-
-    if (((color1 == colorBottom) || (color1 == colorRight) || (color1 == colorFront)) &&
-        ((color2 == colorBottom) || (color2 == colorRight) || (color2 == colorFront)) &&
-        ((color3 == colorBottom) || (color3 == colorRight) || (color3 == colorFront))) {
-        moves.append(ROT_D); moves.append(ROT_B); moves.append(ROT_DCCW); moves.append(ROT_FCCW);
-        moves.append(ROT_D); moves.append(ROT_BCCW); moves.append(ROT_DCCW); moves.append(ROT_F);
+    if (nBestCost < 0) {
+        moves.append(ROT_D);
         return;
     }
+    appendBottomAlignment(moves, nBestAlignment);
+    moves += bestAlg;
+}
 
-    color1 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_BOTTOM];
-    color2 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_LEFT];
-    color3 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_FRONT];
+//---------------------------------------------------------------------------
+// Each algorithm cycles three corners of the bottom layer and keeps the fourth one. All four are tried on a copy of
+// the cube: the one that places all the corners is taken, otherwise the one that leaves the most corners in place.
+// With the edges in place the corners form an even permutation, so no corner placed becomes one placed and one
+// placed becomes all four after at most two calls - the stage cannot loop
+//---------------------------------------------------------------------------
+void TCube::permutationOfBlueCorners(void)
+{
+    static const TAlgorithm algs[4] = { "D F D' B' D F' D' B"_alg, "D R D' L' D R' D' L"_alg, "D B D' F' D B' D' F"_alg, "D L D' R' D L' D' R"_alg };
+    TCube result(*this);
+    int i, nPlaced, nBest = 0, nBestPlaced = -1;
 
-    if (((color1 == colorBottom) || (color1 == colorLeft) || (color1 == colorFront)) &&
-        ((color2 == colorBottom) || (color2 == colorLeft) || (color2 == colorFront)) &&
-        ((color3 == colorBottom) || (color3 == colorLeft) || (color3 == colorFront))) {
-        moves.append(ROT_D); moves.append(ROT_L); moves.append(ROT_DCCW); moves.append(ROT_RCCW);
-        moves.append(ROT_D); moves.append(ROT_LCCW); moves.append(ROT_DCCW); moves.append(ROT_R);
-        return;
+    for (i=0; i<4; i++) {
+        result.copyState(*this);
+        result.applyPermutation(algs[i].m_Permutation);
+        nPlaced = result.placedBlueCorners();
+        if (nPlaced > nBestPlaced) {
+            nBestPlaced = nPlaced;
+            nBest = i;
+        }
     }
-
-    moves.append(ROT_D); moves.append(ROT_L); moves.append(ROT_DCCW); moves.append(ROT_RCCW);
-    moves.append(ROT_D); moves.append(ROT_LCCW); moves.append(ROT_DCCW); moves.append(ROT_R);
+    moves += algs[nBest];
 }
 
 //---------------------------------------------------------------------------
-void TCube::orientationOfBlueCorners(void)
+// Checking whether the corner in the front left position of the bottom layer is oriented
+//---------------------------------------------------------------------------
+bool TCube::isBlueCornerOriented(void)
 {
     SIDECOLOR color1, color2, color3;
     SIDECOLOR colorBottom, colorLeft, colorFront;
@@ -1768,8 +1465,37 @@ void TCube::orientationOfBlueCorners(void)
     color2 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_LEFT];
     color3 = m_pPieces[0][0][cube_size-1]->m_nSideColor[SD_FRONT];
 
-    if ((color1 != colorBottom) || (color2 != colorLeft) || (color3 != colorFront)) {
-        moves.append(ROT_LCCW); moves.append(ROT_UCCW); moves.append(ROT_L); moves.append(ROT_U);
+    return (color1 == colorBottom) && (color2 == colorLeft) && (color3 == colorFront);
+}
+
+//---------------------------------------------------------------------------
+// The bottom layer is turned straight to the nearest twisted corner (checked on a copy of the cube),
+// and when all corners are oriented, straight to the alignment in which the cube is solved. L' U' L U is added twice:
+// only then the corner stays in its place, after a single one another piece may look oriented there
+//---------------------------------------------------------------------------
+void TCube::orientationOfBlueCorners(void)
+{
+    static const int nAlignmentMoves[] = { 0, 1, 2, 1 };                        // number of moves needed for each alignment
+    TCube state(*this);
+    int nAlignment, nTwisted = -1, nSolved = -1;
+
+    for (nAlignment=0; nAlignment<4; nAlignment++) {
+        if (!state.isBlueCornerOriented()) {
+            if (nTwisted < 0 || nAlignmentMoves[nAlignment] < nAlignmentMoves[nTwisted]) nTwisted = nAlignment;
+        }
+        else if (nSolved < 0 && state.check()) {
+            nSolved = nAlignment;
+        }
+        state.RotateD(FALSE);                                                   // ROT_D on the copy, without animation
+    }
+
+    if (nTwisted >= 0) {
+        appendBottomAlignment(moves, nTwisted);
+        moves += "L' U' L U L' U' L U"_alg;
+        return;
+    }
+    if (nSolved >= 0) {
+        appendBottomAlignment(moves, nSolved);
         return;
     }
 
@@ -1779,48 +1505,31 @@ void TCube::orientationOfBlueCorners(void)
 //---------------------------------------------------------------------------
 //---------------------------------------------------------------------------
 //---------------------------------------------------------------------------
-bool TCube::solve(void)
+void TCube::setSolvingInterval(int interval)                                    // the copies of the cube are not connected to any view
 {
-    if (moves.length()) {
-        switch (moves.at(0)) {
-        case ROT_R    : RotateR(); break;
-        case ROT_RCCW : RotateRCCW(); break;
-        case ROT_L    : RotateL(); break;
-        case ROT_LCCW : RotateLCCW(); break;
-        case ROT_F    : RotateF(); break;
-        case ROT_FCCW : RotateFCCW(); break;
-        case ROT_B    : RotateB(); break;
-        case ROT_BCCW : RotateBCCW(); break;
-        case ROT_D    : RotateD(); break;
-        case ROT_DCCW : RotateDCCW(); break;
-        case ROT_U    : RotateU(); break;
-        case ROT_UCCW : RotateUCCW(); break;
-        }
-
-        moves.erase(moves.begin()+0);
-        return false;
-    }
-
-    if (blueEdgeOrientation) {
-        orientationOfBlueCorners();
-        return check();
-    }
+    if (view) view->setSolvingInterval(interval);
+}
 
+//---------------------------------------------------------------------------
+// Checking which stage of the LBL algorithm is not yet done and adding its moves to the queue
+//---------------------------------------------------------------------------
+void TCube::arrangeNextStage(void)
+{
     SIDE whiteCrossSide = findWhiteCrossSide();
 
     if (!checkWhiteCross(whiteCrossSide)) {
-        widget->setSolvingInterval(10);
+        setSolvingInterval(10);
         if (whiteCrossSide != SD_TOP) whiteCrossSideToTop(whiteCrossSide);
         else arrangeWhiteCross();
     }
     else {
         if (!checkWhiteCrossCorners(whiteCrossSide)) {
-            widget->setSolvingInterval(10);
+            setSolvingInterval(10);
             arrangeWhiteCrossCorners();
         }
         else {
             if (!checkSecondLayer(whiteCrossSide)) {
-                widget->setSolvingInterval(10);
+                setSolvingInterval(10);
                 arrangeSecondLayer();
             }
             else {
@@ -1833,12 +1542,12 @@ bool TCube::solve(void)
                     }
                     else {
                         if (!checkPermutationOfBlueCorners(whiteCrossSide)) {
-                            widget->setSolvingInterval(500);
+                            setSolvingInterval(500);
                             permutationOfBlueCorners();
                         }
                         else {
                             if (!checkOrientationOfBlueCorners(whiteCrossSide)) {
-                                widget->setSolvingInterval(500);
+                                setSolvingInterval(500);
                                 blueEdgeOrientation = true;
                                 orientationOfBlueCorners();
                             }
@@ -1849,7 +1558,217 @@ bool TCube::solve(void)
         }
 
     }
+}
+
+//---------------------------------------------------------------------------
+// Solving the cube (usually a copy) at once, without animation; all executed moves are written to the solution
+// The white center must be on the top side, because turning the middle sections is not a move of the queue
+// The function returns false if the cube was not solved within nMaxMoves moves
+//---------------------------------------------------------------------------
+bool TCube::planSolution(QVector<ROTATIONS>& solution, int nMaxMoves, const std::atomic<bool>* pCancel)
+{
+    solution.clear();
+    moves.clear();
+    blueEdgeOrientation = false;
+    if (findWhiteCrossSide() != SD_TOP) return false;
+
+    while (!check()) {
+        if (blueEdgeOrientation) orientationOfBlueCorners();
+        else arrangeNextStage();
+        if (moves.isEmpty()) return false;                                      // none of the stages knows what to do
+
+        for (int i=0; i<moves.length(); i++) makeMove(moves.at(i), FALSE);
+        solution += moves;
+        moves.clear();
+        if (solution.length() > nMaxMoves) return false;
+        if (pCancel && *pCancel) return false;                                  // the planning was cancelled by another thread
+    }
+    blueEdgeOrientation = false;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Planning the solution with the cross of the given color
+// A copy of the cube is turned so that the cross color is on the top and the colors are renamed, so that the cross
+// color becomes WHITE and the opposite color BLUE; the moves planned on the copy are renamed back to the sides of this cube
+//---------------------------------------------------------------------------
+bool TCube::planSolutionWithCross(SIDECOLOR crossColor, QVector<ROTATIONS>& solution, int nMaxMoves, const std::atomic<bool>* pCancel) const
+{
+    static const SIDECOLOR sideColors[] = { RED, GREEN, ORANGE, YELLOW };       // colors for the sides of the cross
+    TCube state(*this);
+    SIDECOLOR centerColor[6], nColorMap[8];
+    SIDE cubeSide[6];
+    int i, j;
+
+    for (i=0; i<6; i++) centerColor[i] = state.centerColor((SIDE)i);          // we remember where the centers were before turning the copy
+    for (i=0; i<6 && centerColor[i] != crossColor; i++);
+    if (i == 6) return false;
+    state.turnSideToTop((SIDE)i);
+
+    for (i=0; i<6; i++) {                                                       // we check which side of this cube is each side of the copy
+        for (j=0; j<6 && centerColor[j] != state.centerColor((SIDE)i); j++);
+        cubeSide[i] = (SIDE)j;
+    }
+
+    for (i=0; i<(int)ELEMENTS_OF(nColorMap); i++) nColorMap[i] = (SIDECOLOR)i;
+    nColorMap[state.centerColor(SD_TOP)] = WHITE;
+    nColorMap[state.centerColor(SD_BOTTOM)] = BLUE;
+    nColorMap[state.centerColor(SD_RIGHT)] = sideColors[0];
+    nColorMap[state.centerColor(SD_FRONT)] = sideColors[1];
+    nColorMap[state.centerColor(SD_LEFT)] = sideColors[2];
+    nColorMap[state.centerColor(SD_BACK)] = sideColors[3];
+    state.relabelColors(nColorMap);
+
+    if (!state.planSolution(solution, nMaxMoves, pCancel)) return false;
+    for (i=0; i<solution.length(); i++) {
+        ROTATIONS nMove = solution.at(i);
+        solution[i] = sideMove(cubeSide[moveSide(nMove)], nMove & 1);           // the turn direction does not change, only the side
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Colour neutral solving: the solution is planned from each of the six cross colors on its own thread
+// and the shortest one is chosen
+//---------------------------------------------------------------------------
+bool TCube::planColourNeutralSolution(QVector<ROTATIONS>& solution, SIDECOLOR& crossColor, int& nPlanned, const std::atomic<bool>* pCancel) const
+{
+    static const SIDECOLOR crossColors[] = { WHITE, BLUE, RED, ORANGE, GREEN, YELLOW };
+    QVector<ROTATIONS> solutions[ELEMENTS_OF(crossColors)];
+    int nPlannedMoves[ELEMENTS_OF(crossColors)];
+    QFuture<bool> results[ELEMENTS_OF(crossColors)];
+    int i, nBest = -1;
+
+    for (i=0; i<(int)ELEMENTS_OF(crossColors); i++) {
+        QVector<ROTATIONS>* pSolution = &solutions[i];
+        int* pPlanned = &nPlannedMoves[i];
+        SIDECOLOR color = crossColors[i];
+        results[i] = QtConcurrent::run([this, color, pSolution, pPlanned, pCancel]() {
+            if (!planSolutionWithCross(color, *pSolution, MAX_SOLUTION_MOVES, pCancel)) return false;
+            *pPlanned = pSolution->length();
+            optimizeMoves(*pSolution);                                          // the solutions are compared after the optimisation
+            return true;
+        });
+    }
+    for (i=0; i<(int)ELEMENTS_OF(crossColors); i++) {
+        if (!results[i].result()) continue;                                     // the solution from this color was not found
+        if (nBest < 0 || solutions[i].length() < solutions[nBest].length()) nBest = i;
+    }
+
+    if (nBest < 0) return false;
+    solution = solutions[nBest];
+    crossColor = crossColors[nBest];
+    nPlanned = nPlannedMoves[nBest];
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Searching for a solution shorter than nMaxMoves within nTimeBudget milliseconds (usually on a background thread)
+// Sequences of 0, 1, 2 ... MAX_PRE_MOVES moves are tried before the plans from all six cross colors, so the longer
+// the search runs, the more different plans are compared. The best solution found so far is returned when the time
+// is over or the search is cancelled; the function returns false if no shorter solution was found
+//---------------------------------------------------------------------------
+bool TCube::planShorterSolution(QVector<ROTATIONS>& solution, int nMaxMoves, int nTimeBudget, const std::atomic<bool>* pCancel) const
+{
+    static const SIDECOLOR crossColors[] = { WHITE, BLUE, RED, ORANGE, GREEN, YELLOW };
+    QElapsedTimer timer;
+    QVector<ROTATIONS> plan, preMoves;
+    int nPreMoves[MAX_PRE_MOVES];
+    int nDepth, i, c, nBest = nMaxMoves;
+    bool bFound = false;
+
+    timer.start();
+    for (nDepth=0; nDepth<=MAX_PRE_MOVES; nDepth++) {
+        for (i=0; i<nDepth; i++) nPreMoves[i] = 0;
+        do {
+            for (i=1; i<nDepth && nPreMoves[i]/2 != nPreMoves[i-1]/2; i++);    // the same side twice is skipped, its half turn is
+            if (i >= nDepth) {                                                  // tried as two quarter turns of the plans anyway
+                TCube state(*this);
+                preMoves.clear();
+                for (i=0; i<nDepth; i++) {
+                    state.makeMove((ROTATIONS)nPreMoves[i], FALSE);
+                    preMoves.append((ROTATIONS)nPreMoves[i]);
+                }
+                for (c=0; c<(int)ELEMENTS_OF(crossColors); c++) {
+                    if (!state.planSolutionWithCross(crossColors[c], plan, MAX_SOLUTION_MOVES, pCancel)) continue;
+                    plan = preMoves + plan;
+                    optimizeMoves(plan);
+                    if (plan.length() < nBest) {
+                        nBest = plan.length();
+                        solution = plan;
+                        bFound = true;
+                    }
+                }
+                if (timer.elapsed() >= nTimeBudget || (pCancel && *pCancel)) return bFound;
+            }
+            for (i=nDepth-1; i>=0 && ++nPreMoves[i] == 12; i--) nPreMoves[i] = 0;  // the next sequence of the pre-moves
+        } while (i >= 0);
+    }
+    return bFound;
+}
+
+//---------------------------------------------------------------------------
+// Checking on a copy of the cube that the solution, played after the first nQueued moves of the queue, solves it
+//---------------------------------------------------------------------------
+bool TCube::checkSolution(const QVector<ROTATIONS>& solution, int nQueued) const
+{
+    TCube state(*this);
+    int i;
+
+    for (i=0; i<nQueued && i<moves.length(); i++) state.makeMove(moves.at(i), FALSE);
+    for (i=0; i<solution.length(); i++) state.makeMove(solution.at(i), FALSE);
+    return state.check();
+}
+
+//---------------------------------------------------------------------------
+// Putting the whole planned solution into the queue; nPlanned is the number of moves before the optimisation
+//---------------------------------------------------------------------------
+void TCube::setMoves(const QVector<ROTATIONS>& solution, int nPlanned)
+{
+    moves = solution;
+    nPlannedMoves += nPlanned;
+    nOptimizedMoves += solution.length();
+}
+
+//---------------------------------------------------------------------------
+// Replacing the rest of the queue after the first nFrom moves with a better continuation found for the state after them
+//---------------------------------------------------------------------------
+void TCube::replaceMoves(int nFrom, const QVector<ROTATIONS>& continuation)
+{
+    nOptimizedMoves += continuation.length() - (moves.length() - nFrom);
+    moves.resize(nFrom);
+    moves += continuation;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+bool TCube::playMove(void)
+{
+    if (!moves.length()) return false;
+    makeMove(moves.at(0), TRUE);
+    moves.erase(moves.begin()+0);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TCube::solve(void)
+{
+    if (isAnimating()) return false;                                            // the next move waits for the end of the turn
+    if (playMove()) return false;
+
+    if (blueEdgeOrientation) {
+        if (check()) {                                                          // the cube is solved, the next solving starts from the beginning
+            blueEdgeOrientation = false;
+            return true;
+        }
+        orientationOfBlueCorners();
+    }
+    else arrangeNextStage();
 
+    nPlannedMoves += moves.length();                                            // the moves of the stage are optimised before they are played
+    optimizeMoves(moves);
+    nOptimizedMoves += moves.length();
     return check();
 }
 //---------------------------------------------------------------------------
@@ -1,9 +1,24 @@
 #ifndef CUBE_H
 #define CUBE_H
 
+#include <QVector>
+#include <QString>
 #include <QVector2D>
 #include <QVector3D>
-#include <QtOpenGL>
+#include <QMatrix4x4>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>                                                            // BOOL, UINT, UINT8, TRUE and FALSE
+#else
+typedef int BOOL;                                                               // the same types as in windows.h, so the solver
+typedef unsigned int UINT;                                                      // builds on the Linux workers as well
+typedef unsigned char UINT8;
+#ifndef TRUE
+#define TRUE                     1
+#define FALSE                    0
+#endif
+#endif
 
 #define cube_size                3
 #define cube_mid_pos             (cube_size / 2)
@@ -11,21 +26,29 @@
 #define ELEMENTS_OF(array)       (sizeof(array)/sizeof(array[0]))
 #define MAKECOLOR(nColor)        m_rgb[nColor].r, m_rgb[nColor].g, m_rgb[nColor].b
 
-#define RotateR()                rotateXSection(cube_size-1, FALSE, TRUE)
-#define RotateRCCW()             rotateXSection(cube_size-1, TRUE, TRUE)
-#define RotateL()                rotateXSection(0, TRUE, TRUE)
-#define RotateLCCW()             rotateXSection(0, FALSE, TRUE)
-#define RotateF()                rotateZSection(cube_size-1, FALSE, TRUE)
-#define RotateFCCW()             rotateZSection(cube_size-1, TRUE, TRUE)
-#define RotateB()                rotateZSection(0, TRUE, TRUE)
-#define RotateBCCW()             rotateZSection(0, FALSE, TRUE)
-#define RotateD()                rotateYSection(0, TRUE, TRUE)
-#define RotateDCCW()             rotateYSection(0, FALSE, TRUE)
-#define RotateU()                rotateYSection(cube_size-1, FALSE, TRUE)
-#define RotateUCCW()             rotateYSection(cube_size-1, TRUE, TRUE)
+#define RotateR(bAnimate)        rotateXSection(cube_size-1, FALSE, bAnimate)
+#define RotateRCCW(bAnimate)     rotateXSection(cube_size-1, TRUE, bAnimate)
+#define RotateL(bAnimate)        rotateXSection(0, TRUE, bAnimate)
+#define RotateLCCW(bAnimate)     rotateXSection(0, FALSE, bAnimate)
+#define RotateF(bAnimate)        rotateZSection(cube_size-1, FALSE, bAnimate)
+#define RotateFCCW(bAnimate)     rotateZSection(cube_size-1, TRUE, bAnimate)
+#define RotateB(bAnimate)        rotateZSection(0, TRUE, bAnimate)
+#define RotateBCCW(bAnimate)     rotateZSection(0, FALSE, bAnimate)
+#define RotateD(bAnimate)        rotateYSection(0, TRUE, bAnimate)
+#define RotateDCCW(bAnimate)     rotateYSection(0, FALSE, bAnimate)
+#define RotateU(bAnimate)        rotateYSection(cube_size-1, FALSE, bAnimate)
+#define RotateUCCW(bAnimate)     rotateYSection(cube_size-1, TRUE, bAnimate)
 
+#define MAX_SOLUTION_MOVES       1000                                           // limit of moves for planning the whole solution
+#define MAX_PRE_MOVES            4                                              // the longest sequence of moves tried before planning a shorter solution
+#define DEFAULT_TURN_DURATION    250                                            // [ms] animation of a quarter turn
+#define ALL_SECTIONS             ((1U << cube_size) - 1)                        // bit mask of all sections of one axis
 
-class OGLWidget;
+static_assert(cube_size <= 32, "the changed sections are kept in 32-bit masks");
+
+
+class TFaceletPermutation;
+class TAlgorithm;
 
 const struct {                                                                  // RGB combination to obtain the color of each side of the cube
     unsigned char r, g, b;
@@ -82,66 +105,111 @@ public:
     BYTEVEC(char xx, char yy, char zz)   {x=xx; y=yy; z=zz;};
 };
 
-class PT3D {
-public:
-    double x,y,z;
-    PT3D()                                    {};
-    PT3D(double xx, double yy, double zz)     {x=xx; y=yy; z=zz;};
-};
+typedef void (*func_t)();
+
+SIDE moveSide(ROTATIONS nMove);                                                 // side of the cube turned by the move
+ROTATIONS sideMove(SIDE side, bool bCCW);                                       // move turning the given side of the cube
+QString cubeColorToString(SIDECOLOR c);
+int optimizeMoves(QVector<ROTATIONS>& moves);                                   // removes redundant moves, returns the number of removed moves
+bool parseMoves(const QString& notation, QVector<ROTATIONS>& moves);            // the usual notation, e.g. "R U R' U2 M' Rw"
+QString movesToString(const QVector<ROTATIONS>& moves);
 
-class PT2D {
+class TDrawCount {                                                              // what a frame has drawn
 public:
-    double x,y;
-    PT2D()                                    {};
-    PT2D(double xx, double yy)                {x=xx; y=yy;};
-    PT2D& operator =(const PT3D& pt)          {x=pt.x; y=pt.y; return *this;};
+    int nDrawCalls;                                                             // glBegin()/glEnd() pairs or draw calls
+    int nVertices;
 };
 
-typedef void (*func_t)();
-
 class TCubePiece {
 protected:
     float m_fRotationAngle;
     QVector3D m_vRotation;
 public:
     SIDECOLOR m_nSideColor[6];
+    TCubePiece()                                        {};
     TCubePiece(BYTEVEC posHome);
     void setRotation(float fAngle, QVector3D vRotation) { m_fRotationAngle=fAngle; m_vRotation=vRotation; };
     void clrRotation(void)                              { m_fRotationAngle=0; };
+    float rotationAngle(void) const                     { return m_fRotationAngle; };
+    const QVector3D& rotationAxis(void) const           { return m_vRotation; };
     void rotateX(bool bCW);
     void rotateY(bool bCW);
     void rotateZ(bool bCW);
-    void draw(float x,float y,float z);
+    int draw(float x,float y,float z) const;                                    // returns the number of borders drawn
+};
+
+//---------------------------------------------------------------------------
+// The window showing the cube; the cube only tells it when to draw again and how fast to play the moves, so the
+// solver does not depend on the widgets or on OpenGL. A cube without a view (NULL) is solved, never shown
+//---------------------------------------------------------------------------
+class TCubeView {
+public:
+    virtual ~TCubeView()                                {};
+    virtual void cubeChanged(void) = 0;                                         // a turn has started, the cube is drawn again
+    virtual void setSolvingInterval(int interval) = 0;                          // [ms] between two moves played from the queue
 };
 
 class TCube {
 protected:
     bool blueEdgeOrientation;
-    int secondLayerBottomRotations;
+    int nPlannedMoves;                                                          // moves planned by the stages since the counters were cleared
+    int nOptimizedMoves;                                                        // moves left of them after the optimisation
     QVector<ROTATIONS> moves;
+    TCubePiece m_Pieces[cube_size][cube_size][cube_size];                       // storage of the pieces, m_pPieces only points into this array
+    quint32 m_nDirtySections[3];                                                // sections of the X, Y and Z axis changed since the renderer took them
+    int m_nTurnDuration;                                                        // [ms], 0 - the turns are not animated
+    int m_nAnimationAxis;                                                       // axis of the animated section, -1 - no animation
+    UINT8 m_nAnimationSection;
+    float m_fAnimationAngle;                                                    // the whole turn [deg]
+    qint64 m_nAnimationStart;                                                   // time of its first frame, -1 - not drawn yet
+
+    void startAnimation(int nAxis, UINT8 nSection, float fAngle);
+    void setSectionRotation(float fAngle);
+
+    TCube& operator =(const TCube& cube);                                       // use copyState() instead
 
 public:
-    OGLWidget *widget;
+    TCubeView *view;
 
-    TCube(OGLWidget *widget);
+    TCube(TCubeView *view);
+    TCube(const TCube& cube);
     ~TCube();
     TCubePiece* m_pPieces[cube_size][cube_size][cube_size];
+    void copyState(const TCube& cube);
     void reset(void);
     void random(void);
-    bool rotate(GLdouble* mxProjection, GLdouble* mxModel, GLint* nViewPort,
-                int wndSizeX, int wndSizeY, int ptMouseWndX, int ptMouseWndY, int ptLastMouseWndX, int ptLastMouseWndY, OGLWidget *widget);
+    void random(quint64 nSeed);
+    bool rotate(const QMatrix4x4& mxViewProjection, int wndSizeX, int wndSizeY,
+                int ptMouseWndX, int ptMouseWndY, int ptLastMouseWndX, int ptLastMouseWndY, TCubeView *view);
     void rotateXSection(UINT8 nSection, BOOL bCW, BOOL bAnimate);
     void rotateYSection(UINT8 nSection, BOOL bCW, BOOL bAnimate);
     void rotateZSection(UINT8 nSection, BOOL bCW, BOOL bAnimate);
-    void animateRotation(TCubePiece* piece[], int ctPieces, QVector3D v, float fAngle);
-    void draw(void);
+    void makeMove(ROTATIONS nMove, BOOL bAnimate);
+    TCubePiece* faceletPiece(int nFacelet) const;
+    SIDECOLOR faceletColor(int nFacelet) const;
+    void getFacelets(SIDECOLOR* nColors) const;
+    void setFacelets(const SIDECOLOR* nColors);
+    void applyPermutation(const TFaceletPermutation& permutation);
+    void turnSideToTop(SIDE side);
+    void relabelColors(const SIDECOLOR* nColorMap);
+    void setTurnDuration(int nDuration)                 { m_nTurnDuration = nDuration; };
+    int turnDuration(void) const                        { return m_nTurnDuration; };
+    bool isAnimating(void) const                        { return m_nAnimationAxis >= 0; };
+    bool animate(qint64 nTime);                                                 // true while the turn goes on
+    void finishAnimation(void);
+    void markSection(int nAxis, UINT8 nSection)         { m_nDirtySections[nAxis] |= 1U << nSection; };
+    void markAllSections(void)                          { m_nDirtySections[0] = ALL_SECTIONS; m_nDirtySections[1] = 0; m_nDirtySections[2] = 0; };
+    bool takeDirtySections(quint32* nSections);
+    TDrawCount draw(void);                                                      // in cubedraw.cpp, only the application draws
     bool check(void);
+    SIDECOLOR centerColor(SIDE side) const;
     SIDE findWhiteCrossSide(void);
     bool checkWhiteCross(SIDE whiteCrossSide);
     bool checkWhiteCrossCorners(SIDE whiteCrossSide);
     bool checkSecondLayer(SIDE whiteCrossSide);
     bool checkBlueCross(SIDE whiteCrossSide);
     bool checkEdgePermutationOfBlueCross(SIDE whiteCrossSide);
+    int placedBlueCorners(void);
     bool checkPermutationOfBlueCorners(SIDE whiteCrossSide);
     bool checkOrientationOfBlueCorners(SIDE whiteCrossSide);
     void whiteCrossSideToTop(SIDE whiteCrossSide);
@@ -152,6 +220,22 @@ public:
     void arrangeEdgePermutationOfBlueCross(void);
     void permutationOfBlueCorners(void);
     void orientationOfBlueCorners(void);
+    bool edgePermutationOfBlueCrossCase(TAlgorithm& alg);
+    bool isBlueCornerOriented(void);
+    void setSolvingInterval(int interval);
+    void arrangeNextStage(void);
+    bool planSolution(QVector<ROTATIONS>& solution, int nMaxMoves = MAX_SOLUTION_MOVES, const std::atomic<bool>* pCancel = NULL);
+    bool planSolutionWithCross(SIDECOLOR crossColor, QVector<ROTATIONS>& solution, int nMaxMoves = MAX_SOLUTION_MOVES, const std::atomic<bool>* pCancel = NULL) const;
+    bool planColourNeutralSolution(QVector<ROTATIONS>& solution, SIDECOLOR& crossColor, int& nPlanned, const std::atomic<bool>* pCancel = NULL) const;
+    bool planShorterSolution(QVector<ROTATIONS>& solution, int nMaxMoves, int nTimeBudget, const std::atomic<bool>* pCancel) const;
+    bool checkSolution(const QVector<ROTATIONS>& solution, int nQueued = 0) const;
+    void setMoves(const QVector<ROTATIONS>& solution, int nPlanned);
+    void replaceMoves(int nFrom, const QVector<ROTATIONS>& continuation);
+    const QVector<ROTATIONS>& queuedMoves(void) const    { return moves; };
+    void clearMoveCounts(void)                          { nPlannedMoves = 0; nOptimizedMoves = 0; };
+    int plannedMoves(void) const                        { return nPlannedMoves; };
+    int optimizedMoves(void) const                      { return nOptimizedMoves; };
+    bool playMove(void);                                                        // starts the next queued move, false - the queue is empty
     bool solve(void);
 };
 
@@ -0,0 +1,185 @@
+#include "cubebatch.h"
+
+#include <cstring>
+
+//---------------------------------------------------------------------------
+// Rows moved by each move: only the facelets which change their place, 20 of the 54 for a quarter turn
+//---------------------------------------------------------------------------
+class TMoveRows {
+public:
+    UINT8 m_nTo[ROT_UCCW+1][FACELETS];
+    UINT8 m_nFrom[ROT_UCCW+1][FACELETS];
+    int m_nCount[ROT_UCCW+1];
+
+    constexpr TMoveRows() : m_nTo(), m_nFrom(), m_nCount()
+    {
+        for (int nMove=0; nMove<=ROT_UCCW; nMove++) {
+            TFaceletPermutation permutation((ROTATIONS)nMove);
+            for (int i=0; i<FACELETS; i++) {
+                if (permutation.m_nFrom[i] == i) continue;
+                m_nTo[nMove][m_nCount[nMove]] = i;
+                m_nFrom[nMove][m_nCount[nMove]++] = permutation.m_nFrom[i];
+            }
+        }
+    }
+};
+
+static constexpr TMoveRows g_MoveRows;
+
+//---------------------------------------------------------------------------
+// Operations on the part of a row which fits into one vector register
+//---------------------------------------------------------------------------
+#if CUBEBATCH_VECTOR == 32
+typedef __m256i TLanes;
+static inline TLanes loadLanes(const UINT8* p)                  { return _mm256_load_si256((const __m256i*)p); }
+static inline void storeLanes(UINT8* p, TLanes v)               { _mm256_store_si256((__m256i*)p, v); }
+static inline TLanes blendLanes(TLanes a, TLanes b, TLanes m)   { return _mm256_blendv_epi8(a, b, m); }   // b where m is set
+static inline TLanes equalLanes(TLanes a, TLanes b)             { return _mm256_cmpeq_epi8(a, b); }
+static inline TLanes andLanes(TLanes a, TLanes b)               { return _mm256_and_si256(a, b); }
+static inline LANEMASK maskLanes(TLanes v)                      { return (LANEMASK)_mm256_movemask_epi8(v); }
+#elif CUBEBATCH_VECTOR == 16
+typedef __m128i TLanes;
+static inline TLanes loadLanes(const UINT8* p)                  { return _mm_load_si128((const __m128i*)p); }
+static inline void storeLanes(UINT8* p, TLanes v)               { _mm_store_si128((__m128i*)p, v); }
+static inline TLanes blendLanes(TLanes a, TLanes b, TLanes m)   { return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a)); }
+static inline TLanes equalLanes(TLanes a, TLanes b)             { return _mm_cmpeq_epi8(a, b); }
+static inline TLanes andLanes(TLanes a, TLanes b)               { return _mm_and_si128(a, b); }
+static inline LANEMASK maskLanes(TLanes v)                      { return (LANEMASK)_mm_movemask_epi8(v); }
+#endif
+
+//---------------------------------------------------------------------------
+TCubeBatch::TCubeBatch()
+{
+    reset();
+}
+
+//---------------------------------------------------------------------------
+void TCubeBatch::reset(void)
+{
+    static const TCube solved(NULL);
+    SIDECOLOR nColors[FACELETS];
+
+    solved.getFacelets(nColors);
+    for (int i=0; i<FACELETS; i++) memset(m_nColors[i], nColors[i], BATCH_LANES);
+}
+
+//---------------------------------------------------------------------------
+void TCubeBatch::setFacelets(int nLane, const SIDECOLOR* nColors)
+{
+    for (int i=0; i<FACELETS; i++) m_nColors[i][nLane] = (UINT8)nColors[i];
+}
+
+//---------------------------------------------------------------------------
+void TCubeBatch::getFacelets(int nLane, SIDECOLOR* nColors) const
+{
+    for (int i=0; i<FACELETS; i++) nColors[i] = (SIDECOLOR)m_nColors[i][nLane];
+}
+
+//---------------------------------------------------------------------------
+void TCubeBatch::setCube(int nLane, const TCube& cube)
+{
+    SIDECOLOR nColors[FACELETS];
+
+    cube.getFacelets(nColors);
+    setFacelets(nLane, nColors);
+}
+
+//---------------------------------------------------------------------------
+// Moving the rows pFrom[k] to the rows pTo[k]. All source rows are read before the first one is written, because
+// the moved rows form cycles; the cubes outside the mask keep their old rows
+//---------------------------------------------------------------------------
+void TCubeBatch::permute(const UINT8* pTo, const UINT8* pFrom, int nCount, LANEMASK nLanes)
+{
+    alignas(32) UINT8 nRows[FACELETS][BATCH_LANES];
+    int k, v;
+
+    for (k=0; k<nCount; k++) memcpy(nRows[k], m_nColors[pFrom[k]], BATCH_LANES);
+    if (nLanes == ALL_LANES) {
+        for (k=0; k<nCount; k++) memcpy(m_nColors[pTo[k]], nRows[k], BATCH_LANES);
+        return;
+    }
+
+    alignas(32) UINT8 nMask[BATCH_LANES];
+    for (v=0; v<BATCH_LANES; v++) nMask[v] = (nLanes >> v) & 1 ? 0xFF : 0;
+#if CUBEBATCH_VECTOR
+    for (k=0; k<nCount; k++) {
+        for (v=0; v<BATCH_LANES; v+=CUBEBATCH_VECTOR) {
+            UINT8* pRow = m_nColors[pTo[k]] + v;
+            storeLanes(pRow, blendLanes(loadLanes(pRow), loadLanes(nRows[k] + v), loadLanes(nMask + v)));
+        }
+    }
+#else
+    for (k=0; k<nCount; k++) {
+        for (v=0; v<BATCH_LANES; v++) m_nColors[pTo[k]][v] = (m_nColors[pTo[k]][v] & ~nMask[v]) | (nRows[k][v] & nMask[v]);
+    }
+#endif
+}
+
+//---------------------------------------------------------------------------
+void TCubeBatch::makeMove(ROTATIONS nMove, LANEMASK nLanes)
+{
+    permute(g_MoveRows.m_nTo[nMove], g_MoveRows.m_nFrom[nMove], g_MoveRows.m_nCount[nMove], nLanes);
+}
+
+//---------------------------------------------------------------------------
+void TCubeBatch::applyPermutation(const TFaceletPermutation& permutation, LANEMASK nLanes)
+{
+    UINT8 nTo[FACELETS], nFrom[FACELETS];
+    int nCount = 0;
+
+    for (int i=0; i<FACELETS; i++) {
+        if (permutation.m_nFrom[i] == i) continue;
+        nTo[nCount] = i;
+        nFrom[nCount++] = permutation.m_nFrom[i];
+    }
+    permute(nTo, nFrom, nCount, nLanes);
+}
+
+//---------------------------------------------------------------------------
+// Playing a different sequence in each of the first nCount cubes: in every step the cubes which make the same move
+// are moved together, so a step costs at most one pass per kind of move
+//---------------------------------------------------------------------------
+void TCubeBatch::makeMoves(const QVector<ROTATIONS>* pMoves, int nCount)
+{
+    int i, nStep, nLength = 0;
+
+    for (i=0; i<nCount; i++) nLength = qMax(nLength, (int)pMoves[i].length());
+    for (nStep=0; nStep<nLength; nStep++) {
+        LANEMASK nLanes[ROT_UCCW+1] = { 0 };
+        for (i=0; i<nCount; i++) {
+            if (nStep < pMoves[i].length()) nLanes[pMoves[i].at(nStep)] |= (LANEMASK)1 << i;
+        }
+        for (i=0; i<=ROT_UCCW; i++) {
+            if (nLanes[i]) makeMove((ROTATIONS)i, nLanes[i]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// The cube is solved if each facelet has the color of the first facelet of its side, the same as TCube::check()
+//---------------------------------------------------------------------------
+LANEMASK TCubeBatch::solvedMask(void) const
+{
+    LANEMASK nSolved = 0;
+    int nSide, i, v;
+
+#if CUBEBATCH_VECTOR
+    for (v=0; v<BATCH_LANES; v+=CUBEBATCH_VECTOR) {
+        TLanes equal = equalLanes(loadLanes(m_nColors[0] + v), loadLanes(m_nColors[0] + v));
+        for (nSide=0; nSide<6; nSide++) {
+            TLanes first = loadLanes(m_nColors[nSide*cube_size*cube_size] + v);
+            for (i=1; i<cube_size*cube_size; i++) equal = andLanes(equal, equalLanes(first, loadLanes(m_nColors[nSide*cube_size*cube_size + i] + v)));
+        }
+        nSolved |= maskLanes(equal) << v;
+    }
+#else
+    for (v=0; v<BATCH_LANES; v++) {
+        bool bSolved = true;
+        for (nSide=0; nSide<6; nSide++) {
+            for (i=1; i<cube_size*cube_size; i++) bSolved &= m_nColors[nSide*cube_size*cube_size + i][v] == m_nColors[nSide*cube_size*cube_size][v];
+        }
+        if (bSolved) nSolved |= (LANEMASK)1 << v;
+    }
+#endif
+    return nSolved;
+}
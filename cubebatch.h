@@ -0,0 +1,49 @@
+#ifndef CUBEBATCH_H
+#define CUBEBATCH_H
+
+#include "cube.h"
+#include "algorithm.h"
+
+#define BATCH_LANES              32                                             // cubes in one batch, one byte of a vector register each
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CUBEBATCH_VECTOR         32                                             // [bytes] width of the vector registers used
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CUBEBATCH_VECTOR         16
+#else
+#define CUBEBATCH_VECTOR         0                                              // no vector instructions, plain loops
+#endif
+
+typedef quint32 LANEMASK;                                                       // bit n - lane n of the batch
+static_assert(BATCH_LANES <= 8*sizeof(LANEMASK), "every lane needs its bit in the mask");
+static_assert(CUBEBATCH_VECTOR == 0 || BATCH_LANES % CUBEBATCH_VECTOR == 0, "the lanes must fill whole vector registers");
+
+#define ALL_LANES                ((LANEMASK)(((quint64)1 << BATCH_LANES) - 1))
+
+//---------------------------------------------------------------------------
+// BATCH_LANES cubes stored facelet-major (structure of arrays): the row of a facelet holds its color in every cube
+// of the batch. A move only moves the rows, so it is applied to all cubes at once with whole vector loads and stores,
+// and the solved check is a vector compare of each row with the first row of its side. The colors are kept only as
+// facelets, without the pieces, so the batch is a fast companion of TCube for scrambling, verifying and searching
+//---------------------------------------------------------------------------
+class TCubeBatch {
+protected:
+    alignas(32) UINT8 m_nColors[FACELETS][BATCH_LANES];
+
+    void permute(const UINT8* pTo, const UINT8* pFrom, int nCount, LANEMASK nLanes);
+
+public:
+    TCubeBatch();                                                               // all cubes solved
+    void reset(void);
+    void setFacelets(int nLane, const SIDECOLOR* nColors);
+    void getFacelets(int nLane, SIDECOLOR* nColors) const;
+    void setCube(int nLane, const TCube& cube);
+    void makeMove(ROTATIONS nMove, LANEMASK nLanes = ALL_LANES);                 // the move only in the cubes of the mask
+    void makeMoves(const QVector<ROTATIONS>* pMoves, int nCount);               // each cube its own sequence (pMoves[lane])
+    void applyPermutation(const TFaceletPermutation& permutation, LANEMASK nLanes = ALL_LANES);
+    LANEMASK solvedMask(void) const;
+};
+
+#endif // CUBEBATCH_H
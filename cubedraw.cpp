@@ -0,0 +1,125 @@
+#include "cube.h"
+
+#include <QtOpenGL>
+#include <GL/glu.h>
+
+//---------------------------------------------------------------------------
+int TCubePiece::draw(float x,float y,float z) const                             // drawing a piece of cube
+{
+    int nBorders = 0;
+
+    glPushMatrix();                                                             // first we rotate such a piece of cube (needed for animation)
+    if (m_fRotationAngle) {
+        glRotatef(m_fRotationAngle, m_vRotation.x(), m_vRotation.y(), m_vRotation.z());
+    }
+    glTranslatef(x,y,z);                                                        // and then we start drawing in the right place
+    glBegin(GL_QUADS);
+        glColor3ub(MAKECOLOR(m_nSideColor[SD_RIGHT]));
+        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Right)
+        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Right)
+        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Right)
+        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Right)
+        glColor3ub(MAKECOLOR(m_nSideColor[SD_BOTTOM]));
+        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Top Right Of The Quad (Bottom)
+        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Top Left Of The Quad (Bottom)
+        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Bottom)
+        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Bottom)
+        glColor3ub(MAKECOLOR(m_nSideColor[SD_FRONT]));
+        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Front)
+        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Front)
+        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Front)
+        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Front)
+        glColor3ub(MAKECOLOR(m_nSideColor[SD_TOP]));
+        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Top)
+        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Top)
+        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Bottom Left Of The Quad (Top)
+        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Bottom Right Of The Quad (Top)
+        glColor3ub(MAKECOLOR(m_nSideColor[SD_LEFT]));
+        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Left)
+        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Left)
+        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Left)
+        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Left)
+        glColor3ub(MAKECOLOR(m_nSideColor[SD_BACK]));
+        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Top Right Of The Quad (Back)
+        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Top Left Of The Quad (Back)
+        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Bottom Left Of The Quad (Back)
+        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Bottom Right Of The Quad (Back)
+    glEnd();
+    glColor3ub(MAKECOLOR(BLACK));
+    if (m_nSideColor[SD_RIGHT]!=BLACK) {                                        // we check whether the color of the right side of the cube is not black
+        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
+        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Right)
+        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Right)
+        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Right)
+        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Right)
+        glEnd();
+    }
+    if (m_nSideColor[SD_BOTTOM]!=BLACK) {                                       // we check whether the color of the underside of the piece of cube is not black
+        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
+        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Top Right Of The Quad (Bottom)
+        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Top Left Of The Quad (Bottom)
+        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Bottom)
+        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Bottom Right Of The Quad (Bottom)
+        glEnd();
+    }
+    if (m_nSideColor[SD_FRONT]!=BLACK) {                                        // we check whether the color of the front side of the cube piece is not black
+        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
+        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Front)
+        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Left Of The Quad (Front)
+        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Left Of The Quad (Front)
+        glVertex3f( 0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Front)
+        glEnd();
+    }
+    if (m_nSideColor[SD_TOP]!=BLACK) {                                          // we check whether the color of the upper side of the cube piece is not black
+        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
+        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Top Right Of The Quad (Top)
+        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Top)
+        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Bottom Left Of The Quad (Top)
+        glVertex3f( 0.5f, 0.5f, 0.5f);					                        // Bottom Right Of The Quad (Top)
+        glEnd();
+    }
+    if (m_nSideColor[SD_LEFT]!=BLACK) {                                         // we check whether the color of the left side of the cube is not black
+        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
+        glVertex3f(-0.5f, 0.5f, 0.5f);					                        // Top Right Of The Quad (Left)
+        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Top Left Of The Quad (Left)
+        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Bottom Left Of The Quad (Left)
+        glVertex3f(-0.5f,-0.5f, 0.5f);					                        // Bottom Right Of The Quad (Left)
+        glEnd();
+    }
+    if (m_nSideColor[SD_BACK]!=BLACK) {                                         // we check whether the color of the back side of the piece of cube is not black
+        glBegin(GL_LINE_LOOP);                                                  // if it is not ro, draw a square border
+        glVertex3f( 0.5f,-0.5f,-0.5f);					                        // Top Right Of The Quad (Back)
+        glVertex3f(-0.5f,-0.5f,-0.5f);					                        // Top Left Of The Quad (Back)
+        glVertex3f(-0.5f, 0.5f,-0.5f);					                        // Bottom Left Of The Quad (Back)
+        glVertex3f( 0.5f, 0.5f,-0.5f);					                        // Bottom Right Of The Quad (Back)
+        glEnd();
+    }
+    glPopMatrix();
+    for (int i=0; i<6; i++) nBorders += m_nSideColor[i] != BLACK;
+    return nBorders;
+}
+
+//---------------------------------------------------------------------------
+TDrawCount TCube::draw(void)                                                    // drawing the whole cube
+{
+    int x, y, z;
+    float posx, posy, posz;
+    int nBorders = 0;
+    TDrawCount count;
+    posx = -(cube_size-1)/2.0;                                                  // We initially count the x positions for a piece of the cube
+    for (x=0; x<cube_size; x++) {
+        posy = -(cube_size-1)/2.0;                                              // We initially count the y positions for a piece of the cube
+        for (y=0; y<cube_size; y++) {
+            posz = -(cube_size-1)/2.0;                                          // We initially count the z positions for a piece of the cube
+            for (z=0; z<cube_size; z++) {
+                nBorders += m_pPieces[x][y][z]->draw(posx, posy, posz);         // draw the appropriate piece of the cube in the designated position
+                posz += 1.0;                                                    // increase position z piece of cubez
+            }
+            posy += 1.0;                                                        // increase position y piece of cubez
+        }
+        posx += 1.0;                                                            // increase position x piece of cube
+    }
+    count.nDrawCalls = cube_size*cube_size*cube_size + nBorders;                // the quads of a piece, then a line loop per border
+    count.nVertices = cube_size*cube_size*cube_size*24 + nBorders*4;
+    return count;
+}
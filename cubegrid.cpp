@@ -0,0 +1,117 @@
+#include "cubegrid.h"
+#include <cmath>
+
+//---------------------------------------------------------------------------
+TCubeGrid::TCubeGrid()
+{
+    m_nColumns = 0;
+    m_nTurnDuration = DEFAULT_TURN_DURATION;
+}
+
+//---------------------------------------------------------------------------
+TCubeGrid::~TCubeGrid()
+{
+    resize(0);
+}
+
+//---------------------------------------------------------------------------
+// The cubes kept by the new size keep their states; the grid is as square as possible, filled from the top row
+//---------------------------------------------------------------------------
+void TCubeGrid::resize(int nCubes)
+{
+    int nRows;
+
+    nCubes = qBound(0, nCubes, MAX_GRID_CUBES);
+    while (m_pCubes.length() > nCubes) delete m_pCubes.takeLast();
+    while (m_pCubes.length() < nCubes) {
+        TCube* pCube = new TCube(NULL);                                         // no widget: the grid repaints for all cubes
+        pCube->setTurnDuration(m_nTurnDuration);
+        m_pCubes.append(pCube);
+    }
+    m_Solutions.resize(0);
+
+    m_nColumns = (int)ceil(sqrt((double)nCubes));
+    nRows = m_nColumns ? (nCubes + m_nColumns - 1) / m_nColumns : 0;
+    m_Offsets.resize(nCubes);
+    for (int i=0; i<nCubes; i++) {
+        m_Offsets[i] = QVector3D((i % m_nColumns - (m_nColumns-1)/2.0f) * GRID_SPACING,
+                                 ((nRows-1)/2.0f - i / m_nColumns) * GRID_SPACING, 0.0f);
+    }
+}
+
+//---------------------------------------------------------------------------
+float TCubeGrid::scale(void) const
+{
+    if (m_nColumns <= 1) return 1.0f;
+    return (float)cube_size / (cube_size + (m_nColumns-1) * GRID_SPACING);
+}
+
+//---------------------------------------------------------------------------
+void TCubeGrid::setTurnDuration(int nDuration)
+{
+    m_nTurnDuration = nDuration;
+    for (int i=0; i<m_pCubes.length(); i++) m_pCubes[i]->setTurnDuration(nDuration);
+}
+
+//---------------------------------------------------------------------------
+void TCubeGrid::random(quint64 nSeed)
+{
+    finishAnimations();
+    for (int i=0; i<m_pCubes.length(); i++) {
+        TCube* pCube = m_pCubes[i];
+        pCube->setMoves(QVector<ROTATIONS>(), 0);
+        pCube->random(nSeed + i);
+    }
+}
+
+//---------------------------------------------------------------------------
+// The batch solver takes BATCH_LANES cubes at a time on each thread and verifies their solutions together
+//---------------------------------------------------------------------------
+TBatchResult TCubeGrid::plan(SOLVERSTRATEGY nStrategy)
+{
+    QVector<const TCube*> cubes;
+
+    cubes.reserve(m_pCubes.length());
+    for (int i=0; i<m_pCubes.length(); i++) cubes.append(m_pCubes.at(i));
+    m_Solutions.resize(m_pCubes.length());
+    return TBatchSolver(nStrategy).solve(cubes, m_Solutions.data());
+}
+
+//---------------------------------------------------------------------------
+void TCubeGrid::startSolutions(void)
+{
+    for (int i=0; i<m_Solutions.length() && i<m_pCubes.length(); i++) {
+        m_pCubes[i]->clearMoveCounts();
+        m_pCubes[i]->setMoves(m_Solutions.at(i), m_Solutions.at(i).length());
+    }
+    m_Solutions.resize(0);
+}
+
+//---------------------------------------------------------------------------
+bool TCubeGrid::playMoves(void)
+{
+    bool bBusy = false;
+
+    for (int i=0; i<m_pCubes.length(); i++) {
+        TCube* pCube = m_pCubes[i];
+        if (pCube->isAnimating() || pCube->playMove()) bBusy = true;
+    }
+    return bBusy;
+}
+
+//---------------------------------------------------------------------------
+bool TCubeGrid::animate(qint64 nTime)
+{
+    bool bAnimating = false;
+
+    for (int i=0; i<m_pCubes.length(); i++) bAnimating |= m_pCubes[i]->animate(nTime);
+    return bAnimating;
+}
+
+//---------------------------------------------------------------------------
+void TCubeGrid::finishAnimations(void)
+{
+    for (int i=0; i<m_pCubes.length(); i++) {
+        if (m_pCubes[i]->isAnimating()) m_pCubes[i]->finishAnimation();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef CUBEGRID_H
+#define CUBEGRID_H
+
+#include <QVector>
+#include <QVector3D>
+#include "cube.h"
+#include "solver.h"
+
+#define MAX_GRID_CUBES           4096                                           // the most cubes of the grid view
+#define GRID_SPACING             (cube_size + 1)                                // distance of the centers of two neighbour cubes
+
+//---------------------------------------------------------------------------
+// Grid of independent cubes for the demos and the load tests: every cube has its own state, queue of moves and
+// animation, and all of them are turned together. The cubes are laid out in rows in the XY plane; the renderer draws
+// the whole grid by one instanced call. The solutions are planned by TBatchSolver on all cores, while the cubes are
+// not changed, and then played as the single cube plays its queue
+//---------------------------------------------------------------------------
+class TCubeGrid {
+protected:
+    QVector<TCube*> m_pCubes;
+    QVector<QVector3D> m_Offsets;                                               // center of each cube
+    QVector<QVector<ROTATIONS>> m_Solutions;                                    // written by the threads of plan()
+    int m_nColumns;
+    int m_nTurnDuration;                                                        // [ms] of the turns of all cubes
+
+public:
+    TCubeGrid();
+    ~TCubeGrid();
+    void resize(int nCubes);                                                    // 0 - no grid
+    int count(void) const                               { return m_pCubes.length(); };
+    TCube* const* cubes(void) const                     { return m_pCubes.constData(); };
+    const QVector3D* offsets(void) const                { return m_Offsets.constData(); };
+    float scale(void) const;                                                    // the grid takes the place of one cube
+    void setTurnDuration(int nDuration);
+    void random(quint64 nSeed);                                                 // cube i gets the seed nSeed + i
+    TBatchResult plan(SOLVERSTRATEGY nStrategy = STRATEGY_COLOUR_NEUTRAL);      // on worker threads; no cube may change meanwhile
+    void startSolutions(void);                                                  // the planned solutions into the queues
+    bool playMoves(void);                                                       // every idle cube starts its next move, false - all done
+    bool animate(qint64 nTime);                                                 // true while any cube turns
+    void finishAnimations(void);
+};
+
+#endif // CUBEGRID_H
@@ -0,0 +1,180 @@
+#include "framestats.h"
+#include <algorithm>
+
+//---------------------------------------------------------------------------
+TRollingWindow::TRollingWindow()
+{
+    m_nValues.resize(FRAME_STATS_WINDOW);
+    m_nNext = 0;
+    m_nCount = 0;
+}
+
+//---------------------------------------------------------------------------
+void TRollingWindow::add(qint64 nValue)
+{
+    m_nValues[m_nNext] = nValue;
+    m_nNext = (m_nNext + 1) % FRAME_STATS_WINDOW;
+    if (m_nCount < FRAME_STATS_WINDOW) m_nCount++;
+}
+
+//---------------------------------------------------------------------------
+qint64 TRollingWindow::sum(void) const
+{
+    qint64 nSum = 0;
+
+    for (int i=0; i<m_nCount; i++) nSum += m_nValues.at(i);
+    return nSum;
+}
+
+//---------------------------------------------------------------------------
+// Nearest rank: the smallest value with at least nPercent % of the values not above it
+//---------------------------------------------------------------------------
+qint64 TRollingWindow::percentile(int nPercent) const
+{
+    if (!m_nCount) return 0;
+    int nRank = qBound(0, (nPercent * m_nCount + 99) / 100 - 1, m_nCount - 1);
+    m_nSorted = m_nValues.mid(0, m_nCount);
+    std::nth_element(m_nSorted.begin(), m_nSorted.begin() + nRank, m_nSorted.end());
+    return m_nSorted.at(nRank);
+}
+
+//---------------------------------------------------------------------------
+TFrameStats::TFrameStats()
+{
+    for (int i=0; i<GPU_TIMER_QUERIES; i++) {
+        m_pQueries[i] = NULL;
+        m_bPending[i] = false;
+    }
+    m_nQuery = 0;
+    m_bGpuTimer = false;
+    m_Clock.start();
+    clear();
+}
+
+//---------------------------------------------------------------------------
+TFrameStats::~TFrameStats()
+{
+    for (int i=0; i<GPU_TIMER_QUERIES; i++) delete m_pQueries[i];              // destroy() has freed the GL objects
+}
+
+//---------------------------------------------------------------------------
+bool TFrameStats::initialize(void)
+{
+    destroy();
+    m_bGpuTimer = true;
+    for (int i=0; i<GPU_TIMER_QUERIES && m_bGpuTimer; i++) {
+        m_pQueries[i] = new QOpenGLTimerQuery();
+        m_bGpuTimer = m_pQueries[i]->create();
+    }
+    if (!m_bGpuTimer) destroy();
+    clear();
+    return m_bGpuTimer;
+}
+
+//---------------------------------------------------------------------------
+void TFrameStats::destroy(void)
+{
+    for (int i=0; i<GPU_TIMER_QUERIES; i++) {
+        if (m_pQueries[i]) {
+            if (m_pQueries[i]->isCreated()) m_pQueries[i]->destroy();
+            delete m_pQueries[i];
+            m_pQueries[i] = NULL;
+        }
+        m_bPending[i] = false;
+    }
+    m_bGpuTimer = false;
+}
+
+//---------------------------------------------------------------------------
+void TFrameStats::clear(void)
+{
+    m_CpuTime.clear();
+    m_GpuTime.clear();
+    m_Interval.clear();
+    m_LastCount.nDrawCalls = 0;
+    m_LastCount.nVertices = 0;
+    m_nFrameStart = 0;
+    m_nLastFrameStart = -1;
+    m_nFrames = 0;
+}
+
+//---------------------------------------------------------------------------
+// The results of the earlier frames, oldest first; without bWait a query not finished yet is left for the next frame
+//---------------------------------------------------------------------------
+void TFrameStats::readQueries(bool bWait)
+{
+    for (int i=1; i<=GPU_TIMER_QUERIES; i++) {
+        int nQuery = (m_nQuery + i) % GPU_TIMER_QUERIES;
+        if (m_bPending[nQuery] && (bWait || m_pQueries[nQuery]->isResultAvailable())) {
+            m_GpuTime.add(m_pQueries[nQuery]->waitForResult());
+            m_bPending[nQuery] = false;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+void TFrameStats::beginFrame(void)
+{
+    m_nFrameStart = m_Clock.nsecsElapsed();
+    if (m_nLastFrameStart >= 0) m_Interval.add(m_nFrameStart - m_nLastFrameStart);
+    m_nLastFrameStart = m_nFrameStart;
+    if (m_bGpuTimer) {
+        readQueries(false);
+        m_nQuery = (m_nQuery + 1) % GPU_TIMER_QUERIES;
+        m_bPending[m_nQuery] = false;                                           // the GPU is more frames behind, that frame is not measured
+        m_pQueries[m_nQuery]->begin();
+    }
+}
+
+//---------------------------------------------------------------------------
+void TFrameStats::endFrame(const TDrawCount& count)
+{
+    if (m_bGpuTimer) {
+        m_pQueries[m_nQuery]->end();
+        m_bPending[m_nQuery] = true;
+    }
+    m_CpuTime.add(m_Clock.nsecsElapsed() - m_nFrameStart);
+    m_LastCount = count;
+    m_nFrames++;
+}
+
+//---------------------------------------------------------------------------
+void TFrameStats::finish(void)
+{
+    if (m_bGpuTimer) readQueries(true);
+}
+
+//---------------------------------------------------------------------------
+double TFrameStats::framesPerSecond(void) const
+{
+    qint64 nTime = m_Interval.sum();
+
+    return nTime ? m_Interval.count() * 1e9 / nTime : 0.0;
+}
+
+//---------------------------------------------------------------------------
+QStringList TFrameStats::report(void) const
+{
+    QStringList lines;
+
+    lines << QString("%1 fps, %2 draw calls, %3 vertices").arg(framesPerSecond(), 0, 'f', 1)
+                                                          .arg(m_LastCount.nDrawCalls).arg(m_LastCount.nVertices);
+    lines << QString("CPU p50 %1 p95 %2 p99 %3 ms").arg(cpuTime(50), 0, 'f', 3).arg(cpuTime(95), 0, 'f', 3).arg(cpuTime(99), 0, 'f', 3);
+    if (m_bGpuTimer) lines << QString("GPU p50 %1 p95 %2 p99 %3 ms").arg(gpuTime(50), 0, 'f', 3).arg(gpuTime(95), 0, 'f', 3).arg(gpuTime(99), 0, 'f', 3);
+    else lines << QString("GPU no timer queries");
+    return lines;
+}
+
+//---------------------------------------------------------------------------
+QJsonObject TFrameStats::toJson(void) const
+{
+    QJsonObject object;
+
+    object["fps"] = framesPerSecond();
+    object["draw_calls"] = m_LastCount.nDrawCalls;
+    object["vertices"] = m_LastCount.nVertices;
+    object["frames"] = m_nFrames;
+    object["cpu_ms"] = QJsonObject({ { "p50", cpuTime(50) }, { "p95", cpuTime(95) }, { "p99", cpuTime(99) } });
+    if (m_GpuTime.count()) object["gpu_ms"] = QJsonObject({ { "p50", gpuTime(50) }, { "p95", gpuTime(95) }, { "p99", gpuTime(99) } });
+    return object;
+}
@@ -0,0 +1,77 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QOpenGLTimerQuery>
+#include <QStringList>
+#include <QVector>
+#include "cube.h"
+
+#define FRAME_STATS_WINDOW       240                                            // frames in the rolling window of the percentiles
+#define GPU_TIMER_QUERIES        4                                              // frames whose GPU time may be measured at once
+#define FRAME_STATS_LOG_INTERVAL 1000                                           // [ms] between two lines of the log
+
+//---------------------------------------------------------------------------
+// The last FRAME_STATS_WINDOW values of one measure; the percentiles are taken from a sorted copy
+//---------------------------------------------------------------------------
+class TRollingWindow {
+protected:
+    QVector<qint64> m_nValues;
+    mutable QVector<qint64> m_nSorted;
+    int m_nNext;                                                                // the oldest value, replaced by the next one
+    int m_nCount;
+
+public:
+    TRollingWindow();
+    void add(qint64 nValue);
+    void clear(void)                                    { m_nNext = 0; m_nCount = 0; };
+    int count(void) const                               { return m_nCount; };
+    qint64 sum(void) const;
+    qint64 percentile(int nPercent) const;                                      // 0 when the window is empty
+};
+
+//---------------------------------------------------------------------------
+// Timing of the frames: the CPU time of the drawing code, the GPU time of the same commands from GL_TIME_ELAPSED
+// queries, the frame rate and what was drawn. The GPU time comes a few frames later, so GPU_TIMER_QUERIES queries
+// are used in turn and a result is read only when it is available: the measuring never waits for the GPU.
+// Without timer queries (GLES, or GL older than 3.3 without ARB_timer_query) only the GPU time is missing.
+// Mesa's llvmpipe has the queries, so the numbers of a CI host without a GPU are comparable between builds
+//---------------------------------------------------------------------------
+class TFrameStats {
+protected:
+    QOpenGLTimerQuery* m_pQueries[GPU_TIMER_QUERIES];
+    bool m_bPending[GPU_TIMER_QUERIES];                                         // the query has no result read yet
+    int m_nQuery;                                                               // the query of the present frame
+    bool m_bGpuTimer;
+    QElapsedTimer m_Clock;
+    qint64 m_nFrameStart;                                                       // [ns] of m_Clock
+    qint64 m_nLastFrameStart;
+    TRollingWindow m_CpuTime;                                                   // [ns]
+    TRollingWindow m_GpuTime;                                                   // [ns]
+    TRollingWindow m_Interval;                                                  // [ns] from the start of the previous frame
+    TDrawCount m_LastCount;
+    int m_nFrames;
+
+    void readQueries(bool bWait);
+
+public:
+    TFrameStats();
+    ~TFrameStats();
+    bool initialize(void);                                                      // with the context current; false - no GPU time
+    void destroy(void);                                                         // before the context is destroyed
+    void clear(void);
+    void beginFrame(void);
+    void endFrame(const TDrawCount& count);
+    void finish(void);                                                          // waits for the GPU times still measured
+    bool hasGpuTime(void) const                         { return m_bGpuTimer; };
+    int frames(void) const                              { return m_nFrames; };
+    double cpuTime(int nPercent) const                  { return m_CpuTime.percentile(nPercent) / 1e6; };  // [ms]
+    double gpuTime(int nPercent) const                  { return m_GpuTime.percentile(nPercent) / 1e6; };  // [ms]
+    double framesPerSecond(void) const;
+    const TDrawCount& lastCount(void) const             { return m_LastCount; };
+    QStringList report(void) const;                                             // lines of the overlay
+    QJsonObject toJson(void) const;
+};
+
+#endif // FRAMESTATS_H
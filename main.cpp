@@ -1,13 +1,35 @@
+#include "cli.h"
+#ifndef CLI_ONLY
 #include "mainwindow.h"
-
 #include <QApplication>
+#include <QGuiApplication>
+#endif
+
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
+#ifdef CLI_ONLY
+    QCoreApplication a(argc, argv);                                             // the headless build has only the command line
+    TCommandLine commandLine;
+    return commandLine.run(a.arguments());
+#else
+    if (TCommandLine::isRenderRequested(argc, argv)) {                          // offscreen rendering: a GL context, but no window
+        QGuiApplication a(argc, argv);
+        TCommandLine commandLine;
+        return commandLine.run(a.arguments());
+    }
+    if (TCommandLine::isRequested(argc, argv)) {                                // headless mode: no GUI and no GL context
+        QCoreApplication a(argc, argv);
+        TCommandLine commandLine;
+        return commandLine.run(a.arguments());
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.resize(640,480);
     w.show();
 
     return a.exec();
+#endif
 }
@@ -19,6 +19,13 @@ MainWindow::MainWindow(QWidget *parent) :
 
     connect(ui->pushButtonRandom, SIGNAL(clicked()), Widget, SLOT(on_pushButtonRandom_clicked()));
     connect(ui->pushButtonSolve, SIGNAL(clicked()), Widget, SLOT(on_pushButtonSolve_clicked()));
+    connect(ui->checkBoxColourNeutral, SIGNAL(toggled(bool)), Widget, SLOT(setColourNeutral(bool)));
+    connect(ui->comboBoxRace, SIGNAL(currentIndexChanged(int)), Widget, SLOT(setRace(int)));
+    connect(ui->pushButtonBatch, SIGNAL(clicked()), Widget, SLOT(on_pushButtonBatch_clicked()));
+    connect(ui->spinBoxTurnDuration, SIGNAL(valueChanged(int)), Widget, SLOT(setTurnDuration(int)));
+    connect(ui->checkBoxFrameStats, SIGNAL(toggled(bool)), Widget, SLOT(setFrameStats(bool)));
+    connect(ui->spinBoxGridCubes, SIGNAL(valueChanged(int)), Widget, SLOT(setGridCubes(int)));
+    connect(Widget, SIGNAL(statusMessage(QString)), ui->statusBar, SLOT(showMessage(QString)));
 }
 
 //---------------------------------------------------------------------------
@@ -0,0 +1,220 @@
+#include "movearchive.h"
+
+#include <QtEndian>
+
+//---------------------------------------------------------------------------
+void TMoveRecord::toMoves(QVector<ROTATIONS>& moves) const
+{
+    moves.resize(m_nLength);
+    for (int i=0; i<m_nLength; i++) moves[i] = at(i);
+}
+
+//---------------------------------------------------------------------------
+void TMoveRecord::play(TCube& cube) const
+{
+    for (int i=0; i<m_nLength; i++) cube.makeMove(at(i), FALSE);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TMoveArchiveWriter::TMoveArchiveWriter()
+{
+    m_nRecords = 0;
+    m_nOffset = 0;
+}
+
+//---------------------------------------------------------------------------
+TMoveArchiveWriter::~TMoveArchiveWriter()
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+// Opening a new archive, or an existing one for appending: its index is read back and the records continue where
+// the index was, the index and the footer are written again by close()
+//---------------------------------------------------------------------------
+bool TMoveArchiveWriter::open(const QString& fileName, bool bAppend)
+{
+    uchar header[ARCHIVE_HEADER_SIZE] = { 0 };
+    uchar footer[ARCHIVE_FOOTER_SIZE];
+
+    close();
+    m_Index.clear();
+    m_nRecords = 0;
+    m_File.setFileName(fileName);
+
+    if (bAppend && m_File.exists()) {
+        if (!m_File.open(QIODevice::ReadWrite)) return false;
+        quint64 nSize = m_File.size();
+        if (nSize < ARCHIVE_HEADER_SIZE + ARCHIVE_FOOTER_SIZE || !m_File.seek(nSize - ARCHIVE_FOOTER_SIZE) ||
+            m_File.read((char*)footer, ARCHIVE_FOOTER_SIZE) != ARCHIVE_FOOTER_SIZE ||
+            qFromLittleEndian<quint32>(footer + 20) != ARCHIVE_MAGIC) {
+            m_File.close();
+            return false;
+        }
+        m_nOffset = qFromLittleEndian<quint64>(footer);
+        m_nRecords = qFromLittleEndian<quint64>(footer + 8);
+        if (m_nOffset < ARCHIVE_HEADER_SIZE || m_nOffset > nSize - ARCHIVE_FOOTER_SIZE || m_nRecords > (m_nOffset - ARCHIVE_HEADER_SIZE) / 2 ||
+            m_nOffset + (m_nRecords + ARCHIVE_INDEX_STRIDE-1) / ARCHIVE_INDEX_STRIDE * 8 + ARCHIVE_FOOTER_SIZE != nSize) {
+            m_File.close();                                                     // the footer does not match the file
+            m_nRecords = 0;
+            return false;
+        }
+        m_Index.resize((m_nRecords + ARCHIVE_INDEX_STRIDE-1) / ARCHIVE_INDEX_STRIDE);
+        if (!m_File.seek(m_nOffset) || m_File.read((char*)m_Index.data(), m_Index.length()*8) != m_Index.length()*8) {
+            m_File.close();
+            return false;
+        }
+        for (int i=0; i<m_Index.length(); i++) m_Index[i] = qFromLittleEndian(m_Index.at(i));
+        return m_File.resize(m_nOffset) && m_File.seek(m_nOffset);                 // the old index is overwritten by the new records
+    }
+
+    if (!m_File.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    qToLittleEndian<quint32>(ARCHIVE_MAGIC, header);
+    qToLittleEndian<quint16>(ARCHIVE_VERSION, header + 4);
+    qToLittleEndian<quint16>(ARCHIVE_INDEX_STRIDE, header + 6);
+    m_nOffset = ARCHIVE_HEADER_SIZE;
+    return m_File.write((const char*)header, ARCHIVE_HEADER_SIZE) == ARCHIVE_HEADER_SIZE;
+}
+
+//---------------------------------------------------------------------------
+bool TMoveArchiveWriter::append(const ROTATIONS* pMoves, int nLength)
+{
+    if (!m_File.isOpen() || nLength < 0 || nLength > 0xFFFF) return false;
+
+    m_Record.resize(2 + (nLength+1) / 2);
+    uchar* pRecord = (uchar*)m_Record.data();
+    qToLittleEndian<quint16>(nLength, pRecord);
+    for (int i=0; i<nLength; i+=2) {
+        pRecord[2 + i/2] = pMoves[i] | ((i+1 < nLength ? pMoves[i+1] : ARCHIVE_NO_MOVE) << 4);
+    }
+    if (m_File.write(m_Record) != m_Record.size()) return false;
+
+    if (m_nRecords % ARCHIVE_INDEX_STRIDE == 0) m_Index.append(m_nOffset);
+    m_nOffset += m_Record.size();
+    m_nRecords++;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TMoveArchiveWriter::close(void)
+{
+    uchar footer[ARCHIVE_FOOTER_SIZE] = { 0 };
+    bool bOk = true;
+
+    if (!m_File.isOpen()) return false;
+    for (int i=0; i<m_Index.length(); i++) {
+        uchar entry[8];
+        qToLittleEndian<quint64>(m_Index.at(i), entry);
+        bOk &= m_File.write((const char*)entry, 8) == 8;
+    }
+    qToLittleEndian<quint64>(m_nOffset, footer);
+    qToLittleEndian<quint64>(m_nRecords, footer + 8);
+    qToLittleEndian<quint32>(ARCHIVE_MAGIC, footer + 20);
+    bOk &= m_File.write((const char*)footer, ARCHIVE_FOOTER_SIZE) == ARCHIVE_FOOTER_SIZE;
+    m_File.close();
+    return bOk;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TMoveRecord TMoveArchive::const_iterator::operator*() const
+{
+    if (m_pEnd - m_pRecord < 2) return TMoveRecord();
+    int nLength = qFromLittleEndian<quint16>(m_pRecord);
+    if (m_pEnd - m_pRecord - 2 < (nLength + 1) / 2) return TMoveRecord();       // the record would end beyond the records
+    for (int i=0; i<nLength; i++) {
+        int nMove = (m_pRecord[2 + (i >> 1)] >> ((i & 1) << 2)) & 15;
+        if (nMove > ROT_UCCW) return TMoveRecord();                             // at() would give a move which makeMove ignores
+    }
+    return TMoveRecord(m_pRecord + 2, nLength);
+}
+
+//---------------------------------------------------------------------------
+TMoveArchive::const_iterator& TMoveArchive::const_iterator::operator++()
+{
+    if (m_pEnd - m_pRecord < 2) {
+        m_pRecord = m_pEnd;
+        return *this;
+    }
+    int nSize = 2 + (qFromLittleEndian<quint16>(m_pRecord) + 1) / 2;
+    m_pRecord = m_pEnd - m_pRecord < nSize ? m_pEnd : m_pRecord + nSize;
+    return *this;
+}
+
+//---------------------------------------------------------------------------
+TMoveArchive::TMoveArchive()
+{
+    m_pData = NULL;
+    m_nSize = 0;
+    m_nRecords = 0;
+    m_nIndexOffset = ARCHIVE_HEADER_SIZE;
+    m_nStride = ARCHIVE_INDEX_STRIDE;
+}
+
+//---------------------------------------------------------------------------
+TMoveArchive::~TMoveArchive()
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+bool TMoveArchive::open(const QString& fileName)
+{
+    close();
+    m_File.setFileName(fileName);
+    if (!m_File.open(QIODevice::ReadOnly)) return false;
+    m_nSize = m_File.size();
+    if (m_nSize >= ARCHIVE_HEADER_SIZE + ARCHIVE_FOOTER_SIZE) m_pData = m_File.map(0, m_nSize);
+    if (!m_pData) {
+        close();
+        return false;
+    }
+
+    const uchar* pFooter = m_pData + m_nSize - ARCHIVE_FOOTER_SIZE;
+    m_nIndexOffset = qFromLittleEndian<quint64>(pFooter);
+    m_nRecords = qFromLittleEndian<quint64>(pFooter + 8);
+    m_nStride = qFromLittleEndian<quint16>(m_pData + 6);
+    if (qFromLittleEndian<quint32>(m_pData) != ARCHIVE_MAGIC || qFromLittleEndian<quint16>(m_pData + 4) != ARCHIVE_VERSION ||
+        qFromLittleEndian<quint32>(pFooter + 20) != ARCHIVE_MAGIC || m_nStride == 0 ||
+        m_nIndexOffset < ARCHIVE_HEADER_SIZE || m_nIndexOffset > m_nSize - ARCHIVE_FOOTER_SIZE ||
+        m_nRecords > (m_nIndexOffset - ARCHIVE_HEADER_SIZE) / 2 ||                // each record takes at least 2 bytes
+        m_nIndexOffset + (m_nRecords + m_nStride-1) / m_nStride * 8 + ARCHIVE_FOOTER_SIZE != m_nSize) {
+        close();                                                                // not an archive, or it was not closed
+        return false;
+    }
+
+    quint64 nEntry, nPrevious = 0;                                              // the index must point into the records, in order
+    for (quint64 i=0; i<(m_nRecords + m_nStride-1) / m_nStride; i++) {
+        nEntry = qFromLittleEndian<quint64>(m_pData + m_nIndexOffset + i*8);
+        if (nEntry >= m_nIndexOffset || (i == 0 ? nEntry != ARCHIVE_HEADER_SIZE : nEntry <= nPrevious)) {
+            close();
+            return false;
+        }
+        nPrevious = nEntry;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TMoveArchive::close(void)
+{
+    if (m_pData) m_File.unmap((uchar*)m_pData);
+    m_File.close();
+    m_pData = NULL;
+    m_nSize = 0;
+    m_nRecords = 0;
+    m_nIndexOffset = ARCHIVE_HEADER_SIZE;
+}
+
+//---------------------------------------------------------------------------
+TMoveRecord TMoveArchive::record(quint64 nRecord) const
+{
+    if (nRecord >= m_nRecords) return TMoveRecord();
+
+    const_iterator it(m_pData + qFromLittleEndian<quint64>(m_pData + m_nIndexOffset + nRecord / m_nStride * 8), m_pData + m_nIndexOffset);
+    for (int i=nRecord % m_nStride; i>0; i--) ++it;
+    return *it;
+}
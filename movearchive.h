@@ -0,0 +1,96 @@
+#ifndef MOVEARCHIVE_H
+#define MOVEARCHIVE_H
+
+#include <QFile>
+#include "cube.h"
+
+#define ARCHIVE_MAGIC            0x564D4352                                     // "RCMV" in the file
+#define ARCHIVE_VERSION          1
+#define ARCHIVE_INDEX_STRIDE     64                                             // records between two entries of the index
+#define ARCHIVE_HEADER_SIZE      16
+#define ARCHIVE_FOOTER_SIZE      24
+#define ARCHIVE_NO_MOVE          15                                             // the unused half of the last byte of an odd record
+
+//---------------------------------------------------------------------------
+// Binary archive of move sequences. Each move of the ROTATIONS takes 4 bits, two moves in a byte (the first one in
+// the lower half), so a solution needs about a quarter of its text. All numbers are little endian.
+//
+//   header   : magic (4), version (2), index stride (2), reserved (8)
+//   records  : number of moves (2), (moves+1)/2 bytes of moves
+//   index    : offset of every ARCHIVE_INDEX_STRIDE-th record (8 each)
+//   footer   : offset of the index (8), number of records (8), reserved (4), magic (4)
+//
+// The index is written when the archive is closed, so the records can be appended one by one and the archive can
+// be opened again for appending; a record is found by the index and at most ARCHIVE_INDEX_STRIDE-1 skipped records
+//---------------------------------------------------------------------------
+class TMoveRecord {                                                             // record read directly from the mapped file
+protected:
+    const uchar* m_pData;
+    int m_nLength;
+
+public:
+    TMoveRecord(const uchar* pData = NULL, int nLength = 0)                     { m_pData = pData; m_nLength = nLength; };
+    bool isValid(void) const                                                    { return m_pData != NULL; };   // false for a record out of the file or with a wrong move
+    int length(void) const                                                      { return m_nLength; };
+    ROTATIONS at(int i) const                                                   { return (ROTATIONS)((m_pData[i >> 1] >> ((i & 1) << 2)) & 15); };
+    void toMoves(QVector<ROTATIONS>& moves) const;
+    void play(TCube& cube) const;                                               // all moves without animation
+};
+
+//---------------------------------------------------------------------------
+class TMoveArchiveWriter {
+protected:
+    QFile m_File;
+    QVector<quint64> m_Index;
+    quint64 m_nRecords;
+    quint64 m_nOffset;                                                          // end of the last record
+    QByteArray m_Record;                                                        // reused for every record
+
+public:
+    TMoveArchiveWriter();
+    ~TMoveArchiveWriter();
+    bool open(const QString& fileName, bool bAppend = false);
+    bool append(const ROTATIONS* pMoves, int nLength);
+    bool append(const QVector<ROTATIONS>& moves)                                { return append(moves.constData(), moves.length()); };
+    bool close(void);                                                           // writes the index and the footer
+    quint64 count(void) const                                                   { return m_nRecords; };
+};
+
+//---------------------------------------------------------------------------
+// Reader of the archive: the file is mapped into memory and the records are read in place, without copying.
+// The footer and the index are checked when the archive is opened; the length of each record is checked against
+// the records part of the file and every move against the ROTATIONS before the record is returned, so a damaged file
+// gives invalid records, never a read outside or a move which is not one
+//---------------------------------------------------------------------------
+class TMoveArchive {
+protected:
+    QFile m_File;
+    const uchar* m_pData;
+    quint64 m_nSize;
+    quint64 m_nRecords;
+    quint64 m_nIndexOffset;
+    int m_nStride;
+
+public:
+    class const_iterator {                                                      // sequential reading, no index needed
+    protected:
+        const uchar* m_pRecord;
+        const uchar* m_pEnd;                                                    // the records are never read beyond it
+    public:
+        const_iterator(const uchar* pRecord, const uchar* pEnd)                 { m_pRecord = pRecord; m_pEnd = pEnd; };
+        TMoveRecord operator*() const;
+        const_iterator& operator++();
+        bool operator!=(const const_iterator& other) const                      { return m_pRecord != other.m_pRecord; };
+    };
+
+    TMoveArchive();
+    ~TMoveArchive();
+    bool open(const QString& fileName);
+    void close(void);
+    quint64 count(void) const                                                   { return m_nRecords; };
+    TMoveRecord record(quint64 nRecord) const;                                  // random access by the index
+    const_iterator begin(void) const                                            { return const_iterator(m_pData + ARCHIVE_HEADER_SIZE, m_pData + m_nIndexOffset); };
+    const_iterator end(void) const                                              { return const_iterator(m_pData + m_nIndexOffset, m_pData + m_nIndexOffset); };
+};
+
+#endif // MOVEARCHIVE_H
@@ -0,0 +1,224 @@
+#include "notation.h"
+
+#include <cstring>
+
+typedef enum {
+    TOKEN_NONE,
+    TOKEN_FACE,
+    TOKEN_WIDE,
+    TOKEN_SLICE,
+    TOKEN_ROTATION,
+    TOKEN_SPACE
+} NOTATIONTOKEN;
+
+#define SUFFIX_LENGTH            0x01                                           // bits of the character after a face letter:
+#define SUFFIX_PRIME             0x02                                           // ' or 2 belongs to the token,
+#define SUFFIX_TWO               0x04                                           // the token is a half turn,
+#define SUFFIX_OTHER             0x08                                           // e.g. "Rw", read by the general path
+
+//---------------------------------------------------------------------------
+// Meaning of every character, the faces in the order of the ROTATIONS: R L F B D U. A slice turns like the face
+// given here (M like L, E like D, S like F) and a rotation like the face given here (x like R, y like U, z like F)
+//---------------------------------------------------------------------------
+class TNotationTable {
+public:
+    UINT8 m_nToken[256];
+    UINT8 m_nFace[256];
+    UINT8 m_nSuffix[256];
+
+    constexpr TNotationTable() : m_nToken(), m_nFace(), m_nSuffix()
+    {
+        for (int i=0; i<256; i++) m_nSuffix[i] = SUFFIX_OTHER;
+        m_nSuffix[' '] = m_nSuffix['\t'] = m_nSuffix['\r'] = m_nSuffix['\n'] = 0;
+        m_nSuffix['\''] = SUFFIX_LENGTH | SUFFIX_PRIME;
+        m_nSuffix['2'] = SUFFIX_LENGTH | SUFFIX_TWO;
+        const char faces[] = "RLFBDU";
+        const char wide[] = "rlfbdu";
+        for (int i=0; i<6; i++) {
+            m_nToken[(UINT8)faces[i]] = TOKEN_FACE;  m_nFace[(UINT8)faces[i]] = i;
+            m_nToken[(UINT8)wide[i]] = TOKEN_WIDE;   m_nFace[(UINT8)wide[i]] = i;
+        }
+        m_nToken['M'] = TOKEN_SLICE;    m_nFace['M'] = 1;
+        m_nToken['E'] = TOKEN_SLICE;    m_nFace['E'] = 4;
+        m_nToken['S'] = TOKEN_SLICE;    m_nFace['S'] = 2;
+        m_nToken['x'] = TOKEN_ROTATION; m_nFace['x'] = 0;
+        m_nToken['y'] = TOKEN_ROTATION; m_nFace['y'] = 5;
+        m_nToken['z'] = TOKEN_ROTATION; m_nFace['z'] = 2;
+        m_nToken[' '] = m_nToken['\t'] = m_nToken['\r'] = m_nToken['\n'] = TOKEN_SPACE;
+    }
+};
+
+static constexpr TNotationTable g_Notation;
+static const bool g_bPositiveFace[] = { true, false, true, false, false, true };    // R F U turn clockwise about +x +z +y
+static const UINT8 g_nAxisCycle[3][4] = { { 2, 5, 3, 4 },                     // x: F -> U -> B -> D
+                                          { 5, 0, 4, 1 },                     // z: U -> R -> D -> L
+                                          { 2, 1, 3, 0 } };                   // y: F -> L -> B -> R
+static const UINT8 g_nTokenMoves[] = { 0, 1, 1, 2, 0, 0 };                      // moves of a quarter turn of each NOTATIONTOKEN
+
+//---------------------------------------------------------------------------
+// Rotation of the whole cube the same way as a quarter turn of the face (nDir -1: counterclockwise). nFrame[f] is
+// the fixed side which is now at the place of the face f of the notation
+//---------------------------------------------------------------------------
+static inline void rotateFrame(UINT8* nFrame, int nFace, int nDir)
+{
+    const UINT8* nCycle = g_nAxisCycle[nFace/2];
+    UINT8 nOld[6];
+
+    for (int i=0; i<6; i++) nOld[i] = nFrame[i];
+    if (g_bPositiveFace[nFace] != (nDir < 0)) {
+        for (int i=0; i<4; i++) nFrame[nCycle[(i+1) & 3]] = nOld[nCycle[i]];
+    }
+    else {
+        for (int i=0; i<4; i++) nFrame[nCycle[i]] = nOld[nCycle[(i+1) & 3]];
+    }
+}
+
+//---------------------------------------------------------------------------
+// Face turns are by far the most common, so they are read first without branching on the suffix: both halves of
+// a possible half turn are stored and the counter moves by one or two. Everything else goes the general way
+//---------------------------------------------------------------------------
+int TNotation::parse(std::string_view text, ROTATIONS* pMoves, int nMaxMoves, size_t* pErrorPos)
+{
+    UINT8 nFrame[6] = { 0, 1, 2, 3, 4, 5 };
+    const char* p = text.data();
+    const char* pEnd = p + text.size();
+    int nMoves = 0;
+
+    while (p < pEnd) {
+        if (pEnd - p >= 3 && nMoves + 2 <= nMaxMoves) {
+            UINT8 c = (UINT8)p[0];
+            int nSuffix = g_Notation.m_nSuffix[(UINT8)p[1]];
+            int nLength = 1 + (nSuffix & SUFFIX_LENGTH);
+            if (g_Notation.m_nToken[c] == TOKEN_FACE && !(nSuffix & SUFFIX_OTHER) && g_Notation.m_nToken[(UINT8)p[nLength]] == TOKEN_SPACE) {
+                ROTATIONS nMove = (ROTATIONS)(2*nFrame[g_Notation.m_nFace[c]] + ((nSuffix & SUFFIX_PRIME) >> 1));
+                pMoves[nMoves] = nMove;
+                pMoves[nMoves+1] = nMove;
+                nMoves += 1 + ((nSuffix & SUFFIX_TWO) >> 2);
+                p += nLength + 1;
+                continue;
+            }
+        }
+
+        const char* pToken = p;
+        UINT8 c = (UINT8)*p++;
+        int nToken = g_Notation.m_nToken[c];
+        int nFace = g_Notation.m_nFace[c];
+        if (nToken == TOKEN_SPACE) continue;
+
+        int nTurns = 1, nDir = 1;
+        if (nToken == TOKEN_FACE && p < pEnd && *p == 'w') { nToken = TOKEN_WIDE; p++; }
+        if (p < pEnd && *p == '2') { nTurns = 2; p++; }
+        if (p < pEnd && *p == '\'') { nDir = -1; p++; }
+        if (nToken == TOKEN_NONE || (p < pEnd && g_Notation.m_nToken[(UINT8)*p] != TOKEN_SPACE) ||
+            nMoves + nTurns*g_nTokenMoves[nToken] > nMaxMoves) {                // only the moves of this token must fit
+            if (pErrorPos) *pErrorPos = pToken - text.data();
+            return NOTATION_ERROR;
+        }
+        if (nTurns == 2) nDir = 1;                                              // R2' is the same as R2
+
+        while (nTurns--) {
+            switch (nToken) {
+            case TOKEN_FACE :
+                pMoves[nMoves++] = (ROTATIONS)(2*nFrame[nFace] + (nDir < 0));
+                break;
+            case TOKEN_WIDE :                                                   // Rw = L x
+                pMoves[nMoves++] = (ROTATIONS)(2*nFrame[nFace ^ 1] + (nDir < 0));
+                rotateFrame(nFrame, nFace, nDir);
+                break;
+            case TOKEN_SLICE :                                                  // M = R L' x', the slice turns like L
+                pMoves[nMoves++] = (ROTATIONS)(2*nFrame[nFace ^ 1] + (nDir < 0));
+                pMoves[nMoves++] = (ROTATIONS)(2*nFrame[nFace] + (nDir > 0));
+                rotateFrame(nFrame, nFace, nDir);
+                break;
+            case TOKEN_ROTATION :
+                rotateFrame(nFrame, nFace, nDir);
+                break;
+            }
+        }
+    }
+    return nMoves;
+}
+
+//---------------------------------------------------------------------------
+bool TNotation::parse(std::string_view text, QVector<ROTATIONS>& moves)
+{
+    moves.resize(2*text.size());                                                // a slice of one letter is two moves
+    int nMoves = parse(text, moves.data(), moves.length());
+    moves.resize(qMax(nMoves, 0));
+    return nMoves != NOTATION_ERROR;
+}
+
+//---------------------------------------------------------------------------
+bool TNotation::apply(std::string_view text, TCube& cube)
+{
+    ROTATIONS nMoves[MAX_SOLUTION_MOVES];
+    int nCount = parse(text, nMoves, MAX_SOLUTION_MOVES);
+
+    if (nCount == NOTATION_ERROR) return false;
+    for (int i=0; i<nCount; i++) cube.makeMove(nMoves[i], FALSE);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+void TScrambleFile::const_iterator::findLine(void)
+{
+    while (m_pNext < m_pEnd) {
+        const char* pStart = m_pNext;
+        const char* pEol = (const char*)memchr(pStart, '\n', m_pEnd - pStart);
+        if (!pEol) pEol = m_pEnd;
+        m_pNext = pEol < m_pEnd ? pEol + 1 : m_pEnd;
+
+        while (pStart < pEol && g_Notation.m_nToken[(UINT8)*pStart] == TOKEN_SPACE) pStart++;
+        while (pEol > pStart && g_Notation.m_nToken[(UINT8)pEol[-1]] == TOKEN_SPACE) pEol--;
+        if (pStart == pEol || *pStart == '#') continue;
+        m_Line = std::string_view(pStart, pEol - pStart);
+        return;
+    }
+    m_Line = std::string_view(m_pEnd, 0);                                       // the same as end()
+}
+
+//---------------------------------------------------------------------------
+void TScrambleFile::split(std::string_view text, QVector<std::string_view>& lines)
+{
+    const char* pEnd = text.data() + text.size();
+
+    lines.clear();
+    for (const_iterator it(text.data(), pEnd), end(pEnd, pEnd); it != end; ++it) lines.append(*it);
+}
+
+//---------------------------------------------------------------------------
+TScrambleFile::TScrambleFile()
+{
+    m_pData = NULL;
+    m_nSize = 0;
+}
+
+//---------------------------------------------------------------------------
+TScrambleFile::~TScrambleFile()
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+bool TScrambleFile::open(const QString& fileName)
+{
+    close();
+    m_File.setFileName(fileName);
+    if (!m_File.open(QIODevice::ReadOnly)) return false;
+    m_nSize = m_File.size();
+    if (m_nSize == 0) return true;                                              // an empty file cannot be mapped
+    m_pData = (const char*)m_File.map(0, m_nSize);
+    if (!m_pData) close();
+    return m_pData != NULL;
+}
+
+//---------------------------------------------------------------------------
+void TScrambleFile::close(void)
+{
+    if (m_pData) m_File.unmap((uchar*)m_pData);
+    m_File.close();
+    m_pData = NULL;
+    m_nSize = 0;
+}
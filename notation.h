@@ -0,0 +1,58 @@
+#ifndef NOTATION_H
+#define NOTATION_H
+
+#include <QFile>
+#include <string_view>
+#include "cube.h"
+
+#define NOTATION_ERROR           -1
+
+//---------------------------------------------------------------------------
+// Parser of the standard (WCA) notation at run time: face turns R L F B D U, wide turns Rw or r, slices M E S and
+// rotations x y z, each with the suffix ' or 2. The queue knows only the face turns, so the centres stay in their
+// places: a wide turn or a slice is written as the turns of the outer faces and a rotation of the whole cube, and
+// the rotation only changes which side the following letters mean. The state is the same up to the orientation
+// of the whole cube, which is enough for solving it. Nothing is allocated, the text is read where it is
+//---------------------------------------------------------------------------
+class TNotation {
+public:
+    static int parse(std::string_view text, ROTATIONS* pMoves, int nMaxMoves, size_t* pErrorPos = NULL);   // number of moves or NOTATION_ERROR
+    static bool parse(std::string_view text, QVector<ROTATIONS>& moves);
+    static bool apply(std::string_view text, TCube& cube);                      // the moves without animation
+};
+
+//---------------------------------------------------------------------------
+// File with one scramble per line, mapped into memory; the lines are returned as views of the mapped file, without
+// copying. Empty lines and lines starting with '#' are skipped
+//---------------------------------------------------------------------------
+class TScrambleFile {
+protected:
+    QFile m_File;
+    const char* m_pData;
+    qint64 m_nSize;
+
+public:
+    class const_iterator {
+    protected:
+        const char* m_pNext;                                                    // the rest of the file after the current line
+        const char* m_pEnd;
+        std::string_view m_Line;
+        void findLine(void);
+    public:
+        const_iterator(const char* pNext, const char* pEnd)                     { m_pNext = pNext; m_pEnd = pEnd; findLine(); };
+        std::string_view operator*() const                                      { return m_Line; };
+        const_iterator& operator++()                                            { findLine(); return *this; };
+        bool operator!=(const const_iterator& other) const                      { return m_Line.data() != other.m_Line.data(); };
+    };
+
+    TScrambleFile();
+    ~TScrambleFile();
+    bool open(const QString& fileName);
+    void close(void);
+    std::string_view data(void) const                                           { return std::string_view(m_pData, m_nSize); };
+    static void split(std::string_view text, QVector<std::string_view>& lines); // the same lines of any text
+    const_iterator begin(void) const                                            { return const_iterator(m_pData, m_pData + m_nSize); };
+    const_iterator end(void) const                                              { return const_iterator(m_pData + m_nSize, m_pData + m_nSize); };
+};
+
+#endif // NOTATION_H
@@ -0,0 +1,159 @@
+#include "offscreen.h"
+#include "oglwidget.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstdio>
+
+//---------------------------------------------------------------------------
+TOffscreenRenderer::TOffscreenRenderer(int nWidth, int nHeight, int nTurnDuration, int nFrameRate)
+{
+    m_nWidth = nWidth;
+    m_nHeight = nHeight;
+    m_nTurnDuration = nTurnDuration;
+    m_nFrameRate = nFrameRate;
+    m_pFbo = NULL;
+    m_nFormat = FRAMES_PNG;
+    m_nFrames = 0;
+    m_nTime = 0;
+}
+
+//---------------------------------------------------------------------------
+TOffscreenRenderer::~TOffscreenRenderer()
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+// The context and the framebuffer are set up as initializeGL() and resizeGL() of the widget do it
+//---------------------------------------------------------------------------
+bool TOffscreenRenderer::open(const QString& output)
+{
+    QSurfaceFormat format;
+    QOpenGLFramebufferObjectFormat fboFormat;
+
+    close();
+    m_Output = output;
+    m_nFrames = 0;
+    m_nTime = 0;
+    m_nFormat = (output == "-" || output.endsWith(".rgba")) ? FRAMES_RGBA : FRAMES_PNG;
+    if (m_nFormat == FRAMES_PNG && !QDir().mkpath(output)) {
+        m_Error = QString("Cannot create the directory %1").arg(output);
+        return false;
+    }
+    if (m_nFormat == FRAMES_RGBA) {
+        bool bOpen;
+        if (output == "-") bOpen = m_File.open(stdout, QIODevice::WriteOnly);
+        else {
+            m_File.setFileName(output);
+            bOpen = m_File.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+        if (!bOpen) {
+            m_Error = QString("Cannot create %1").arg(output);
+            return false;
+        }
+    }
+
+    format.setDepthBufferSize(24);
+    m_Context.setFormat(format);
+    if (!m_Context.create()) {
+        m_Error = "Cannot create an OpenGL context";
+        return false;
+    }
+    m_Surface.setFormat(m_Context.format());
+    m_Surface.create();
+    if (!m_Surface.isValid() || !m_Context.makeCurrent(&m_Surface)) {
+        m_Error = "Cannot create an offscreen surface";
+        return false;
+    }
+    fboFormat.setAttachment(QOpenGLFramebufferObject::Depth);
+    m_pFbo = new QOpenGLFramebufferObject(m_nWidth, m_nHeight, fboFormat);
+    if (!m_pFbo->isValid() || !m_pFbo->bind()) {
+        m_Error = QString("Cannot create a framebuffer of %1x%2").arg(m_nWidth).arg(m_nHeight);
+        return false;
+    }
+
+    glEnable(GL_LINE_SMOOTH);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glLineWidth(1.5);
+    glViewport(0, 0, m_nWidth, m_nHeight);
+    OGLWidget::loadProjection(m_nWidth, m_nHeight);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);                                        // the rows of RGBA have no padding
+    m_Frame = QImage(m_nWidth, m_nHeight, QImage::Format_RGBA8888);
+    m_Stats.initialize();                                                       // without timer queries only the GPU time is missing
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TOffscreenRenderer::close(void)
+{
+    if (m_File.isOpen()) m_File.close();
+    if (m_pFbo) {
+        m_Context.makeCurrent(&m_Surface);
+        m_Stats.destroy();
+        delete m_pFbo;
+        m_pFbo = NULL;
+        m_Context.doneCurrent();
+    }
+}
+
+//---------------------------------------------------------------------------
+// The frame is read into the image of the last frame; GL gives the bottom row first, so the rows are swapped in place
+//---------------------------------------------------------------------------
+bool TOffscreenRenderer::writeFrame(TCube& cube)
+{
+    int nRowBytes = m_Frame.bytesPerLine();
+
+    m_Stats.beginFrame();
+    glClearColor(0.39f,0.58f,0.93f,1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glLoadMatrixf(OGLWidget::modelViewMatrix(QQuaternion()).constData());       // the initial position of the widget
+    m_Stats.endFrame(cube.draw());
+    glReadPixels(0, 0, m_nWidth, m_nHeight, GL_RGBA, GL_UNSIGNED_BYTE, m_Frame.bits());
+    for (int y=0; y<m_nHeight/2; y++) {
+        std::swap_ranges(m_Frame.scanLine(y), m_Frame.scanLine(y) + nRowBytes, m_Frame.scanLine(m_nHeight-1-y));
+    }
+
+    if (m_nFormat == FRAMES_RGBA) {
+        if (m_File.write((const char*)m_Frame.constBits(), m_Frame.sizeInBytes()) != m_Frame.sizeInBytes()) {
+            m_Error = QString("Cannot write to %1").arg(m_Output);
+            return false;
+        }
+    }
+    else {
+        QString name = QString("%1/frame_%2.png").arg(m_Output).arg(m_nFrames, 6, 10, QChar('0'));
+        if (!m_Frame.save(name, "PNG")) {
+            m_Error = QString("Cannot write %1").arg(name);
+            return false;
+        }
+    }
+    m_nFrames++;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// The frame times are counted from the frames written so far: a turn of m_nTurnDuration ms gets the same frames
+// at every rendering speed. A turn starts with the frame of the state before it and the last frame shows the end
+//---------------------------------------------------------------------------
+bool TOffscreenRenderer::play(const TCube& cube, const QVector<ROTATIONS>& moves)
+{
+    TCube state(cube);                                                          // a copy without a widget
+    QElapsedTimer timer;
+    bool bOk = true;
+
+    if (!m_pFbo) return false;
+    timer.start();
+    state.setTurnDuration(m_nTurnDuration);
+    for (int i=0; i<moves.length() && bOk; i++) {
+        state.makeMove(moves.at(i), TRUE);
+        if (!state.isAnimating()) bOk = writeFrame(state);                      // no animation, one frame per move
+        while (bOk && state.animate(m_nFrames * 1000LL / m_nFrameRate)) bOk = writeFrame(state);
+    }
+    if (bOk) bOk = writeFrame(state);
+    m_Stats.finish();
+    if (m_File.isOpen()) m_File.flush();
+    m_nTime += timer.nsecsElapsed();
+    return bOk;
+}
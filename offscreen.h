@@ -0,0 +1,60 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <QFile>
+#include <QImage>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include "cube.h"
+#include "framestats.h"
+
+#define DEFAULT_FRAME_WIDTH      640
+#define DEFAULT_FRAME_HEIGHT     480
+#define DEFAULT_FRAME_RATE       30                                             // [frames/s] of the played video
+
+typedef enum {
+    FRAMES_PNG,                                                                 // one numbered PNG file per frame in a directory
+    FRAMES_RGBA,                                                                // raw RGBA frames one after another, top row first
+} FRAMEFORMAT;
+
+//---------------------------------------------------------------------------
+// Rendering of the playback of moves without any window: the GL context draws into a framebuffer object of an
+// offscreen surface (Mesa's software GL is enough) with the same TCube::draw() and the same view as the widget.
+// The turns are animated by the frame time instead of the clock, so every turn has the same number of frames
+// however slow the rendering is. Each frame is written as soon as it is drawn and only one frame is kept in
+// memory, so a long solution needs no more memory than a short one
+//---------------------------------------------------------------------------
+class TOffscreenRenderer {
+protected:
+    int m_nWidth, m_nHeight;
+    int m_nTurnDuration;                                                        // [ms]
+    int m_nFrameRate;
+    QOpenGLContext m_Context;
+    QOffscreenSurface m_Surface;
+    QOpenGLFramebufferObject* m_pFbo;
+    QImage m_Frame;                                                             // the last frame, its memory is used again
+    FRAMEFORMAT m_nFormat;
+    QString m_Output;                                                           // directory of the PNG files, raw file or "-"
+    QFile m_File;
+    int m_nFrames;
+    qint64 m_nTime;                                                             // [ns] of drawing and writing all frames
+    QString m_Error;
+    TFrameStats m_Stats;                                                        // of drawing the frames, without reading and writing them
+
+    bool writeFrame(TCube& cube);
+
+public:
+    TOffscreenRenderer(int nWidth = DEFAULT_FRAME_WIDTH, int nHeight = DEFAULT_FRAME_HEIGHT,
+                       int nTurnDuration = DEFAULT_TURN_DURATION, int nFrameRate = DEFAULT_FRAME_RATE);
+    ~TOffscreenRenderer();
+    bool open(const QString& output);                                           // creates the context; *.rgba or "-" - raw frames
+    bool play(const TCube& cube, const QVector<ROTATIONS>& moves);              // the start state, then every turn
+    void close(void);
+    int frames(void) const                              { return m_nFrames; };
+    double framesPerSecond(void) const                  { return m_nTime ? m_nFrames * 1e9 / m_nTime : 0.0; };
+    const QString& error(void) const                    { return m_Error; };
+    const TFrameStats& frameStats(void) const           { return m_Stats; };
+};
+
+#endif // OFFSCREEN_H
@@ -1,6 +1,10 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include "oglwidget.h"
+#include "solver.h"
+#include <QtConcurrent>
+#include <QDateTime>
+#include <cstdio>
 
 #define SPHERE_DIAMETER         3*4.1f
 
@@ -10,33 +14,49 @@ float     g_fScale = 1.5f;
 OGLWidget::OGLWidget(QWidget *parent)
     : QGLWidget(parent)
 {
-    mxRotation[0]=1.0f;                                                         // Column 1 - resetting the cube's position in space
-    mxRotation[1]=0.0f;
-    mxRotation[2]=0.0f;
-    mxRotation[3]=0.0f;
-    mxRotation[4]=0.0f;                                                         // Column 2
-    mxRotation[5]=1.0f;
-    mxRotation[6]=0.0f;
-    mxRotation[7]=0.0f;
-    mxRotation[8]=0.0;                                                          // Column 3
-    mxRotation[9]=0.0;
-    mxRotation[10]=1.0;
-    mxRotation[11]=0.0;
-    mxRotation[12]=0.0;                                                         // Column 4
-    mxRotation[13]=0.0;
-    mxRotation[14]=0.0;
-    mxRotation[15]=1.0;
+    arcballPending = false;                                                     // the cube is in its initial position (orientation is identity)
+    frameStatsShown = false;
+    frameAnimating = false;
 
     cube = new TCube(this);
+    colourNeutral = false;
+    racePolicy = -1;
+    improvementCancel = false;
+    improvementQueueLength = 0;
+    improvementSkip = 0;
     solvingTimer = new QTimer();
     solvingTimer->setInterval(20);
+    frameClock.start();
+    renderThread = new TRenderThread(this, &states);
 
     QObject::connect(solvingTimer, SIGNAL(timeout()), this, SLOT(solvingTimerTick()));
+    QObject::connect(&batch, &QFutureWatcher<QString>::finished, this, [this]() { emit statusMessage(batch.result()); });
+    QObject::connect(&race, &QFutureWatcher<TRaceResult>::finished, this, [this]() {
+        const TRaceResult& result = race.result();
+        if (result.bSolved && cube->checkSolution(result.solution)) {           // the plan is played only if it really solves the cube
+            cube->setMoves(result.solution, result.solution.length());
+            setSolvingInterval(10);
+        }
+        emit statusMessage(result.report);
+        startSolving();                                                         // without a solution the cube is solved stage by stage
+    });
+    QObject::connect(&gridPlanning, &QFutureWatcher<TBatchResult>::finished, this, [this]() {
+        grid.startSolutions();
+        solvingTimer->start();
+        emit statusMessage(QString("Grid: ") + gridPlanning.result().report());
+    });
+    QObject::connect(renderThread, &TRenderThread::frameSwapped, this, &OGLWidget::onFrameSwapped, Qt::QueuedConnection);
 }
 
 //---------------------------------------------------------------------------
 OGLWidget::~OGLWidget()
 {
+    cancelImprovement();
+    race.waitForFinished();
+    batch.waitForFinished();
+    gridPlanning.waitForFinished();
+    renderThread->stop();                                                       // the thread destroys the buffers of the renderer and gives the context back
+    delete renderThread;
     delete cube;
 }
 
@@ -48,8 +68,19 @@ void OGLWidget::solvingTimerTick()
 //        return;
 //    }
 
+    if (grid.count()) {
+        if (!grid.playMoves()) {
+            solvingTimer->stop();
+            emit statusMessage(QString("Grid: all %1 cubes played their solutions").arg(grid.count()));
+        }
+        this->update();
+        return;
+    }
+    checkImprovement();
     if (cube->solve()) {
         solvingTimer->stop();
+        cancelImprovement();
+        emit statusMessage(QString("Solved: %1 moves planned, %2 played after the optimisation").arg(cube->plannedMoves()).arg(cube->optimizedMoves()));
         return;
     }
 }
@@ -60,10 +91,191 @@ void OGLWidget::setSolvingInterval(int interval)
     solvingTimer->setInterval(interval);
 }
 
+//---------------------------------------------------------------------------
+void OGLWidget::setColourNeutral(bool bEnabled)
+{
+    colourNeutral = bEnabled;
+}
+
+//---------------------------------------------------------------------------
+void OGLWidget::setRace(int nIndex)                                             // 0 - no race, then the RACEPOLICY values
+{
+    racePolicy = nIndex - 1;
+}
+
+//---------------------------------------------------------------------------
+void OGLWidget::setTurnDuration(int nDuration)                                  // [ms], 0 - no animation
+{
+    cube->setTurnDuration(nDuration);
+    grid.setTurnDuration(nDuration);
+}
+
+//---------------------------------------------------------------------------
+// 0 - the single cube again; the grid is not changed while its solutions are planned
+//---------------------------------------------------------------------------
+void OGLWidget::setGridCubes(int nCubes)
+{
+    if (gridPlanning.isRunning()) return;
+    solvingTimer->stop();
+    cancelImprovement();
+    grid.resize(nCubes);
+    this->update();
+}
+
+//---------------------------------------------------------------------------
+// The cubes of the grid are solved by the batch solver in the background; the moves are played when all are planned
+//---------------------------------------------------------------------------
+void OGLWidget::solveGrid(void)
+{
+    if (gridPlanning.isRunning()) return;
+    if (solvingTimer->isActive()) {
+        solvingTimer->stop();
+        return;
+    }
+    grid.finishAnimations();                                                    // the threads read the cubes, the frames must not turn them
+    emit statusMessage(QString("Grid: solving %1 cubes...").arg(grid.count()));
+    gridPlanning.setFuture(QtConcurrent::run([this]() { return grid.plan(); }));
+}
+
+//---------------------------------------------------------------------------
+// The widget is drawn again and again while the timing is shown, so the frame rate is that of the drawing itself
+//---------------------------------------------------------------------------
+void OGLWidget::setFrameStats(bool bEnabled)
+{
+    frameStatsShown = bEnabled;
+    this->update();
+}
+
+//---------------------------------------------------------------------------
+// All solving strategies are raced on their own threads, in the background, so the window keeps answering while
+// the race waits for its deadline; the winner's solution is put into the cube's queue when the race is over
+//---------------------------------------------------------------------------
+bool OGLWidget::planRaceSolution()
+{
+    RACEPOLICY nPolicy = (RACEPOLICY)racePolicy;
+
+    if (cube->check()) return false;
+    TCube start(*cube);
+    emit statusMessage(QString("Race (%1)...").arg(TPortfolioSolver::policyName(nPolicy)));
+    race.setFuture(QtConcurrent::run([start, nPolicy]() {
+        TPortfolioSolver solver(nPolicy);
+        TRaceResult result;
+        result.bSolved = solver.solve(start, result.solution);
+        result.report = solver.report();
+        return result;
+    }));
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// The solution is planned from each of the six cross colors and the shortest one is put into the cube's queue
+//---------------------------------------------------------------------------
+void OGLWidget::planColourNeutralSolution()
+{
+    QVector<ROTATIONS> solution;
+    SIDECOLOR crossColor;
+    int nPlanned;
+
+    if (cube->check()) return;
+    if (!cube->planColourNeutralSolution(solution, crossColor, nPlanned) || !cube->checkSolution(solution)) {
+        emit statusMessage("Colour neutral: no solution found, solving layer by layer");
+        return;
+    }
+    cube->setMoves(solution, nPlanned);
+    setSolvingInterval(10);
+    emit statusMessage(QString("Colour neutral: %1 cross, %2 moves (%3 before the optimisation)").arg(cubeColorToString(crossColor)).arg(solution.length()).arg(nPlanned));
+}
+
+//---------------------------------------------------------------------------
+// The layer by layer solution is planned at once on a copy of the cube, so it can be improved while it is played
+// If it cannot be planned, the cube is solved stage by stage as before
+//---------------------------------------------------------------------------
+void OGLWidget::planLayerByLayerSolution()
+{
+    QVector<ROTATIONS> solution;
+    int nPlanned;
+
+    if (cube->check() || !cube->queuedMoves().isEmpty()) return;
+    if (!cube->planSolutionWithCross(WHITE, solution)) return;
+    nPlanned = solution.length();
+    optimizeMoves(solution);
+    if (!cube->checkSolution(solution)) return;
+    cube->setMoves(solution, nPlanned);
+    setSolvingInterval(10);
+}
+
+//---------------------------------------------------------------------------
+// Anytime solving: while the queue is played, a shorter solution is searched for on a background thread.
+// The search starts from the state after the first improvementSkip moves of the queue, so it is still ahead of the
+// playback when it finishes, and its result replaces the rest of the queue from that state
+//---------------------------------------------------------------------------
+void OGLWidget::startImprovement()
+{
+    const QVector<ROTATIONS>& queue = cube->queuedMoves();
+    int i;
+
+    if (!improvement.isFinished()) return;
+    if (improvementTimer.hasExpired(IMPROVEMENT_TIME_BUDGET)) return;
+    if (queue.length() <= improvementSkip) return;                              // the rest of the solution is too short to improve
+
+    TCube start(*cube);
+    for (i=0; i<improvementSkip; i++) start.makeMove(queue.at(i), FALSE);
+    improvementQueueLength = queue.length();
+    improvementCancel = false;
+
+    QVector<ROTATIONS>* pResult = &improvedMoves;
+    std::atomic<bool>* pCancel = &improvementCancel;
+    int nMaxMoves = queue.length() - improvementSkip;
+    improvement = QtConcurrent::run([start, pResult, pCancel, nMaxMoves]() {
+        return start.planShorterSolution(*pResult, nMaxMoves, IMPROVEMENT_TIME_SLICE, pCancel);
+    });
+}
+
+//---------------------------------------------------------------------------
+void OGLWidget::checkImprovement()
+{
+    int nPlayed;
+
+    if (improvementQueueLength == 0 || !improvement.isFinished()) return;         // no search is running or it is not finished yet
+    nPlayed = improvementQueueLength - cube->queuedMoves().length();
+    improvementQueueLength = 0;
+
+    if (nPlayed > improvementSkip) {                                            // the playback has overtaken the search,
+        improvementSkip *= 2;                                                   // so the next one starts further ahead
+    }
+    else if (improvement.result() && cube->checkSolution(improvedMoves, improvementSkip - nPlayed)) {
+        int nShorter = cube->queuedMoves().length() - (improvementSkip - nPlayed) - improvedMoves.length();
+        cube->replaceMoves(improvementSkip - nPlayed, improvedMoves);
+        emit statusMessage(QString("Anytime: solution improved by %1 moves, %2 moves left").arg(nShorter).arg(cube->queuedMoves().length()));
+    }
+    startImprovement();                                                         // the search continues from a later state until the time is over
+}
+
+//---------------------------------------------------------------------------
+void OGLWidget::cancelImprovement()
+{
+    improvementCancel = true;
+    improvement.waitForFinished();
+    improvementQueueLength = 0;
+}
+
 //---------------------------------------------------------------------------
 void OGLWidget::on_pushButtonRandom_clicked()
 {
-    cube->random();
+    quint64 nSeed = (quint64)QDateTime::currentMSecsSinceEpoch();
+
+    if (grid.count()) {
+        if (gridPlanning.isRunning()) return;
+        solvingTimer->stop();
+        grid.random(nSeed);
+        emit statusMessage(QString("Random grid of %1 cubes, seed %2").arg(grid.count()).arg(nSeed));
+        this->update();
+        return;
+    }
+    if (race.isRunning()) return;                                               // the race plans the present state
+    cancelImprovement();
+    cube->random(nSeed);
+    emit statusMessage(QString("Random cube, seed %1").arg(nSeed));
     this->update();
 }
 
@@ -71,16 +283,51 @@ void OGLWidget::on_pushButtonRandom_clicked()
 void OGLWidget::on_pushButtonSolve_clicked()
 {
     solvingCnt = 0;
-
+    if (grid.count()) {
+        solveGrid();
+        return;
+    }
 
     if (solvingTimer->isActive()) {
         solvingTimer->stop();
+        cancelImprovement();
     }
     else {
-        solvingTimer->start();
+        if (race.isRunning()) return;
+        cube->clearMoveCounts();
+        if (racePolicy >= 0) {
+            if (planRaceSolution()) return;                                     // the solving starts when the race is over
+        }
+        else if (colourNeutral) planColourNeutralSolution();
+        else planLayerByLayerSolution();
+        startSolving();
     }
 }
 
+//---------------------------------------------------------------------------
+void OGLWidget::startSolving()
+{
+    solvingTimer->start();
+    improvementTimer.start();
+    improvementSkip = 3;
+    startImprovement();
+}
+
+//---------------------------------------------------------------------------
+// Benchmark of the solver: the same BATCH_CUBES scrambles are solved on all cores, so the results can be compared
+//---------------------------------------------------------------------------
+void OGLWidget::on_pushButtonBatch_clicked()
+{
+    if (batch.isRunning()) return;
+
+    emit statusMessage(QString("Batch: solving %1 cubes...").arg(BATCH_CUBES));
+    batch.setFuture(QtConcurrent::run([]() {
+        QVector<quint32> seeds;
+        for (int i=0; i<BATCH_CUBES; i++) seeds.append(i);
+        return TBatchSolver().solveSeeds(seeds).report();
+    }));
+}
+
 //---------------------------------------------------------------------------
 void OGLWidget::mousePressEvent(QMouseEvent *e)
 {
@@ -91,30 +338,48 @@ void OGLWidget::mousePressEvent(QMouseEvent *e)
     if (e->button() == Qt::RightButton) {
         this->setCursor(Qt::OpenHandCursor);
         RMBPressPosition = QVector2D(e->localPos());
+        RMBPosition = RMBPressPosition;
     }
 }
 
 //---------------------------------------------------------------------------
 void OGLWidget::mouseMoveEvent(QMouseEvent* e)
 {
-    if (e->buttons() & Qt::RightButton) {
-
-        QVector2D diff = QVector2D(e->localPos()) - RMBPressPosition;
-        QVector3D n = QVector3D(diff.y(), diff.x(), 0.0).normalized();              // Rotation axis is perpendicular to the mouse position difference vector
+    if (e->buttons() & Qt::RightButton) {                                           // only the position is kept, the next frame turns the cube
+        RMBPosition = QVector2D(e->localPos());
+        if (!arcballPending) {
+            arcballPending = true;
+            this->update();
+        }
+    }
+}
 
-        qreal acc = diff.length();                                                  // Accelerate angular speed relative to the length of the mouse sweep
-        rotationAxis = (rotationAxis * 0 + n * acc).normalized();                   // Calculate new rotation axis as weighted sum
+//---------------------------------------------------------------------------
+// Point of the arcball (the sphere inscribed in the window) under a point of the window; outside of the sphere the
+// nearest point of its edge
+//---------------------------------------------------------------------------
+QVector3D OGLWidget::arcballPoint(const QVector2D& ptWnd) const
+{
+    float fRadius = qMax(1, qMin(width(), height())) / 2.0f;
+    QVector3D v((ptWnd.x() - width()/2.0f) / fRadius, (height()/2.0f - ptWnd.y()) / fRadius, 0.0f);
+    float fLength = v.x()*v.x() + v.y()*v.y();
 
-        glPushMatrix();                                                             // once the model matrix is ​​loaded
-            glLoadIdentity();                                                       // we set it to the initial position
-            glRotatef(acc, rotationAxis.x(), rotationAxis.y(), rotationAxis.z());   // we rotate the matrix by a given angle around the previously calculated vector
-            glMultMatrixf((GLfloat*)mxRotation);                                    // then we multiply by the rotation matrix previously written
-            glGetFloatv(GL_MODELVIEW_MATRIX, mxRotation);                           // and finally we write the entire operation into the rotation matrix
-        glPopMatrix();
+    if (fLength <= 1.0f) v.setZ(sqrtf(1.0f - fLength));
+    else v.normalize();
+    return v;
+}
 
-        this->update();
-        RMBPressPosition = QVector2D(e->localPos());
-    }
+//---------------------------------------------------------------------------
+// All mouse moves since the last frame make one rotation, from the arcball point of the last frame to the present one.
+// It is made in the space of the camera, so it is applied before the rotations made so far
+//---------------------------------------------------------------------------
+void OGLWidget::applyArcball()
+{
+    if (!arcballPending) return;
+    arcballPending = false;
+    QQuaternion drag = QQuaternion::rotationTo(arcballPoint(RMBPressPosition), arcballPoint(RMBPosition));
+    orientation = (drag * orientation).normalized();
+    RMBPressPosition = RMBPosition;
 }
 
 //---------------------------------------------------------------------------
@@ -122,15 +387,9 @@ void OGLWidget::mouseReleaseEvent(QMouseEvent *e)
 {
     this->setCursor(Qt::ArrowCursor);
 
-    if (e->button() == Qt::LeftButton) {
-
-        GLint nViewPort[4];
-        GLdouble mxProjection[16];
-
+    if (e->button() == Qt::LeftButton && !grid.count() && !race.isRunning()) {      // the cubes of the grid are not turned by the mouse
         if (e->x() != LMBPressPosition.x() || e->y() != LMBPressPosition.y()) {
-            glGetDoublev(GL_PROJECTION_MATRIX, mxProjection);                       // we read the projection matrix
-            glGetIntegerv(GL_VIEWPORT, nViewPort);                                  // and the dimensions of the display window and rotate the cube
-            if (cube->rotate(mxProjection, mxLastModel, nViewPort,
+            if (cube->rotate(mxProjection * modelViewMatrix(orientation),           // the matrices of the last frame, without reading them from GL
                              this->width(), this->height(),
                              e->x(), e->y(),
                              LMBPressPosition.x(), LMBPressPosition.y(),
@@ -142,19 +401,21 @@ void OGLWidget::mouseReleaseEvent(QMouseEvent *e)
 }
 
 //---------------------------------------------------------------------------
-void OGLWidget::initializeGL()
+// The widget only keeps the projection for the picking; the viewport is set by the render thread with the next state
+//---------------------------------------------------------------------------
+void OGLWidget::resizeEvent(QResizeEvent *e)
 {
-    glEnable(GL_LINE_SMOOTH);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);							                                // The Type Of Depth Testing To Do
-    glLineWidth(1.5);
-    resizeGL(this->width(),this->height());
+    Q_UNUSED(e);
+    mxProjection = projectionMatrix(this->width(), this->height());
+    this->update();
 }
 
 //---------------------------------------------------------------------------
-void OGLWidget::resizeGL(int w, int h)
+// Orthographic projection of the sphere around the cube, also used by the offscreen rendering
+//---------------------------------------------------------------------------
+QMatrix4x4 OGLWidget::projectionMatrix(int w, int h)
 {
-    glViewport(0, 0, w, h);
+    QMatrix4x4 matrix;
     qreal zNear  = 1.0f;                                                            // Pretty much always want this.
     qreal zFar   = zNear + SPHERE_DIAMETER;
     qreal left   = 0.0f - SPHERE_DIAMETER/2;
@@ -170,31 +431,86 @@ void OGLWidget::resizeGL(int w, int h)
         left *= aspect;
         right *= aspect;
     }
+    matrix.ortho(left, right, bottom, top, zNear, zFar);
+    return matrix;
+}
+
+//---------------------------------------------------------------------------
+void OGLWidget::loadProjection(int w, int h)
+{
     glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(left, right, bottom, top, zNear, zFar);
+    glLoadMatrixf(projectionMatrix(w, h).constData());
     glMatrixMode(GL_MODELVIEW);
 }
 
 //---------------------------------------------------------------------------
-void OGLWidget::paintGL()
+// Camera and the position of the cube in space; computed on the CPU, so the picking uses the same matrix as the drawing
+//---------------------------------------------------------------------------
+QMatrix4x4 OGLWidget::modelViewMatrix(const QQuaternion& orientation)
+{
+    QMatrix4x4 matrix;
+
+    matrix.lookAt(QVector3D(0,0,1+SPHERE_DIAMETER/2), QVector3D(0,0,0), QVector3D(0,1,0));   // camera setting
+    matrix.scale(g_fScale);                                                     // cube scaling
+    matrix.rotate(orientation);                                                 // setting the position of the cube in space
+    //matrix.rotate(30,1,0,0);                                                  // By default, the cube is set at an angle of 30 degrees. to the X axis
+    //matrix.rotate(45,0,1,0);                                                  // By default, the cube is set at an angle of 45 degrees. to the Y axis
+    matrix.rotate(20,1,0,0);                                                    // By default, the cube is set at an angle of 20 degrees. to the X axis
+    matrix.rotate(-20,0,1,0);                                                   // By default, the cube is set at an angle of 45 degrees. to the Y axis
+    return matrix;
+}
+
+//---------------------------------------------------------------------------
+// The context is given to the render thread by the first paint event, when the window exists
+//---------------------------------------------------------------------------
+void OGLWidget::paintEvent(QPaintEvent *e)
 {
-    glClearColor(0.39f,0.58f,0.93f,1.f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);                             // clear the window with the color wheel and background and set the depth buffer
+    Q_UNUSED(e);
+    if (!renderThread->isRunning()) {
+        doneCurrent();
+        context()->moveToThread(renderThread);
+        renderThread->start();
+    }
+    publishFrame();
+}
 
-    glPushMatrix();
-        gluLookAt(0,0,1+SPHERE_DIAMETER/2, 0,0,0, 0,1,0);                           // camera setting
-        glScalef(g_fScale, g_fScale, g_fScale);                                     // cube scaling
-        glMultMatrixf((GLfloat*)mxRotation);                                        // setting the position of the cube in space
-        //glRotatef(30,1,0,0);                                                      // By default, the cube is set at an angle of 30 degrees. to the X axis
-        //glRotatef(45,0,1,0);                                                      // By default, the cube is set at an angle of 45 degrees. to the Y axis
-        glRotatef(20,1,0,0);                                                        // By default, the cube is set at an angle of 20 degrees. to the X axis
-        glRotatef(-20,0,1,0);                                                       // By default, the cube is set at an angle of 45 degrees. to the Y axis
-        glGetDoublev(GL_MODELVIEW_MATRIX, mxLastModel);                             // remembering the display model
-        cube->draw();                                                               // drawing a cube
-    glPopMatrix();
+//---------------------------------------------------------------------------
+// The turns go on and the mouse rotation is applied here, on the thread that owns the cubes; the frame gets a copy
+// of the cubes after that and is drawn on the render thread while this thread goes on
+//---------------------------------------------------------------------------
+void OGLWidget::publishFrame(void)
+{
+    qreal fRatio = this->devicePixelRatio();
+    bool bAnimating;
+
+    applyArcball();
+    QMatrix4x4 mxModel = modelViewMatrix(orientation);
+    if (grid.count()) {
+        mxModel.scale(grid.scale());                                                // the grid takes the place of the cube
+        bAnimating = grid.animate(frameClock.elapsed());
+    }
+    else bAnimating = cube->animate(frameClock.elapsed());
 
+    QVector3D vOffset;
+    TFrameState& state = grid.count() ? states.write(grid.cubes(), grid.offsets(), grid.count())
+                                      : states.write(&cube, &vOffset, 1);
+    state.mxProjection = mxProjection;
+    state.mxModel = mxModel;
+    state.nWidth = qRound(this->width() * fRatio);
+    state.nHeight = qRound(this->height() * fRatio);
+    state.bFrameStats = frameStatsShown;
+    states.publish();
+    renderThread->wake();
+    frameAnimating = bAnimating || frameStatsShown;                                 // the timing is measured on frames drawn one after another
 }
 
 //---------------------------------------------------------------------------
+// The turn goes on: the next frame is published when the render thread has swapped this one, so the frames
+// follow the display and not a timer
+//---------------------------------------------------------------------------
+void OGLWidget::onFrameSwapped()
+{
+    if (frameAnimating) this->update();
+}
 
+//---------------------------------------------------------------------------
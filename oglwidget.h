@@ -3,11 +3,24 @@
 
 #include <QWidget>
 #include <QOpenGLWidget>
+#include <QtOpenGL>
 #include <gl/GLU.h>
 #include <gl/GL.h>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QQuaternion>
+#include <atomic>
 #include "cube.h"
+#include "cubegrid.h"
+#include "statebuffer.h"
+#include "renderthread.h"
 
-class OGLWidget : public QGLWidget
+#define IMPROVEMENT_TIME_BUDGET  3000                                           // [ms] how long the shorter solution is searched for in the background
+#define IMPROVEMENT_TIME_SLICE   250                                            // [ms] time of a single search, after which its result is used
+#define BATCH_CUBES              1000                                           // number of cubes solved by the benchmark
+
+class OGLWidget : public QGLWidget, public TCubeView
 {
     Q_OBJECT
 
@@ -15,34 +28,81 @@ public:
     OGLWidget(QWidget *parent = 0);
     ~OGLWidget();
 
-    void setSolvingInterval(int interval);
+    void setSolvingInterval(int interval) override;
+    void cubeChanged(void) override                     { update(); };
+    static QMatrix4x4 projectionMatrix(int w, int h);
+    static QMatrix4x4 modelViewMatrix(const QQuaternion& orientation);
+    static void loadProjection(int w, int h);
+
+signals:
+  void statusMessage(const QString& message);
 
 public slots:
   void on_pushButtonRandom_clicked();
   void on_pushButtonSolve_clicked();
+  void on_pushButtonBatch_clicked();
   void solvingTimerTick();
+  void setColourNeutral(bool bEnabled);
+  void setRace(int nIndex);
+  void setTurnDuration(int nDuration);
+  void setFrameStats(bool bEnabled);
+  void setGridCubes(int nCubes);
+  void onFrameSwapped();
 
 protected:
-    void initializeGL() override;
-    void resizeGL(int w, int h) override;
-    void paintGL() override;
+    void paintEvent(QPaintEvent *e) override;                                         // no GL work on the GUI thread, the frames are drawn by renderThread
+    void resizeEvent(QResizeEvent *e) override;
     void mousePressEvent(QMouseEvent *e) override;
     void mouseMoveEvent(QMouseEvent* e) override;
     void mouseReleaseEvent(QMouseEvent *e) override;
 
 private:
+    void planColourNeutralSolution();
+    void planLayerByLayerSolution();
+    bool planRaceSolution();                                                          // false - nothing to solve
+    void startSolving();
+    void startImprovement();
+    void checkImprovement();
+    void cancelImprovement();
+    QVector3D arcballPoint(const QVector2D& ptWnd) const;
+    void applyArcball();
+    void publishFrame(void);
+    void solveGrid(void);
 
     int     solvingCnt;
     QTimer *solvingTimer;
+    bool    colourNeutral;                                                            // the whole solution is planned at once from the best cross color
+    int     racePolicy;                                                               // RACEPOLICY of the portfolio solver, -1 - no race
+
+    QFuture<bool>      improvement;                                                   // background search for a shorter continuation of the queue
+    QVector<ROTATIONS> improvedMoves;                                                 // result of that search
+    std::atomic<bool>  improvementCancel;
+    QElapsedTimer      improvementTimer;                                              // time of improving the current solution
+    int     improvementQueueLength;                                                   // length of the queue when the search started
+    int     improvementSkip;                                                          // the continuation starts after so many moves of that queue
+
+    QFutureWatcher<QString> batch;                                                    // benchmark running in the background, its result is the report
+    QFutureWatcher<TRaceResult> race;                                                 // race of the strategies, the cube is solved when it is over
+
+    TCubeGrid grid;                                                                   // shown instead of the cube when it has cubes
+    QFutureWatcher<TBatchResult> gridPlanning;                                        // solutions of the grid planned on all cores
+
+    QElapsedTimer frameClock;                                                         // time of the frames for the animation of the turns
 
     QVector2D LMBPressPosition;
-    QVector2D RMBPressPosition;
-    QVector3D rotationAxis;
+    QVector2D RMBPressPosition;                                                       // arcball position of the last frame
+    QVector2D RMBPosition;                                                            // the latest mouse position, used by the next frame
+    bool      arcballPending;                                                         // the mouse moved since the last frame
 
-    float     mxRotation[16];                                                         // summed rotation matrix
-    double    mxLastModel[16];                                                        // model matrix
+    QQuaternion orientation;                                                          // summed rotation of the cube by the mouse
+    QMatrix4x4 mxProjection;                                                          // projection of the window, the same as in GL
 
     TCube *cube;
+    bool frameStatsShown;
+
+    TStateBuffer states;                                                              // the cubes as drawn, from this thread to renderThread
+    TRenderThread *renderThread;                                                      // started by the first paint event
+    bool frameAnimating;                                                              // the next frame is published when this one is swapped
 };
 
 #endif // OGLWIDGET_H
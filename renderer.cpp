@@ -0,0 +1,331 @@
+#include "renderer.h"
+#include <algorithm>
+
+#define ATTR_POSITION            0                                              // attribute locations of the shaders
+#define ATTR_UV                  1
+#define ATTR_AXIS                2
+#define ATTR_PIECE               3
+#define ATTR_ROTATION            4
+#define ATTR_COLORS_RLT          5                                              // colors of the sides RIGHT, LEFT, TOP
+#define ATTR_COLORS_BFB          6                                              // colors of the sides BOTTOM, FRONT, BACK
+#define ATTR_OFFSET              7
+#define ATTR_OUTSIDE             8
+
+static const char* g_sVertexShader =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 position;\n"
+    "layout(location = 1) in vec2 uv;\n"
+    "layout(location = 2) in float axis;\n"
+    "layout(location = 3) in vec3 piece;\n"
+    "layout(location = 4) in vec4 rotation;\n"
+    "layout(location = 5) in vec3 colorsRLT;\n"
+    "layout(location = 6) in vec3 colorsBFB;\n"
+    "layout(location = 7) in vec3 offset;\n"
+    "layout(location = 8) in vec3 outside;\n"
+    "uniform mat4 mvp;\n"
+    "uniform vec3 palette[8];\n"
+    "out vec2 vUV;\n"
+    "flat out vec3 vColor;\n"
+    "flat out float vBorder;\n"
+    "void main() {\n"
+    "    int i = int(axis + 0.5);\n"
+    "    if (outside[i] == 0.0) {\n"                                            // inside on this axis, the triangles are dropped
+    "        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec3 p = position;\n"
+    "    p[i] *= outside[i];\n"                                                 // turned by 180 degrees to the negative side,
+    "    p[(i + 1) % 3] *= outside[i];\n"                                       // so it stays counterclockwise from outside
+    "    p += piece;\n"
+    "    if (rotation.w != 0.0) {\n"                                            // the piece turns with its section, as glRotatef() did
+    "        vec3 k = normalize(rotation.xyz);\n"
+    "        float a = radians(rotation.w);\n"
+    "        p = p*cos(a) + cross(k, p)*sin(a) + k*dot(k, p)*(1.0 - cos(a));\n"
+    "    }\n"
+    "    int s = 2*i + (outside[i] < 0.0 ? 1 : 0);\n"
+    "    int c = int((s < 3 ? colorsRLT[s] : colorsBFB[s-3]) + 0.5);\n"
+    "    vColor = palette[c];\n"
+    "    vBorder = c == 6 ? 0.0 : 1.0;\n"                                       // no border on the black sides (BLACK)
+    "    vUV = uv;\n"
+    "    gl_Position = mvp * vec4(p + offset, 1.0);\n"
+    "}\n";
+
+static const char* g_sFragmentShader =
+    "#version 330 core\n"
+    "in vec2 vUV;\n"
+    "flat in vec3 vColor;\n"
+    "flat in float vBorder;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    vec2 d = min(vUV, 1.0 - vUV);\n"
+    "    vec2 w = 1.5 * fwidth(vUV);\n"                                         // the border is 1.5 pixels wide, as the lines were
+    "    bool edge = vBorder > 0.5 && (d.x < w.x || d.y < w.y);\n"
+    "    fragColor = vec4(edge || !gl_FrontFacing ? vec3(0.0) : vColor, 1.0);\n"
+    "}\n";
+
+//---------------------------------------------------------------------------
+TCubeRenderer::TCubeRenderer()
+    : m_Mesh(QOpenGLBuffer::VertexBuffer), m_Positions(QOpenGLBuffer::VertexBuffer), m_Instances(QOpenGLBuffer::VertexBuffer)
+{
+    m_nSlots = 0;
+    m_nLayout = -1;
+    m_nUploadedBytes = 0;
+    m_nUploads = 0;
+    m_bValid = false;
+}
+
+//---------------------------------------------------------------------------
+// The mesh of a piece: two triangles on the positive side of each axis, counterclockwise when seen from outside.
+// The pieces on the surface get their places in the buffers in the order x, y, z, so the pieces of an X section are
+// one range, and the sides of the cube they are on
+//---------------------------------------------------------------------------
+bool TCubeRenderer::initialize(void)
+{
+    static const float corners[4][2] = { {0,0}, {1,0}, {1,1}, {0,1} };
+    static const int triangles[6] = { 0, 1, 2, 0, 2, 3 };
+    TCubieVertex vertices[CUBIE_VERTICES];
+    QOpenGLContext* pContext = QOpenGLContext::currentContext();
+    int nVertex = 0;
+
+    destroy();
+    if (!pContext || pContext->isOpenGLES() || pContext->format().version() < qMakePair(3, 3)) return false;
+    initializeOpenGLFunctions();
+
+    for (int nAxis=0; nAxis<3; nAxis++) {                                       // RIGHT, TOP and FRONT, the shader mirrors them
+        int nU = (nAxis + 1) % 3, nV = (nAxis + 2) % 3;
+        for (int i=0; i<6; i++, nVertex++) {
+            int nCorner = triangles[i];
+            TCubieVertex& vertex = vertices[nVertex];
+            vertex.fPosition[nAxis] = 0.5f;
+            vertex.fPosition[nU] = corners[nCorner][0] - 0.5f;
+            vertex.fPosition[nV] = corners[nCorner][1] - 0.5f;
+            vertex.fUV[0] = corners[nCorner][0];
+            vertex.fUV[1] = corners[nCorner][1];
+            vertex.fAxis = nAxis;
+        }
+    }
+
+    m_nSlots = 0;
+    m_Centers.resize(0);
+    for (int x=0; x<cube_size; x++) {
+        for (int y=0; y<cube_size; y++) {
+            for (int z=0; z<cube_size; z++) {
+                bool bInside = x > 0 && x < cube_size-1 && y > 0 && y < cube_size-1 && z > 0 && z < cube_size-1;
+                m_nSlot[x][y][z] = bInside ? -1 : m_nSlots++;
+                if (bInside) continue;
+                int nPlace[3] = { x, y, z };
+                TPiecePosition piece;
+                for (int a=0; a<3; a++) {
+                    piece.fCenter[a] = nPlace[a] - (cube_size-1)/2.0f;
+                    piece.fOffset[a] = 0.0f;
+                    piece.fOutside[a] = nPlace[a] == 0 ? -1.0f : (nPlace[a] == cube_size-1 ? 1.0f : 0.0f);
+                }
+                m_Centers << piece;
+            }
+        }
+    }
+
+    if (!m_Program.addShaderFromSourceCode(QOpenGLShader::Vertex, g_sVertexShader) ||
+        !m_Program.addShaderFromSourceCode(QOpenGLShader::Fragment, g_sFragmentShader) || !m_Program.link()) {
+        qWarning("TCubeRenderer: %s", qPrintable(m_Program.log()));
+        m_Program.removeAllShaders();
+        return false;
+    }
+
+    m_Vao.create();
+    m_Vao.bind();
+    m_Mesh.create();
+    m_Mesh.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_Mesh.bind();
+    m_Mesh.allocate(vertices, sizeof(vertices));
+    glEnableVertexAttribArray(ATTR_POSITION);
+    glVertexAttribPointer(ATTR_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(TCubieVertex), (void*)offsetof(TCubieVertex, fPosition));
+    glEnableVertexAttribArray(ATTR_UV);
+    glVertexAttribPointer(ATTR_UV, 2, GL_FLOAT, GL_FALSE, sizeof(TCubieVertex), (void*)offsetof(TCubieVertex, fUV));
+    glEnableVertexAttribArray(ATTR_AXIS);
+    glVertexAttribPointer(ATTR_AXIS, 1, GL_FLOAT, GL_FALSE, sizeof(TCubieVertex), (void*)offsetof(TCubieVertex, fAxis));
+
+    m_Positions.create();                                                       // the buffers get their size from layout()
+    m_Positions.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_Positions.bind();
+    glEnableVertexAttribArray(ATTR_PIECE);
+    glVertexAttribPointer(ATTR_PIECE, 3, GL_FLOAT, GL_FALSE, sizeof(TPiecePosition), (void*)offsetof(TPiecePosition, fCenter));
+    glVertexAttribDivisor(ATTR_PIECE, 1);
+    glEnableVertexAttribArray(ATTR_OFFSET);
+    glVertexAttribPointer(ATTR_OFFSET, 3, GL_FLOAT, GL_FALSE, sizeof(TPiecePosition), (void*)offsetof(TPiecePosition, fOffset));
+    glVertexAttribDivisor(ATTR_OFFSET, 1);
+    glEnableVertexAttribArray(ATTR_OUTSIDE);
+    glVertexAttribPointer(ATTR_OUTSIDE, 3, GL_FLOAT, GL_FALSE, sizeof(TPiecePosition), (void*)offsetof(TPiecePosition, fOutside));
+    glVertexAttribDivisor(ATTR_OUTSIDE, 1);
+
+    m_Instances.create();
+    m_Instances.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_Instances.bind();
+    glEnableVertexAttribArray(ATTR_ROTATION);
+    glVertexAttribPointer(ATTR_ROTATION, 4, GL_FLOAT, GL_FALSE, sizeof(TPieceInstance), (void*)offsetof(TPieceInstance, fRotation));
+    glVertexAttribDivisor(ATTR_ROTATION, 1);
+    glEnableVertexAttribArray(ATTR_COLORS_RLT);
+    glVertexAttribPointer(ATTR_COLORS_RLT, 3, GL_FLOAT, GL_FALSE, sizeof(TPieceInstance), (void*)offsetof(TPieceInstance, fColor[SD_RIGHT]));
+    glVertexAttribDivisor(ATTR_COLORS_RLT, 1);
+    glEnableVertexAttribArray(ATTR_COLORS_BFB);
+    glVertexAttribPointer(ATTR_COLORS_BFB, 3, GL_FLOAT, GL_FALSE, sizeof(TPieceInstance), (void*)offsetof(TPieceInstance, fColor[SD_BOTTOM]));
+    glVertexAttribDivisor(ATTR_COLORS_BFB, 1);
+    m_Vao.release();
+    m_Instances.release();
+
+    m_Program.bind();
+    for (int i=0; i<(int)ELEMENTS_OF(m_rgb); i++) {
+        QString name = QString("palette[%1]").arg(i);
+        m_Program.setUniformValue(qPrintable(name), m_rgb[i].r / 255.0f, m_rgb[i].g / 255.0f, m_rgb[i].b / 255.0f);
+    }
+    m_Program.release();
+
+    m_nLayout = -1;                                                             // the first frame writes all pieces
+    m_bValid = true;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TCubeRenderer::destroy(void)
+{
+    if (m_Vao.isCreated()) m_Vao.destroy();
+    if (m_Mesh.isCreated()) m_Mesh.destroy();
+    if (m_Positions.isCreated()) m_Positions.destroy();
+    if (m_Instances.isCreated()) m_Instances.destroy();
+    m_Program.removeAllShaders();
+    m_nLayout = -1;
+    m_bValid = false;
+}
+
+//---------------------------------------------------------------------------
+void TCubeRenderer::setInstance(TPieceInstance& instance, const TCubePiece* pPiece)
+{
+    const QVector3D& vAxis = pPiece->rotationAxis();
+
+    instance.fRotation[0] = vAxis.x();
+    instance.fRotation[1] = vAxis.y();
+    instance.fRotation[2] = vAxis.z();
+    instance.fRotation[3] = pPiece->rotationAngle();
+    for (int side=SD_RIGHT; side<=SD_BACK; side++) instance.fColor[side] = pPiece->m_nSideColor[side];
+}
+
+//---------------------------------------------------------------------------
+// Other cubes or other positions: the positions are written again and no section is uploaded yet, so all pieces
+// of all cubes are written by the frame
+//---------------------------------------------------------------------------
+void TCubeRenderer::layout(const TFrameState& state)
+{
+    QVector<TPiecePosition> positions;
+    int nCubes = state.cubes.length();
+    int nPieces = nCubes * m_nSlots;
+
+    positions.reserve(nPieces);
+    for (int i=0; i<nCubes; i++) {
+        for (int nSlot=0; nSlot<m_nSlots; nSlot++) {
+            TPiecePosition piece = m_Centers.at(nSlot);
+            piece.fOffset[0] = state.offsets.at(i).x();
+            piece.fOffset[1] = state.offsets.at(i).y();
+            piece.fOffset[2] = state.offsets.at(i).z();
+            positions << piece;
+        }
+    }
+    m_Positions.bind();
+    m_Positions.allocate(positions.constData(), nPieces * sizeof(TPiecePosition));
+    m_Positions.release();
+    m_nVersions.fill(0, nCubes * 3*cube_size);                                  // 0 is no version of a snapshot
+    if (m_Data.length() != nPieces) {
+        m_Data.fill(TPieceInstance(), nPieces);
+        m_bChanged.fill(false, nPieces);
+        m_Changed.resize(0);
+        m_Changed.reserve(nPieces);
+        m_Instances.bind();
+        m_Instances.allocate(nPieces * sizeof(TPieceInstance));
+        m_Instances.release();
+    }
+    m_nLayout = state.nLayout;
+}
+
+//---------------------------------------------------------------------------
+void TCubeRenderer::changeSection(const TCubeSnapshot& cube, int nFirst, int nAxis, int nSection)
+{
+    for (int i=0; i<cube_size; i++) {
+        for (int j=0; j<cube_size; j++) {
+            int x = nAxis == 0 ? nSection : i;
+            int y = nAxis == 1 ? nSection : (nAxis == 0 ? i : j);
+            int z = nAxis == 2 ? nSection : j;
+            if (m_nSlot[x][y][z] < 0) continue;
+            int nSlot = nFirst + m_nSlot[x][y][z];
+            if (m_bChanged[nSlot]) continue;
+            setInstance(m_Data[nSlot], &cube.m_Pieces[x][y][z]);
+            m_bChanged[nSlot] = true;
+            m_Changed.append(nSlot);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// The changed pieces are written in ranges; two ranges closer than UPLOAD_GAP pieces are joined, since a few more
+// bytes cost less than another call. When a large part of the pieces has changed (many cubes of a grid turning
+// at once), the whole buffer is written by one call without sorting
+//---------------------------------------------------------------------------
+void TCubeRenderer::upload(void)
+{
+    m_Instances.bind();
+    if (m_Changed.length() * UPLOAD_WHOLE > m_Data.length()) {
+        m_Instances.write(0, m_Data.constData(), m_Data.length() * sizeof(TPieceInstance));
+        m_nUploadedBytes += m_Data.length() * sizeof(TPieceInstance);
+        m_nUploads++;
+    }
+    else {
+        std::sort(m_Changed.begin(), m_Changed.end());
+        for (int i=0; i<m_Changed.length(); ) {
+            int nFirst = m_Changed[i], nLast = nFirst;
+            for (i++; i<m_Changed.length() && m_Changed[i] - nLast <= UPLOAD_GAP + 1; i++) nLast = m_Changed[i];
+            int nBytes = (nLast - nFirst + 1) * sizeof(TPieceInstance);
+            m_Instances.write(nFirst * sizeof(TPieceInstance), m_Data.constData() + nFirst, nBytes);
+            m_nUploadedBytes += nBytes;
+            m_nUploads++;
+        }
+    }
+    m_Instances.release();
+    for (int i=0; i<m_Changed.length(); i++) m_bChanged[m_Changed[i]] = false;
+    m_Changed.resize(0);
+}
+
+//---------------------------------------------------------------------------
+// The sections whose versions in the snapshots differ from the uploaded ones are written; the states the render
+// thread has skipped need no more uploads than the last one, since the versions of the newest state cover them
+//---------------------------------------------------------------------------
+TDrawCount TCubeRenderer::draw(const TFrameState& state, const QMatrix4x4& mxViewProjection)
+{
+    int nCubes = state.cubes.length();
+    TDrawCount count = { 0, 0 };
+
+    if (!m_bValid || nCubes <= 0) return count;
+    if (state.nLayout != m_nLayout) layout(state);                              // other cubes, all their pieces are written
+    m_nUploadedBytes = 0;
+    m_nUploads = 0;
+    for (int i=0; i<nCubes; i++) {
+        const TCubeSnapshot& cube = state.cubes.at(i);
+        quint64* pVersions = m_nVersions.data() + i * 3*cube_size;
+        for (int nAxis=0; nAxis<3; nAxis++) {
+            for (int nSection=0; nSection<cube_size; nSection++) {
+                quint64& nVersion = pVersions[nAxis*cube_size + nSection];
+                if (nVersion == cube.m_nVersion[nAxis][nSection]) continue;
+                changeSection(cube, i * m_nSlots, nAxis, nSection);
+                nVersion = cube.m_nVersion[nAxis][nSection];
+            }
+        }
+    }
+    if (m_Changed.length()) upload();
+
+    m_Program.bind();
+    m_Program.setUniformValue("mvp", mxViewProjection);
+    m_Vao.bind();
+    glDrawArraysInstanced(GL_TRIANGLES, 0, CUBIE_VERTICES, nCubes * m_nSlots);  // not culled, the back faces fill the gaps
+    m_Vao.release();
+    m_Program.release();
+    count.nDrawCalls = 1;
+    count.nVertices = CUBIE_VERTICES * m_nSlots * nCubes;
+    return count;
+}
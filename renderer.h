@@ -0,0 +1,85 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include "cube.h"
+#include "statebuffer.h"
+
+#define CUBIE_VERTICES           18                                             // a side on each axis, 2 triangles each
+#define UPLOAD_GAP               4                                              // unchanged pieces between two changed ranges uploaded with them
+#define UPLOAD_WHOLE             4                                              // more than 1/UPLOAD_WHOLE of the pieces changed - one write of all
+
+class TCubieVertex {                                                            // vertex of the shared mesh of a piece
+public:
+    float fPosition[3];                                                         // on the positive side of its axis
+    float fUV[2];                                                               // 0..1 on the side, for the black border
+    float fAxis;                                                                // 0..2 - x, y, z
+};
+
+class TPiecePosition {                                                          // written only when the cubes change
+public:
+    float fCenter[3];                                                           // of the piece in its cube
+    float fOffset[3];                                                           // of the cube
+    float fOutside[3];                                                          // -1, 1 - the piece is on that side of the axis, 0 - inside
+};
+
+class TPieceInstance {                                                          // what changes on a piece, its place in the cube is in another buffer
+public:
+    float fRotation[4];                                                         // axis and angle [deg] of the animation
+    float fColor[6];                                                            // SIDECOLOR of each SIDE
+};
+
+//---------------------------------------------------------------------------
+// Renderer of the cube with vertex buffers and shaders: one mesh of a piece is shared by all pieces and the pieces
+// differ only in their instance data, so the whole cube is a single instanced draw call. The mesh has one side on
+// each axis, which the vertex shader turns to the outer side of the cube or drops for a piece inside on that axis,
+// so only the stickers are drawn, not the black inner sides. The back faces of the stickers are black and they
+// close the gaps opened by a turning section, as the inner sides did. The black borders of the stickers are drawn
+// by the fragment shader instead of the line loops. The matrix of the view comes with the frame
+// state as a uniform, the GL matrix stack is not used.
+// The instance buffer stays on the GPU between the frames: the cube marks the sections changed by a move (or by an
+// animation frame), the snapshot of the frame gives them new versions, and only the pieces of the sections of other
+// versions than the uploaded ones are written again, in as few ranges as possible, so the upload of a move does not
+// grow with the whole cube. The renderer reads only the snapshots, never the cubes, so it can run on its own thread.
+// More cubes (a grid) are drawn by the same single call: their pieces follow one another in the buffers and each
+// cube has its own offset in the positions, so the number of draw calls does not grow with the number of cubes.
+// The shaders need OpenGL 3.3; with an older context initialize() fails and TCubeSnapshot::draw() is used
+//---------------------------------------------------------------------------
+class TCubeRenderer : protected QOpenGLExtraFunctions {
+protected:
+    QOpenGLShaderProgram m_Program;
+    QOpenGLVertexArrayObject m_Vao;
+    QOpenGLBuffer m_Mesh;
+    QOpenGLBuffer m_Positions;                                                  // TPiecePosition of each drawn piece
+    QOpenGLBuffer m_Instances;
+    QVector<TPieceInstance> m_Data;                                             // copy of m_Instances
+    QVector<bool> m_bChanged;                                                   // pieces of m_Changed
+    QVector<int> m_Changed;                                                     // pieces to be uploaded in this frame
+    int m_nSlot[cube_size][cube_size][cube_size];                               // index of the piece in a cube, -1 inside the cube
+    int m_nSlots;                                                               // pieces drawn of one cube
+    QVector<TPiecePosition> m_Centers;                                          // of the drawn pieces of a cube, no offset
+    QVector<quint64> m_nVersions;                                               // of the uploaded sections, 3*cube_size per cube
+    int m_nLayout;                                                              // of the state in the buffers, -1 - none
+    int m_nUploadedBytes;                                                       // by the last frame
+    int m_nUploads;
+    bool m_bValid;
+
+    void setInstance(TPieceInstance& instance, const TCubePiece* pPiece);
+    void layout(const TFrameState& state);
+    void changeSection(const TCubeSnapshot& cube, int nFirst, int nAxis, int nSection);
+    void upload(void);
+
+public:
+    TCubeRenderer();
+    bool initialize(void);                                                      // on the render thread, with the context current
+    void destroy(void);                                                         // before the context is destroyed
+    bool isValid(void) const                                                    { return m_bValid; };
+    TDrawCount draw(const TFrameState& state, const QMatrix4x4& mxViewProjection);
+    int uploadedBytes(void) const                       { return m_nUploadedBytes; };
+    int uploads(void) const                             { return m_nUploads; };     // glBufferSubData() calls of the last frame
+};
+
+#endif // RENDERER_H
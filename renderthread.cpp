@@ -0,0 +1,150 @@
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include "renderthread.h"
+#include "oglwidget.h"
+#include <QCoreApplication>
+#include <QImage>
+#include <QPainter>
+#include <cstdio>
+
+#define OVERLAY_LINE_HEIGHT     16                                              // [pixels] of a line of the frame timing
+
+//---------------------------------------------------------------------------
+TRenderThread::TRenderThread(OGLWidget* widget, TStateBuffer* pStates)
+{
+    this->widget = widget;
+    states = pStates;
+    frameStop = false;
+    viewWidth = 0;
+    viewHeight = 0;
+    frameStatsShown = false;
+}
+
+//---------------------------------------------------------------------------
+void TRenderThread::wake(void)
+{
+    frameWake.release();
+}
+
+//---------------------------------------------------------------------------
+void TRenderThread::stop(void)
+{
+    frameStop = true;
+    frameWake.release();
+    wait();
+}
+
+//---------------------------------------------------------------------------
+void TRenderThread::initialize(void)
+{
+    glEnable(GL_LINE_SMOOTH);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);                                                     // The Type Of Depth Testing To Do
+    glLineWidth(1.5);
+    if (!renderer.initialize()) qWarning("OpenGL 3.3 is not available, the cube is drawn in the immediate mode");
+    if (!frameStats.initialize()) qWarning("GL timer queries are not available, the frame timing has no GPU time");
+}
+
+//---------------------------------------------------------------------------
+// The wakes that came while a frame was drawn are taken together: one frame of the latest state is enough for them.
+// At the end the context goes back to the GUI thread, which destroys it with the widget
+//---------------------------------------------------------------------------
+void TRenderThread::run()
+{
+    widget->makeCurrent();
+    initialize();
+    for (;;) {
+        frameWake.acquire();
+        frameWake.tryAcquire(frameWake.available());
+        if (frameStop) break;
+        drawFrame(states->take());
+        widget->swapBuffers();
+        emit frameSwapped();
+    }
+    renderer.destroy();
+    frameStats.destroy();
+    widget->doneCurrent();
+    widget->context()->moveToThread(QCoreApplication::instance()->thread());
+}
+
+//---------------------------------------------------------------------------
+void TRenderThread::drawFrame(const TFrameState& state)
+{
+    TDrawCount count;
+
+    if (state.nWidth != viewWidth || state.nHeight != viewHeight) {
+        viewWidth = state.nWidth;
+        viewHeight = state.nHeight;
+        glViewport(0, 0, viewWidth, viewHeight);
+        OGLWidget::loadProjection(viewWidth, viewHeight);
+    }
+    if (state.bFrameStats && !frameStatsShown) {                                // the timing starts when it is shown
+        frameStats.clear();
+        frameStatsLog.start();
+    }
+    frameStatsShown = state.bFrameStats;
+
+    glClearColor(0.39f,0.58f,0.93f,1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);                         // clear the window with the color wheel and background and set the depth buffer
+
+    frameStats.beginFrame();
+    if (renderer.isValid()) count = renderer.draw(state, state.mxProjection * state.mxModel);   // the matrices are uniforms
+    else {
+        count.nDrawCalls = 0;
+        count.nVertices = 0;
+        glLoadMatrixf(state.mxModel.constData());                               // the immediate mode draws with the matrix stack
+        for (int i=0; i<state.cubes.length(); i++) {
+            const QVector3D& vOffset = state.offsets.at(i);
+            glPushMatrix();
+            glTranslatef(vOffset.x(), vOffset.y(), vOffset.z());
+            TDrawCount cube = state.cubes.at(i).draw();
+            glPopMatrix();
+            count.nDrawCalls += cube.nDrawCalls;
+            count.nVertices += cube.nVertices;
+        }
+    }
+    frameStats.endFrame(count);                                                 // the overlay is not part of the measured frame
+    if (frameStatsShown) drawFrameStats();
+}
+
+//---------------------------------------------------------------------------
+// The lines are painted into an image and the image is drawn in the upper left corner, over the cube
+//---------------------------------------------------------------------------
+void TRenderThread::drawFrameStats(void)
+{
+    QStringList lines = frameStats.report();
+    int nHeight = OVERLAY_LINE_HEIGHT * lines.length() + 4;
+    QImage image(qMax(1, viewWidth), nHeight, QImage::Format_RGBA8888);
+
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setPen(Qt::white);
+    for (int i=0; i<lines.length(); i++) painter.drawText(8, OVERLAY_LINE_HEIGHT*(i+1), lines.at(i));
+    painter.end();
+    image = image.mirrored();                                                   // GL rows go from the bottom
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glRasterPos2f(-1.0f, 1.0f - 2.0f * nHeight / qMax(1, viewHeight));
+    glDrawPixels(image.width(), image.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    if (frameStatsLog.elapsed() >= FRAME_STATS_LOG_INTERVAL) {                  // the log for the measurements outside the window
+        fprintf(stderr, "Frame: %s\n", lines.join(", ").toLocal8Bit().constData());
+        frameStatsLog.start();
+    }
+}
+
+//---------------------------------------------------------------------------
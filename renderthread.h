@@ -0,0 +1,53 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QThread>
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <atomic>
+#include "statebuffer.h"
+#include "renderer.h"
+#include "framestats.h"
+
+class OGLWidget;
+
+//---------------------------------------------------------------------------
+// Thread of all GL work of the widget, as in the threaded rendering of QGLWidget: the context is moved to this
+// thread, which makes it current, draws and swaps the buffers itself. A frame is drawn when the GUI thread wakes the
+// thread after publishing a state; the frame draws the latest published state, so the GUI thread, which turns the
+// cubes, never waits for the GPU or for a swap, and the thread never reads a cube in the middle of a move.
+// The timing of the frames is measured here, since here they are drawn; the overlay is painted into an image,
+// because renderText() belongs to the GUI thread
+//---------------------------------------------------------------------------
+class TRenderThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    TRenderThread(OGLWidget* widget, TStateBuffer* pStates);
+    void wake(void);                                                            // a new state is published
+    void stop(void);                                                            // returns when the thread has given the context back
+
+signals:
+    void frameSwapped();
+
+protected:
+    void run() override;
+
+private:
+    void initialize(void);
+    void drawFrame(const TFrameState& state);
+    void drawFrameStats(void);
+
+    OGLWidget*        widget;
+    TStateBuffer*     states;
+    TCubeRenderer     renderer;                                                 // instanced drawing, when the context has OpenGL 3.3
+    TFrameStats       frameStats;
+    QSemaphore        frameWake;                                                // released once by each wake()
+    std::atomic<bool> frameStop;
+    int               viewWidth, viewHeight;                                    // of the viewport, 0 - not set yet
+    bool              frameStatsShown;                                          // in the last drawn state
+    QElapsedTimer     frameStatsLog;                                            // time since the last line of the log
+};
+
+#endif // RENDERTHREAD_H
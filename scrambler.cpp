@@ -0,0 +1,188 @@
+#include "scrambler.h"
+
+#define SCRAMBLE_SEARCH_TIME     100                                            // [ms] search for the move sequence when the colour neutral plans fail
+
+static constexpr TCubieFacelets g_CubieFacelets;
+static const SIDECOLOR g_nHomeColor[] = { WHITE, BLUE, GREEN, ORANGE, RED, YELLOW };   // colors of the sides of the solved cube
+
+//---------------------------------------------------------------------------
+static inline quint64 rotl(quint64 x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+//---------------------------------------------------------------------------
+// The state of the generator is filled from the seed by splitmix64, so similar seeds give unrelated sequences
+//---------------------------------------------------------------------------
+TScrambler::TScrambler(quint64 nSeed)
+{
+    for (int i=0; i<4; i++) {
+        quint64 z = (nSeed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        m_nState[i] = z ^ (z >> 31);
+    }
+}
+
+//---------------------------------------------------------------------------
+quint64 TScrambler::next(void)
+{
+    quint64 nResult = rotl(m_nState[1] * 5, 7) * 9;
+    quint64 t = m_nState[1] << 17;
+
+    m_nState[2] ^= m_nState[0];
+    m_nState[3] ^= m_nState[1];
+    m_nState[1] ^= m_nState[2];
+    m_nState[0] ^= m_nState[3];
+    m_nState[2] ^= t;
+    m_nState[3] = rotl(m_nState[3], 45);
+    return nResult;
+}
+
+//---------------------------------------------------------------------------
+// Multiplication instead of the modulo, with the rejection of the few values which would make it biased
+//---------------------------------------------------------------------------
+quint32 TScrambler::below(quint32 n)
+{
+    quint64 m = (next() >> 32) * n;
+
+    if ((quint32)m < n) {
+        quint32 nThreshold = (0u - n) % n;
+        while ((quint32)m < nThreshold) m = (next() >> 32) * n;
+    }
+    return (quint32)(m >> 32);
+}
+
+//---------------------------------------------------------------------------
+void TScrambler::randomState(TCubieState& state)
+{
+    int i, j, nCornerParity = 0, nEdgeParity = 0, nTwist = 0, nFlip = 0;
+
+    for (i=0; i<CORNERS; i++) state.m_nCorner[i] = i;
+    for (i=0; i<EDGES; i++) state.m_nEdge[i] = i;
+    for (i=CORNERS-1; i>0; i--) {                                               // Fisher-Yates shuffle, every swap changes the parity
+        j = below(i+1);
+        if (j != i) { qSwap(state.m_nCorner[i], state.m_nCorner[j]); nCornerParity ^= 1; }
+    }
+    for (i=EDGES-1; i>0; i--) {
+        j = below(i+1);
+        if (j != i) { qSwap(state.m_nEdge[i], state.m_nEdge[j]); nEdgeParity ^= 1; }
+    }
+    if (nCornerParity != nEdgeParity) qSwap(state.m_nEdge[EDGES-2], state.m_nEdge[EDGES-1]);   // the moves change both parities together
+
+    for (i=0; i<CORNERS-1; i++) nTwist += state.m_nCornerTwist[i] = below(3);
+    state.m_nCornerTwist[CORNERS-1] = (3 - nTwist % 3) % 3;
+    for (i=0; i<EDGES-1; i++) nFlip += state.m_nEdgeFlip[i] = below(2);
+    state.m_nEdgeFlip[EDGES-1] = nFlip & 1;
+}
+
+//---------------------------------------------------------------------------
+void TScrambler::stateToFacelets(const TCubieState& state, SIDECOLOR* nColors)
+{
+    int i, j;
+
+    for (i=0; i<FACELETS; i++) nColors[i] = g_nHomeColor[i / (cube_size*cube_size)];   // the centers stay in their places
+    for (i=0; i<CORNERS; i++) {
+        const int* pPiece = g_CubieFacelets.m_nCorner[state.m_nCorner[i]];
+        for (j=0; j<3; j++) nColors[g_CubieFacelets.m_nCorner[i][j]] = g_nHomeColor[pPiece[(j + state.m_nCornerTwist[i]) % 3] / (cube_size*cube_size)];
+    }
+    for (i=0; i<EDGES; i++) {
+        const int* pPiece = g_CubieFacelets.m_nEdge[state.m_nEdge[i]];
+        for (j=0; j<2; j++) nColors[g_CubieFacelets.m_nEdge[i][j]] = g_nHomeColor[pPiece[(j + state.m_nEdgeFlip[i]) % 2] / (cube_size*cube_size)];
+    }
+}
+
+//---------------------------------------------------------------------------
+// The inverse of stateToFacelets for the facelets from a client. The centers give the side of each color, so a turned
+// cube or other colors of the sides are accepted. The function returns false unless the facelets are a cube which can
+// be solved: six different colors of the centers, every piece exactly once, the sum of the corner twists divisible
+// by 3, an even sum of the edge flips and the same parity of the corner and edge permutations
+//---------------------------------------------------------------------------
+bool TScrambler::stateFromFacelets(const SIDECOLOR* nColors, TCubieState& state)
+{
+    int nSide[8], i, j, p, t, nTwist = 0, nFlip = 0, nParity = 0;
+    unsigned nFound;
+
+    for (i=0; i<(int)ELEMENTS_OF(nSide); i++) nSide[i] = -1;
+    for (i=0; i<FACELETS; i++) if ((unsigned)nColors[i] >= ELEMENTS_OF(nSide)) return false;
+    for (i=0; i<(int)ELEMENTS_OF(g_nHomeColor); i++) {
+        SIDECOLOR color = nColors[i*cube_size*cube_size + cube_size*cube_size/2];
+        for (j=0; j<(int)ELEMENTS_OF(g_nHomeColor) && g_nHomeColor[j] != color; j++);
+        if (j == (int)ELEMENTS_OF(g_nHomeColor)) return false;                  // not a color of the cube
+        if (nSide[color] >= 0) return false;                                    // two equal centers
+        nSide[color] = i;
+    }
+
+    for (i=0, nFound=0; i<CORNERS; i++) {
+        const int* pPlace = g_CubieFacelets.m_nCorner[i];
+        for (p=0; p<CORNERS; p++) {
+            const int* pPiece = g_CubieFacelets.m_nCorner[p];
+            for (t=0; t<3; t++) {
+                for (j=0; j<3 && nSide[nColors[pPlace[j]]] == pPiece[(j + t) % 3] / (cube_size*cube_size); j++);
+                if (j == 3) break;
+            }
+            if (t < 3) break;
+        }
+        if (p == CORNERS || (nFound & (1u << p))) return false;                 // no such corner, or the same corner twice
+        nFound |= 1u << p;
+        state.m_nCorner[i] = p;
+        nTwist += state.m_nCornerTwist[i] = t;
+    }
+    for (i=0, nFound=0; i<EDGES; i++) {
+        const int* pPlace = g_CubieFacelets.m_nEdge[i];
+        for (p=0; p<EDGES; p++) {
+            const int* pPiece = g_CubieFacelets.m_nEdge[p];
+            for (t=0; t<2; t++) {
+                for (j=0; j<2 && nSide[nColors[pPlace[j]]] == pPiece[(j + t) % 2] / (cube_size*cube_size); j++);
+                if (j == 2) break;
+            }
+            if (t < 2) break;
+        }
+        if (p == EDGES || (nFound & (1u << p))) return false;
+        nFound |= 1u << p;
+        state.m_nEdge[i] = p;
+        nFlip += state.m_nEdgeFlip[i] = t;
+    }
+
+    for (i=0; i<CORNERS; i++) for (j=i+1; j<CORNERS; j++) nParity ^= state.m_nCorner[i] > state.m_nCorner[j];
+    for (i=0; i<EDGES; i++) for (j=i+1; j<EDGES; j++) nParity ^= state.m_nEdge[i] > state.m_nEdge[j];
+    return nTwist % 3 == 0 && nFlip % 2 == 0 && nParity == 0;
+}
+
+//---------------------------------------------------------------------------
+void TScrambler::randomFacelets(SIDECOLOR* nColors)
+{
+    TCubieState state;
+
+    randomState(state);
+    stateToFacelets(state, nColors);
+}
+
+//---------------------------------------------------------------------------
+// The move sequence leading from the solved cube to the given one is the inverted solution of that cube
+//---------------------------------------------------------------------------
+bool TScrambler::scrambleMoves(const TCube& cube, QVector<ROTATIONS>& moves)
+{
+    QVector<ROTATIONS> solution;
+
+    if (!cube.planShorterSolution(solution, MAX_SOLUTION_MOVES+1, 0, NULL) &&
+        !cube.planShorterSolution(solution, MAX_SOLUTION_MOVES+1, SCRAMBLE_SEARCH_TIME, NULL)) return false;
+
+    moves.resize(solution.length());
+    for (int i=0; i<solution.length(); i++) moves[i] = (ROTATIONS)(solution.at(solution.length()-1-i) ^ 1);   // the moves are ordered in pairs
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Setting the cube to the next random state; the function returns false only if the move sequence was asked for
+// and could not be found
+//---------------------------------------------------------------------------
+bool TScrambler::scramble(TCube& cube, QVector<ROTATIONS>* pMoves)
+{
+    SIDECOLOR nColors[FACELETS];
+
+    randomFacelets(nColors);
+    cube.setFacelets(nColors);
+    if (pMoves) return scrambleMoves(cube, *pMoves);
+    return true;
+}
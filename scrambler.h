@@ -0,0 +1,87 @@
+#ifndef SCRAMBLER_H
+#define SCRAMBLER_H
+
+#include "cube.h"
+#include "algorithm.h"
+
+#define CORNERS                  8
+#define EDGES                    12
+
+static_assert(cube_size == 3, "the scrambler knows only the corners and edges of the 3x3x3 cube");
+
+//---------------------------------------------------------------------------
+// Arrangement of the corners and edges: which piece (by its home place) is in each place and how it is turned
+//---------------------------------------------------------------------------
+class TCubieState {
+public:
+    UINT8 m_nCorner[CORNERS];
+    UINT8 m_nCornerTwist[CORNERS];                                              // 0..2, the sum of all twists is divisible by 3
+    UINT8 m_nEdge[EDGES];
+    UINT8 m_nEdgeFlip[EDGES];                                                   // 0..1, the sum of all flips is even
+};
+
+//---------------------------------------------------------------------------
+// Facelets of each corner and edge place. The facelets of a corner start with the one on the top or bottom side and
+// go counterclockwise seen from outside, so twisting a corner is a cyclic shift of its facelets
+//---------------------------------------------------------------------------
+class TCubieFacelets {
+public:
+    int m_nCorner[CORNERS][3];
+    int m_nEdge[EDGES][2];
+
+    static constexpr int facelet(const int* s, int nAxis)                       // facelet of the piece at s (-1, 0, 1) on the side of the axis
+    {
+        int v[3] = { 0, 0, 0 };
+        for (int a=0; a<3; a++) v[a] = s[a]*(cube_size-1);
+        v[nAxis] = s[nAxis]*cube_size;
+        return faceletFromPoint(v);
+    }
+
+    constexpr TCubieFacelets() : m_nCorner(), m_nEdge()
+    {
+        int nCorners = 0, nEdges = 0;
+
+        for (int x=-1; x<=1; x++) {
+            for (int y=-1; y<=1; y++) {
+                for (int z=-1; z<=1; z++) {
+                    int s[3] = { x, y, z };
+                    int nZeros = (x == 0) + (y == 0) + (z == 0);
+                    if (nZeros == 0) {
+                        int nOrder[3] = { 1, 0, 2 };                            // y axis first, then x and z in the same rotation
+                        if (x*y*z > 0) { nOrder[1] = 2; nOrder[2] = 0; }        // direction for all corners
+                        for (int k=0; k<3; k++) m_nCorner[nCorners][k] = facelet(s, nOrder[k]);
+                        nCorners++;
+                    }
+                    else if (nZeros == 1) {
+                        for (int a=0, k=0; a<3; a++) if (s[a] != 0) m_nEdge[nEdges][k++] = facelet(s, a);
+                        nEdges++;
+                    }
+                }
+            }
+        }
+    }
+};
+
+//---------------------------------------------------------------------------
+// Scrambler with an explicit seed: every legal arrangement of the cube is equally probable. The random permutations
+// and orientations of the pieces are generated directly and the parity and orientation constraints are fixed up,
+// so no moves are needed to create the state; an equivalent move sequence is made only when it is asked for
+//---------------------------------------------------------------------------
+class TScrambler {
+protected:
+    quint64 m_nState[4];                                                        // xoshiro256** generator
+
+    quint64 next(void);
+    quint32 below(quint32 n);                                                   // uniform random number 0..n-1
+
+public:
+    TScrambler(quint64 nSeed);
+    void randomState(TCubieState& state);
+    void randomFacelets(SIDECOLOR* nColors);
+    bool scramble(TCube& cube, QVector<ROTATIONS>* pMoves = NULL);
+    static void stateToFacelets(const TCubieState& state, SIDECOLOR* nColors);
+    static bool stateFromFacelets(const SIDECOLOR* nColors, TCubieState& state);
+    static bool scrambleMoves(const TCube& cube, QVector<ROTATIONS>& moves);
+};
+
+#endif // SCRAMBLER_H
@@ -0,0 +1,276 @@
+#include "server.h"
+#include "cubebatch.h"
+#include "notation.h"
+#include "scrambler.h"
+#include "solutioncache.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QJsonDocument>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+static const char g_cColorLetters[] = "RGBPOYKW";                               // the order of SIDECOLOR
+
+//---------------------------------------------------------------------------
+TSolveServer::TSolveServer(SOLVERSTRATEGY nStrategy, int nThreads, QObject* parent)
+    : QObject(parent)
+{
+    m_pLocalServer = NULL;
+    m_pTcpServer = NULL;
+    m_nStrategy = nStrategy;
+    m_bDispatchPosted = false;
+    m_nBatchesRunning = 0;
+    m_nRequestsRunning = 0;
+    m_nServed = 0;
+    m_nBatches = 0;
+    m_Pool.setMaxThreadCount(nThreads > 0 ? nThreads : QThread::idealThreadCount());
+    m_Clock.start();
+}
+
+//---------------------------------------------------------------------------
+TSolveServer::~TSolveServer()
+{
+    m_Pool.waitForDone();                                                       // the running batches still refer to the server
+}
+
+//---------------------------------------------------------------------------
+bool TSolveServer::listenLocal(const QString& name)
+{
+    if (!m_pLocalServer) {
+        m_pLocalServer = new QLocalServer(this);
+        connect(m_pLocalServer, &QLocalServer::newConnection, this, [this]() {
+            while (m_pLocalServer->hasPendingConnections()) acceptClient(m_pLocalServer->nextPendingConnection());
+        });
+    }
+    QLocalServer::removeServer(name);                                           // the socket file left by a server which crashed
+    return m_pLocalServer->listen(name);
+}
+
+//---------------------------------------------------------------------------
+bool TSolveServer::listenTcp(quint16 nPort)
+{
+    if (!m_pTcpServer) {
+        m_pTcpServer = new QTcpServer(this);
+        connect(m_pTcpServer, &QTcpServer::newConnection, this, [this]() {
+            while (m_pTcpServer->hasPendingConnections()) acceptClient(m_pTcpServer->nextPendingConnection());
+        });
+    }
+    return m_pTcpServer->listen(QHostAddress::LocalHost, nPort);
+}
+
+//---------------------------------------------------------------------------
+void TSolveServer::acceptClient(QIODevice* pClient)
+{
+    connect(pClient, &QIODevice::readyRead, this, [this, pClient]() { readRequests(pClient); });
+    if (QLocalSocket* pSocket = qobject_cast<QLocalSocket*>(pClient)) connect(pSocket, &QLocalSocket::disconnected, pSocket, &QObject::deleteLater);
+    if (QTcpSocket* pSocket = qobject_cast<QTcpSocket*>(pClient)) connect(pSocket, &QTcpSocket::disconnected, pSocket, &QObject::deleteLater);
+}
+
+//---------------------------------------------------------------------------
+// Reading all complete lines of the client. A request which cannot be solved is answered at once, the others are
+// queued; the cube is prepared here, so the workers only solve. A client whose line is longer than SERVER_MAX_REQUEST
+// (also one which never ends its line) gets an error and is disconnected, so it cannot fill the memory of the server
+//---------------------------------------------------------------------------
+void TSolveServer::readRequests(QIODevice* pClient)
+{
+    bool bTooLong = false;
+
+    while (pClient->canReadLine()) {
+        QByteArray line = pClient->readLine().trimmed();
+        if (line.size() > SERVER_MAX_REQUEST) {
+            bTooLong = true;
+            break;
+        }
+        if (line.isEmpty()) continue;
+
+        QJsonObject request = QJsonDocument::fromJson(line).object();
+        QJsonObject error;
+        error["id"] = request.value("id");
+        if (request.value("stats").toBool()) {
+            writeAnswer(pClient, stats());
+            continue;
+        }
+
+        TServerRequest queued;
+        TCube cube(NULL);
+        queued.client = pClient;
+        queued.id = request.value("id");
+        queued.nReceived = m_Clock.nsecsElapsed();
+        queued.nStarted = 0;
+        queued.bSolved = false;
+        if (request.contains("scramble")) {
+            QByteArray scramble = request.value("scramble").toString().toLatin1();
+            if (!TNotation::apply(std::string_view(scramble.constData(), scramble.size()), cube)) {
+                error["error"] = QString("invalid notation");
+                writeAnswer(pClient, error);
+                continue;
+            }
+            cube.getFacelets(queued.nColors);
+        }
+        else if (request.contains("facelets")) {
+            QByteArray facelets = request.value("facelets").toString().toLatin1();
+            TCubieState state;
+            int i;
+            for (i=0; i<facelets.size() && i<FACELETS; i++) {
+                const char* pColor = strchr(g_cColorLetters, facelets.at(i));
+                if (!pColor || !*pColor) break;
+                queued.nColors[i] = (SIDECOLOR)(pColor - g_cColorLetters);
+            }
+            if (i != FACELETS || facelets.size() != FACELETS || !TScrambler::stateFromFacelets(queued.nColors, state)) {
+                error["error"] = QString("invalid facelets");
+                writeAnswer(pClient, error);
+                continue;
+            }
+        }
+        else {
+            error["error"] = QString("invalid request");
+            writeAnswer(pClient, error);
+            continue;
+        }
+        m_Queue.append(queued);
+    }
+    if (bTooLong || pClient->bytesAvailable() > SERVER_MAX_REQUEST) {
+        QJsonObject error;
+        error["error"] = QString("request too long");
+        writeAnswer(pClient, error);
+        pClient->close();                                                       // its queued requests are solved but not answered
+    }
+    postDispatch();
+}
+
+//---------------------------------------------------------------------------
+// The dispatch runs once after all sockets with data were read in this turn of the event loop, so the requests
+// which came together are batched together
+//---------------------------------------------------------------------------
+void TSolveServer::postDispatch(void)
+{
+    if (m_bDispatchPosted || m_Queue.isEmpty()) return;
+    m_bDispatchPosted = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_bDispatchPosted = false;
+        dispatch();
+    });
+}
+
+//---------------------------------------------------------------------------
+// A few requests are spread over all threads instead of waiting in one batch of a single thread
+//---------------------------------------------------------------------------
+void TSolveServer::dispatch(void)
+{
+    int nThreads = m_Pool.maxThreadCount();
+    int nBatchSize = qMin((m_Queue.length() + nThreads-1) / nThreads, BATCH_LANES);
+
+    while (!m_Queue.isEmpty() && m_nBatchesRunning < nThreads) {
+        int nCount = qMin(m_Queue.length(), nBatchSize);
+        TServerBatch* pBatch = new TServerBatch;
+        pBatch->requests = m_Queue.mid(0, nCount);
+        m_Queue.remove(0, nCount);
+        qint64 nNow = m_Clock.nsecsElapsed();
+        for (int i=0; i<nCount; i++) pBatch->requests[i].nStarted = nNow;
+
+        m_nBatchesRunning++;
+        m_nRequestsRunning += nCount;
+        QFutureWatcher<void>* pWatcher = new QFutureWatcher<void>(this);
+        connect(pWatcher, &QFutureWatcher<void>::finished, this, [this, pWatcher, pBatch]() {
+            answer(pBatch);
+            pWatcher->deleteLater();
+        });
+        SOLVERSTRATEGY nStrategy = m_nStrategy;
+        pWatcher->setFuture(QtConcurrent::run(&m_Pool, [nStrategy, pBatch]() { solveBatch(nStrategy, pBatch); }));
+    }
+}
+
+//---------------------------------------------------------------------------
+// Solving a batch on a worker thread; the solutions of the whole batch are verified together on a TCubeBatch
+//---------------------------------------------------------------------------
+void TSolveServer::solveBatch(SOLVERSTRATEGY nStrategy, TServerBatch* pBatch)
+{
+    TCubeBatch batch;
+    QVector<ROTATIONS> solutions[BATCH_LANES];
+    int i, nCount = pBatch->requests.length();
+
+    for (i=0; i<nCount; i++) {
+        TServerRequest& request = pBatch->requests[i];
+        TCube cube(NULL);
+        cube.setFacelets(request.nColors);
+        batch.setFacelets(i, request.nColors);
+        if (!TBatchSolver::solveCube(nStrategy, cube, solutions[i])) solutions[i].clear();
+    }
+
+    batch.makeMoves(solutions, nCount);
+    LANEMASK nSolved = batch.solvedMask();
+    for (i=0; i<nCount; i++) {
+        TServerRequest& request = pBatch->requests[i];
+        request.bSolved = (nSolved >> i) & 1;
+        if (request.bSolved) request.solution = solutions[i];
+    }
+}
+
+//---------------------------------------------------------------------------
+// Back on the main thread: the answers are written to the clients which are still connected
+//---------------------------------------------------------------------------
+void TSolveServer::answer(TServerBatch* pBatch)
+{
+    qint64 nNow = m_Clock.nsecsElapsed();
+
+    for (int i=0; i<pBatch->requests.length(); i++) {
+        const TServerRequest& request = pBatch->requests.at(i);
+        qint64 nLatency = nNow - request.nReceived;
+        if (m_Latencies.length() < SERVER_LATENCY_WINDOW) m_Latencies.append(nLatency);
+        else m_Latencies[m_nServed % SERVER_LATENCY_WINDOW] = nLatency;
+        m_nServed++;
+        if (!request.client || !request.client->isOpen()) continue;             // disconnected, or closed for a too long request
+
+        QJsonObject answer;
+        answer["id"] = request.id;
+        answer["solved"] = request.bSolved;
+        answer["moves"] = request.solution.length();
+        answer["solution"] = movesToString(request.solution);
+        answer["queue_us"] = (request.nStarted - request.nReceived) / 1000;
+        answer["total_us"] = nLatency / 1000;
+        answer["batch"] = pBatch->requests.length();
+        writeAnswer(request.client, answer);
+    }
+
+    m_nBatches++;
+    m_nBatchesRunning--;
+    m_nRequestsRunning -= pBatch->requests.length();
+    delete pBatch;
+    dispatch();                                                                 // the queue filled while this batch was solved
+}
+
+//---------------------------------------------------------------------------
+QJsonObject TSolveServer::stats(void) const
+{
+    QVector<qint64> latencies = m_Latencies;
+    QJsonObject result;
+
+    std::sort(latencies.begin(), latencies.end());
+    result["queue_depth"] = m_Queue.length();
+    result["in_flight"] = m_nRequestsRunning;
+    result["threads"] = m_Pool.maxThreadCount();
+    result["served"] = m_nServed;
+    result["batches"] = m_nBatches;
+    result["mean_batch"] = m_nBatches ? (double)m_nServed / m_nBatches : 0.0;
+    if (TBatchSolver::cache()) {
+        result["cache_hits"] = TBatchSolver::cache()->hits();
+        result["cache_misses"] = TBatchSolver::cache()->misses();
+    }
+    if (!latencies.isEmpty()) {
+        result["latency_p50_ms"] = latencies.at((latencies.length()-1) / 2) / 1e6;
+        result["latency_p99_ms"] = latencies.at((latencies.length()*99 + 99) / 100 - 1) / 1e6;
+    }
+    return result;
+}
+
+//---------------------------------------------------------------------------
+void TSolveServer::writeAnswer(QIODevice* pClient, const QJsonObject& answer)
+{
+    pClient->write(QJsonDocument(answer).toJson(QJsonDocument::Compact) + '\n');
+}
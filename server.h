@@ -0,0 +1,86 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QIODevice>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QJsonValue>
+#include "cube.h"
+#include "algorithm.h"
+#include "solver.h"
+
+#define SERVER_LATENCY_WINDOW    4096                                           // the latency percentiles are computed from the last requests
+#define SERVER_MAX_REQUEST       4096                                           // [bytes] longest request line, a longer one disconnects the client
+
+class QLocalServer;
+class QTcpServer;
+
+class TServerRequest {
+public:
+    QPointer<QIODevice> client;                                                 // the connection may be closed before the answer
+    QJsonValue id;                                                              // copied to the answer
+    SIDECOLOR nColors[FACELETS];
+    qint64 nReceived;                                                           // [ns] of the server clock
+    qint64 nStarted;
+    bool bSolved;
+    QVector<ROTATIONS> solution;
+};
+
+class TServerBatch {
+public:
+    QVector<TServerRequest> requests;
+};
+
+//---------------------------------------------------------------------------
+// Solving service for many clients of one long-lived process. The clients connect to a local (Unix domain) socket or
+// a localhost TCP port and send one JSON request per line. Each answer is one JSON line with the id of its request
+// (the batches may finish in a different order than they came):
+//
+//   {"id":1,"scramble":"R U R' F2"}            - a scramble in the usual notation
+//   {"id":2,"facelets":"WWWWWWWWWBBB..."}      - 54 colors (W B G O R Y) of the facelets in the order of algorithm.h
+//   {"stats":true}                             - queue depth, batches and latency of the server
+//
+// Facelets of a cube which cannot be solved (a twisted corner, a flipped edge ...) are answered with "invalid facelets"
+//
+// All sockets are served by the Qt event loop of the main thread. The requests which arrive while the workers are
+// busy (or in the same turn of the event loop) wait in the queue and are taken together, so one task of the thread
+// pool solves and verifies a whole batch. The queue is split evenly over the threads, up to BATCH_LANES in a batch
+//---------------------------------------------------------------------------
+class TSolveServer : public QObject
+{
+    Q_OBJECT
+
+protected:
+    QLocalServer* m_pLocalServer;
+    QTcpServer* m_pTcpServer;
+    QThreadPool m_Pool;
+    SOLVERSTRATEGY m_nStrategy;
+    QElapsedTimer m_Clock;
+    QVector<TServerRequest> m_Queue;
+    bool m_bDispatchPosted;
+    int m_nBatchesRunning;
+    int m_nRequestsRunning;
+    qint64 m_nServed;
+    qint64 m_nBatches;
+    QVector<qint64> m_Latencies;                                                // [ns] ring of the last SERVER_LATENCY_WINDOW requests
+
+    void acceptClient(QIODevice* pClient);
+    void readRequests(QIODevice* pClient);
+    void postDispatch(void);
+    void dispatch(void);
+    void answer(TServerBatch* pBatch);
+    QJsonObject stats(void) const;
+    static void writeAnswer(QIODevice* pClient, const QJsonObject& answer);
+    static void solveBatch(SOLVERSTRATEGY nStrategy, TServerBatch* pBatch);
+
+public:
+    TSolveServer(SOLVERSTRATEGY nStrategy, int nThreads, QObject* parent = NULL);
+    ~TSolveServer();
+    bool listenLocal(const QString& name);
+    bool listenTcp(quint16 nPort);
+};
+
+#endif // SERVER_H
@@ -0,0 +1,345 @@
+#include "solutioncache.h"
+
+#include <QMutexLocker>
+#include <QtEndian>
+#include <cstring>
+
+static constexpr TCubeRotations g_Rotations;
+
+//---------------------------------------------------------------------------
+// All 24 turns of the cube are compared facelet by facelet and a turn stops at the first facelet which is greater
+// than the best one so far. A symmetric state has more equal turns, the first of them is taken
+//---------------------------------------------------------------------------
+TCanonicalState::TCanonicalState(const SIDECOLOR* nColors)
+{
+    UINT8 nCandidate[FACELETS];
+    UINT8 nSideOfColor[8];
+    bool bFirst = true;
+    int i;
+
+    for (int r=0; r<CUBE_ROTATIONS; r++) {
+        const unsigned short* nFrom = g_Rotations.m_Rotation[r].m_nFrom;
+        int nOrder = bFirst ? -1 : 0;
+
+        memset(nSideOfColor, 6, sizeof(nSideOfColor));                         // a color which is not on any center
+        for (i=0; i<6; i++) nSideOfColor[nColors[nFrom[i*9 + 4]] & 7] = i;
+        for (i=0; i<FACELETS; i++) {
+            nCandidate[i] = nSideOfColor[nColors[nFrom[i]] & 7];
+            if (nOrder == 0 && nCandidate[i] != m_nFacelets[i]) {
+                nOrder = nCandidate[i] < m_nFacelets[i] ? -1 : 1;
+                if (nOrder > 0) break;
+            }
+        }
+        if (nOrder < 0) {
+            memcpy(m_nFacelets, nCandidate, sizeof(m_nFacelets));
+            memcpy(m_nSide, g_Rotations.m_nSide[r], sizeof(m_nSide));
+            bFirst = false;
+        }
+    }
+
+    m_nKey = 0xCBF29CE484222325ULL;                                             // FNV-1a of the facelets
+    for (i=0; i<FACELETS; i++) m_nKey = (m_nKey ^ m_nFacelets[i]) * 0x100000001B3ULL;
+    m_nKey ^= m_nKey >> 31;                                                     // mixed, so the lower bits of the hash tables vary
+    m_nKey *= 0x9E3779B97F4A7C15ULL;
+    m_nKey ^= m_nKey >> 29;
+}
+
+//---------------------------------------------------------------------------
+ROTATIONS TCanonicalState::toCube(ROTATIONS nMove) const                        // the whole cube was only turned, so the direction stays
+{
+    return sideMove((SIDE)m_nSide[moveSide(nMove)], nMove & 1);
+}
+
+//---------------------------------------------------------------------------
+ROTATIONS TCanonicalState::toCanonical(ROTATIONS nMove) const
+{
+    int nSide = 0;
+
+    while (nSide < 5 && m_nSide[nSide] != moveSide(nMove)) nSide++;
+    return sideMove((SIDE)nSide, nMove & 1);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TSolutionCache::TSolutionCache(int nMaxEntries)
+{
+    m_nMaxEntries = qMax(nMaxEntries, 1);
+    m_nWritten = 0;
+    m_bWriting = false;
+    m_nHits = 0;
+    m_nMisses = 0;
+}
+
+//---------------------------------------------------------------------------
+TSolutionCache::~TSolutionCache()
+{
+    close();
+}
+
+//---------------------------------------------------------------------------
+bool TSolutionCache::open(const QString& fileName)
+{
+    close();
+
+    QMutexLocker locker(&m_Mutex);
+    QMutexLocker fileLocker(&m_FileMutex);
+    m_File.setFileName(fileName);
+    if (!m_File.open(QIODevice::ReadWrite)) return false;
+    if (loadFile()) return true;
+    m_File.close();
+    m_Disk.clear();
+    return false;
+}
+
+//---------------------------------------------------------------------------
+// The records not written yet are written now; the memory tier stays
+//---------------------------------------------------------------------------
+void TSolutionCache::close(void)
+{
+    QMutexLocker locker(&m_Mutex);
+    QMutexLocker fileLocker(&m_FileMutex);                                      // waits for a batch being written
+
+    if (m_File.isOpen() && !m_Pending.isEmpty()) {
+        if (m_File.seek(m_nWritten)) m_File.write(m_Pending);
+        m_File.flush();
+    }
+    m_File.close();
+    m_Disk.clear();
+    m_Pending.clear();
+    m_nWritten = 0;
+}
+
+//---------------------------------------------------------------------------
+// Reading the index of the file: only the offsets of the records are kept, the moves are read when they are needed.
+// A record which was not written completely (the program stopped while appending) is cut off
+//---------------------------------------------------------------------------
+bool TSolutionCache::loadFile(void)
+{
+    uchar header[CACHE_HEADER_SIZE] = { 0 };
+    qint64 nSize = m_File.size();
+
+    if (nSize == 0) {
+        qToLittleEndian<quint32>(CACHE_MAGIC, header);
+        qToLittleEndian<quint16>(CACHE_VERSION, header + 4);
+        m_nWritten = CACHE_HEADER_SIZE;
+        return m_File.write((const char*)header, CACHE_HEADER_SIZE) == CACHE_HEADER_SIZE && m_File.flush();
+    }
+
+    if (nSize < CACHE_HEADER_SIZE) return false;
+    const uchar* pData = m_File.map(0, nSize);
+    if (!pData) return false;
+    if (qFromLittleEndian<quint32>(pData) != CACHE_MAGIC || qFromLittleEndian<quint16>(pData + 4) != CACHE_VERSION) {
+        m_File.unmap((uchar*)pData);
+        return false;
+    }
+
+    qint64 nOffset = CACHE_HEADER_SIZE;
+    while (nOffset + CACHE_RECORD_HEADER <= nSize) {
+        qint64 nLength = CACHE_RECORD_HEADER + (qFromLittleEndian<quint16>(pData + nOffset + 8) + 1) / 2;
+        if (nOffset + nLength > nSize) break;
+        m_Disk.insert(qFromLittleEndian<quint64>(pData + nOffset), nOffset);    // a later record replaces the earlier one
+        nOffset += nLength;
+    }
+    m_File.unmap((uchar*)pData);
+
+    m_nWritten = nOffset;
+    return nOffset == nSize || m_File.resize(nOffset);
+}
+
+//---------------------------------------------------------------------------
+bool TSolutionCache::decodeRecord(const uchar* pRecord, qint64 nSize, QVector<ROTATIONS>& moves)
+{
+    if (nSize < CACHE_RECORD_HEADER) return false;
+    int nLength = qFromLittleEndian<quint16>(pRecord + 8);
+    if (nSize < CACHE_RECORD_HEADER + (nLength + 1) / 2) return false;
+
+    moves.resize(nLength);
+    for (int i=0; i<nLength; i++) {
+        int nMove = (pRecord[CACHE_RECORD_HEADER + (i >> 1)] >> ((i & 1) << 2)) & 15;
+        if (nMove > ROT_UCCW) return false;
+        moves[i] = (ROTATIONS)nMove;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+bool TSolutionCache::readRecord(qint64 nOffset, QVector<ROTATIONS>& moves)
+{
+    uchar header[CACHE_RECORD_HEADER];
+
+    if (!m_File.seek(nOffset) || m_File.read((char*)header, CACHE_RECORD_HEADER) != CACHE_RECORD_HEADER) return false;
+    QByteArray record((const char*)header, CACHE_RECORD_HEADER);
+    record += m_File.read((qFromLittleEndian<quint16>(header + 8) + 1) / 2);
+    return decodeRecord((const uchar*)record.constData(), record.size(), moves);
+}
+
+//---------------------------------------------------------------------------
+// Looking the key up in the disk tier: a record which is still in m_Pending is decoded at once (true), for a record
+// in the file only its offset is returned (-1 if there is none), it is read after m_Mutex is unlocked
+//---------------------------------------------------------------------------
+bool TSolutionCache::findRecord(quint64 nKey, QVector<ROTATIONS>& moves, qint64& nOffset)
+{
+    nOffset = m_Disk.value(nKey, -1);
+    if (nOffset < m_nWritten) return false;
+    qint64 nPending = nOffset - m_nWritten;
+    nOffset = -1;
+    return decodeRecord((const uchar*)m_Pending.constData() + nPending, m_Pending.size() - nPending, moves);
+}
+
+//---------------------------------------------------------------------------
+// A batch of records taken from the beginning of m_Pending is written by one thread, without m_Mutex; until it is in
+// the file it stays in m_Pending, so the records are always found in one of them
+//---------------------------------------------------------------------------
+void TSolutionCache::writePending(const QByteArray& records, qint64 nOffset)
+{
+    bool bOk;
+    {
+        QMutexLocker fileLocker(&m_FileMutex);
+        bOk = m_File.isOpen() && m_File.seek(nOffset) && m_File.write(records) == records.size() && m_File.flush();
+    }
+
+    QMutexLocker locker(&m_Mutex);
+    m_bWriting = false;
+    if (!bOk || nOffset != m_nWritten || !m_Pending.startsWith(records)) return; // not written, or the cache was closed
+    m_Pending.remove(0, records.size());
+    m_nWritten += records.size();
+}
+
+//---------------------------------------------------------------------------
+void TSolutionCache::remember(quint64 nKey, const QVector<ROTATIONS>& moves)  // puts the solution at the front of the LRU list
+{
+    auto it = m_Memory.find(nKey);
+
+    if (it != m_Memory.end()) {
+        it.value()->moves = moves;
+        m_Entries.splice(m_Entries.begin(), m_Entries, it.value());
+        return;
+    }
+    m_Entries.push_front(TEntry());
+    m_Entries.front().nKey = nKey;
+    m_Entries.front().moves = moves;
+    m_Memory.insert(nKey, m_Entries.begin());
+    if (m_Entries.size() > (size_t)m_nMaxEntries) {                            // the least recently used one is forgotten
+        m_Memory.remove(m_Entries.back().nKey);
+        m_Entries.pop_back();
+    }
+}
+
+//---------------------------------------------------------------------------
+// The solution of the canonical cube is renamed to the sides of the given cube and played on a copy of it, so a
+// collision of the keys (or a damaged file) can never return a wrong solution
+//---------------------------------------------------------------------------
+bool TSolutionCache::find(const TCube& cube, QVector<ROTATIONS>& solution)
+{
+    SIDECOLOR nColors[FACELETS];
+    QVector<ROTATIONS> moves;
+    qint64 nOffset = -1;
+    bool bFound;
+
+    cube.getFacelets(nColors);
+    TCanonicalState state(nColors);
+    {
+        QMutexLocker locker(&m_Mutex);
+        auto it = m_Memory.find(state.m_nKey);
+        if (it != m_Memory.end()) {
+            moves = it.value()->moves;
+            m_Entries.splice(m_Entries.begin(), m_Entries, it.value());
+            bFound = true;
+        }
+        else {
+            bFound = findRecord(state.m_nKey, moves, nOffset);
+            if (bFound) remember(state.m_nKey, moves);
+        }
+    }
+    if (nOffset >= 0) {                                                         // the record is read from the file without m_Mutex
+        {
+            QMutexLocker fileLocker(&m_FileMutex);
+            bFound = readRecord(nOffset, moves);
+        }
+        if (bFound) {
+            QMutexLocker locker(&m_Mutex);
+            remember(state.m_nKey, moves);
+        }
+    }
+    if (!bFound) {
+        m_nMisses++;
+        return false;
+    }
+
+    TCube copy(cube);
+    solution.resize(moves.length());
+    for (int i=0; i<moves.length(); i++) {
+        solution[i] = state.toCube(moves.at(i));
+        copy.makeMove(solution.at(i), FALSE);
+    }
+    if (!copy.check()) {
+        m_nMisses++;
+        return false;
+    }
+    m_nHits++;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Only a solution shorter than the known one is stored, so the file grows only with new or better solutions
+//---------------------------------------------------------------------------
+void TSolutionCache::insert(const TCube& cube, const QVector<ROTATIONS>& solution)
+{
+    SIDECOLOR nColors[FACELETS];
+    QVector<ROTATIONS> moves(solution.length()), known;
+    QByteArray records;
+    qint64 nOffset = -1;
+
+    if (solution.length() > 0xFFFF) return;
+    cube.getFacelets(nColors);
+    TCanonicalState state(nColors);
+    for (int i=0; i<solution.length(); i++) moves[i] = state.toCanonical(solution.at(i));
+    {
+        QMutexLocker locker(&m_Mutex);
+        auto it = m_Memory.find(state.m_nKey);
+        if (it != m_Memory.end()) {
+            if (it.value()->moves.length() <= moves.length()) return;
+        }
+        else if (findRecord(state.m_nKey, known, nOffset) && known.length() <= moves.length()) return;
+    }
+    if (nOffset >= 0) {
+        QMutexLocker fileLocker(&m_FileMutex);
+        if (readRecord(nOffset, known) && known.length() <= moves.length()) return;
+    }
+
+    QByteArray record(CACHE_RECORD_HEADER + (moves.length() + 1) / 2, 0);      // encoded before m_Mutex is locked again
+    uchar* pRecord = (uchar*)record.data();
+    qToLittleEndian<quint64>(state.m_nKey, pRecord);
+    qToLittleEndian<quint16>(moves.length(), pRecord + 8);
+    for (int i=0; i<moves.length(); i+=2) {
+        pRecord[CACHE_RECORD_HEADER + i/2] = moves.at(i) | ((i+1 < moves.length() ? moves.at(i+1) : 15) << 4);
+    }
+    {
+        QMutexLocker locker(&m_Mutex);
+        auto it = m_Memory.find(state.m_nKey);                                  // another thread may have stored one meanwhile
+        if (it != m_Memory.end() && it.value()->moves.length() <= moves.length()) return;
+        remember(state.m_nKey, moves);
+        if (!m_File.isOpen()) return;
+
+        m_Disk.insert(state.m_nKey, m_nWritten + m_Pending.size());
+        m_Pending += record;
+        if (m_bWriting || m_Pending.size() < CACHE_WRITE_BATCH) return;
+        m_bWriting = true;
+        records = m_Pending;
+        nOffset = m_nWritten;
+    }
+    writePending(records, nOffset);
+}
+
+//---------------------------------------------------------------------------
+int TSolutionCache::count(void)
+{
+    QMutexLocker locker(&m_Mutex);
+    int nCount = m_Disk.size();
+
+    for (const TEntry& entry : m_Entries) {
+        if (!m_Disk.contains(entry.nKey)) nCount++;
+    }
+    return nCount;
+}
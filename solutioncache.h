@@ -0,0 +1,119 @@
+#ifndef SOLUTIONCACHE_H
+#define SOLUTIONCACHE_H
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <atomic>
+#include <list>
+#include "cube.h"
+#include "algorithm.h"
+
+#define CUBE_ROTATIONS           24                                             // orientations of the whole cube
+#define CACHE_MEMORY_ENTRIES     65536                                          // default size of the LRU tier
+#define CACHE_MAGIC              0x43534352                                     // "RCSC" in the file
+#define CACHE_VERSION            1
+#define CACHE_HEADER_SIZE        16
+#define CACHE_RECORD_HEADER      10                                             // key (8), number of moves (2)
+#define CACHE_WRITE_BATCH        65536                                          // [B] new records written and flushed together
+
+//---------------------------------------------------------------------------
+// All rotations of the whole cube as permutations of the facelets, with the side of the original cube which comes
+// to each side. Every rotation maps the axes to the axes, so they are the signed permutation matrices with det 1
+//---------------------------------------------------------------------------
+class TCubeRotations {
+public:
+    TFaceletPermutation m_Rotation[CUBE_ROTATIONS];
+    UINT8 m_nSide[CUBE_ROTATIONS][6];                                           // [rotation][new side] = old side
+
+    constexpr TCubeRotations() : m_Rotation(), m_nSide()
+    {
+        const int nPermutations[6][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 0, 2, 1 }, { 2, 1, 0 }, { 1, 0, 2 } };
+        int nRotations = 0;
+
+        for (int p=0; p<6; p++) {
+            for (int nSigns=0; nSigns<8; nSigns++) {
+                int s[3] = { nSigns & 1 ? -1 : 1, nSigns & 2 ? -1 : 1, nSigns & 4 ? -1 : 1 };
+                int nDet = s[0]*s[1]*s[2] * (p < 3 ? 1 : -1);                   // the odd permutations change the sign
+                if (nDet < 0) continue;
+                for (int nFacelet=0; nFacelet<FACELETS; nFacelet++) {
+                    int v[3] = { 0, 0, 0 }, w[3] = { 0, 0, 0 };
+                    faceletToPoint(nFacelet, v);
+                    for (int a=0; a<3; a++) w[a] = s[a]*v[nPermutations[p][a]];
+                    int nTo = faceletFromPoint(w);
+                    m_Rotation[nRotations].m_nFrom[nTo] = nFacelet;
+                    if (nFacelet % 9 == 4) m_nSide[nRotations][nTo / 9] = nFacelet / 9;   // the center of the side
+                }
+                nRotations++;
+            }
+        }
+    }
+};
+
+//---------------------------------------------------------------------------
+// Canonical form of a state: the cube is turned so that its facelets, written as the sides of their center colors,
+// are the smallest; the key is a hash of this form. It does not change when the whole cube is turned or the colors
+// are renamed, and m_nSide tells which side of the given cube is each side of the canonical one
+//---------------------------------------------------------------------------
+class TCanonicalState {
+public:
+    quint64 m_nKey;
+    UINT8 m_nSide[6];                                                           // [canonical side] = side of the cube
+    UINT8 m_nFacelets[FACELETS];                                                // 0..5, the side of the facelet's color
+
+    TCanonicalState(const SIDECOLOR* nColors);
+    ROTATIONS toCube(ROTATIONS nMove) const;                                    // move of the canonical cube -> move of the cube
+    ROTATIONS toCanonical(ROTATIONS nMove) const;
+};
+
+//---------------------------------------------------------------------------
+// Cache of solutions in two tiers: the recently used solutions in memory (LRU) and all solutions in an append-only
+// file, which is read again when the cache is opened. The file has a header (magic, version) and records:
+//
+//   key (8), number of moves (2), (moves+1)/2 bytes of moves, 4 bits each as in movearchive.h
+//
+// A later record of the same key replaces the earlier one (only shorter solutions are appended). The solutions are
+// stored for the canonical cube and verified on the given cube before they are returned. All functions are thread safe:
+// m_Mutex guards only the tiers and is never held during the disk I/O, the file has its own m_FileMutex. New records
+// are collected in m_Pending (and found there) and written with one flush per CACHE_WRITE_BATCH bytes and by close()
+//---------------------------------------------------------------------------
+class TSolutionCache {
+protected:
+    class TEntry {
+    public:
+        quint64 nKey;
+        QVector<ROTATIONS> moves;                                               // for the canonical cube
+    };
+
+    QMutex m_Mutex;
+    int m_nMaxEntries;
+    std::list<TEntry> m_Entries;                                                // the most recently used first
+    QHash<quint64, std::list<TEntry>::iterator> m_Memory;
+    QMutex m_FileMutex;                                                         // taken after m_Mutex, never before it
+    QFile m_File;
+    QHash<quint64, qint64> m_Disk;                                              // offset of the record in the file
+    qint64 m_nWritten;                                                          // end of the records written to the file
+    QByteArray m_Pending;                                                       // records after m_nWritten, not written yet
+    bool m_bWriting;                                                            // a thread is writing the beginning of m_Pending
+    std::atomic<qint64> m_nHits, m_nMisses;
+
+    void remember(quint64 nKey, const QVector<ROTATIONS>& moves);
+    static bool decodeRecord(const uchar* pRecord, qint64 nSize, QVector<ROTATIONS>& moves);
+    bool readRecord(qint64 nOffset, QVector<ROTATIONS>& moves);                 // m_FileMutex must be locked
+    bool findRecord(quint64 nKey, QVector<ROTATIONS>& moves, qint64& nOffset);  // m_Mutex must be locked
+    void writePending(const QByteArray& records, qint64 nOffset);
+    bool loadFile(void);
+
+public:
+    TSolutionCache(int nMaxEntries = CACHE_MEMORY_ENTRIES);
+    ~TSolutionCache();
+    bool open(const QString& fileName);                                         // the file is created if it does not exist
+    void close(void);
+    bool find(const TCube& cube, QVector<ROTATIONS>& solution);
+    void insert(const TCube& cube, const QVector<ROTATIONS>& solution);
+    int count(void);                                                            // different states in both tiers
+    qint64 hits(void) const                                                     { return m_nHits; };
+    qint64 misses(void) const                                                   { return m_nMisses; };
+};
+
+#endif // SOLUTIONCACHE_H
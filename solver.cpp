@@ -0,0 +1,427 @@
+#include "solver.h"
+#include "scrambler.h"
+#include "cubebatch.h"
+#include "solutioncache.h"
+
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <algorithm>
+
+//---------------------------------------------------------------------------
+QString TPortfolioSolver::strategyName(SOLVERSTRATEGY nStrategy)
+{
+    switch (nStrategy) {
+    case STRATEGY_LBL            : return "LBL";
+    case STRATEGY_COLOUR_NEUTRAL : return "Colour neutral";
+    case STRATEGY_PRE_MOVES      : return "Pre-moves";
+    case STRATEGIES              : break;
+    }
+
+    return "";
+}
+
+//---------------------------------------------------------------------------
+QString TPortfolioSolver::policyName(RACEPOLICY nPolicy)
+{
+    switch (nPolicy) {
+    case POLICY_FIRST_FINISHED : return "first finished";
+    case POLICY_SHORTEST       : return "shortest";
+    }
+
+    return "";
+}
+
+//---------------------------------------------------------------------------
+TPortfolioSolver::TPortfolioSolver(RACEPOLICY nPolicy, int nDeadline)
+{
+    m_nPolicy = nPolicy;
+    m_nDeadline = nDeadline;
+    m_nWinner = -1;
+    m_nFirst = -1;
+    m_nFinished = 0;
+    m_bCancel = false;
+}
+
+//---------------------------------------------------------------------------
+// Single strategy of the portfolio, executed on its own thread; the cube is not changed, each planner works on a copy
+//---------------------------------------------------------------------------
+bool TPortfolioSolver::runStrategy(SOLVERSTRATEGY nStrategy, const TCube& cube, QVector<ROTATIONS>& solution, int nDeadline, const std::atomic<bool>* pCancel)
+{
+    SIDECOLOR crossColor;
+    int nPlanned;
+
+    switch (nStrategy) {
+    case STRATEGY_LBL :
+        if (!cube.planSolutionWithCross(WHITE, solution, MAX_SOLUTION_MOVES, pCancel)) return false;
+        optimizeMoves(solution);
+        return true;
+    case STRATEGY_COLOUR_NEUTRAL :
+        return cube.planColourNeutralSolution(solution, crossColor, nPlanned, pCancel);
+    case STRATEGY_PRE_MOVES : {                                                  // the best solution so far, when cancelled
+        TParallelSearch search;
+        return search.solve(cube, solution, MAX_SOLUTION_MOVES, nDeadline, pCancel);
+    }
+    case STRATEGIES :
+        break;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------------------------
+// Racing all strategies. The function waits until the policy has a winner, all strategies finished or the deadline
+// passed, then the remaining strategies are cancelled and the winner's solution is returned
+//---------------------------------------------------------------------------
+bool TPortfolioSolver::solve(const TCube& cube, QVector<ROTATIONS>& solution)
+{
+    QFuture<void> futures[STRATEGIES];
+    QElapsedTimer timer;
+    int i;
+
+    m_nWinner = -1;
+    m_nFirst = -1;
+    m_nFinished = 0;
+    m_bCancel = false;
+    timer.start();
+    for (i=0; i<STRATEGIES; i++) {
+        m_Results[i] = TStrategyResult();
+        futures[i] = QtConcurrent::run([this, i, &cube]() {
+            QElapsedTimer strategyTimer;
+            QVector<ROTATIONS> strategySolution;
+            bool bSolved;
+
+            strategyTimer.start();
+            bSolved = runStrategy((SOLVERSTRATEGY)i, cube, strategySolution, m_nDeadline, &m_bCancel);
+
+            QMutexLocker locker(&m_Mutex);
+            TStrategyResult& result = m_Results[i];
+            result.nTime = strategyTimer.nsecsElapsed() / 1000;
+            result.bCancelled = m_bCancel;
+            result.bSolved = bSolved;
+            result.solution = strategySolution;
+            result.nMoves = bSolved ? strategySolution.length() : 0;
+            if (bSolved && m_nFirst < 0) m_nFirst = i;
+            m_nFinished++;
+            m_Finished.wakeAll();
+        });
+    }
+
+    m_Mutex.lock();
+    while (m_nFinished < STRATEGIES) {
+        if (m_nPolicy == POLICY_FIRST_FINISHED && m_nFirst >= 0) break;
+        qint64 nLeft = m_nDeadline - timer.elapsed();
+        if (nLeft <= 0) break;
+        m_Finished.wait(&m_Mutex, (unsigned long)nLeft);
+    }
+    m_Mutex.unlock();
+
+    m_bCancel = true;                                                           // the losers stop at their next check
+    for (i=0; i<STRATEGIES; i++) futures[i].waitForFinished();
+
+    if (m_nPolicy == POLICY_FIRST_FINISHED) {
+        m_nWinner = m_nFirst;
+    }
+    else {
+        for (i=0; i<STRATEGIES; i++) {
+            if (!m_Results[i].bSolved) continue;
+            if (m_nWinner < 0 || m_Results[i].nMoves < m_Results[m_nWinner].nMoves) m_nWinner = i;
+        }
+    }
+
+    if (m_nWinner < 0) return false;
+    solution = m_Results[m_nWinner].solution;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Summary of the last race: the winner, then the moves and time of each strategy
+//---------------------------------------------------------------------------
+QString TPortfolioSolver::report(void) const
+{
+    QString text;
+
+    if (m_nWinner < 0) text = QString("Race (%1): no solution").arg(policyName(m_nPolicy));
+    else text = QString("Race (%1): %2 wins").arg(policyName(m_nPolicy)).arg(strategyName((SOLVERSTRATEGY)m_nWinner));
+
+    for (int i=0; i<STRATEGIES; i++) {
+        const TStrategyResult& result = m_Results[i];
+        text += QString(" | %1: ").arg(strategyName((SOLVERSTRATEGY)i));
+        if (result.bSolved) text += QString("%1 moves").arg(result.nMoves);
+        else text += "-";
+        text += QString(", %1 ms").arg(result.nTime / 1000.0, 0, 'f', 1);
+        if (result.bCancelled) text += " (cancelled)";
+    }
+    return text;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+TParallelSearch::TParallelSearch(int nThreads, int nTableBits)
+{
+    m_pTable = TTranspositionTable::acquire(nTableBits);
+    m_nThreads = nThreads > 0 ? nThreads : QThread::idealThreadCount();
+    m_nNext = 0;
+    m_nBest = 0;
+    m_nPlanned = 0;
+    m_nPruned = 0;
+}
+
+//---------------------------------------------------------------------------
+TParallelSearch::~TParallelSearch()
+{
+    TTranspositionTable::release(m_pTable);
+}
+
+//---------------------------------------------------------------------------
+// All threads share the sequence counter and the table; each one keeps its own best solution, the shortest one wins.
+// As in planShorterSolution the time is checked after each sequence, so the sequence without pre-moves is always planned
+//---------------------------------------------------------------------------
+bool TParallelSearch::solve(const TCube& cube, QVector<ROTATIONS>& solution, int nMaxMoves, int nTimeBudget, const std::atomic<bool>* pCancel)
+{
+    QVector<QVector<ROTATIONS>> best(m_nThreads);
+    QVector<QFuture<bool>> futures;                                             // true if the thread found a plan, it may be empty
+    QThreadPool pool;
+    QElapsedTimer timer;
+    qint64 nSequences = 0, nCount = 1;
+    int i, nBest = -1;
+
+    for (i=0; i<=MAX_PRE_MOVES; i++, nCount *= 12) nSequences += nCount;       // all sequences of 0 .. MAX_PRE_MOVES moves
+    m_pTable->clear();
+    m_nNext = 0;
+    m_nBest = nMaxMoves;
+    m_nPlanned = 0;
+    m_nPruned = 0;
+
+    pool.setMaxThreadCount(m_nThreads);
+    timer.start();
+    for (i=0; i<m_nThreads; i++) {
+        QVector<ROTATIONS>* pBest = &best[i];
+        futures.append(QtConcurrent::run(&pool, [this, &cube, nSequences, nTimeBudget, &timer, pCancel, pBest]() {
+            return searchThread(cube, nSequences, nTimeBudget, &timer, pCancel, pBest);
+        }));
+    }
+    for (i=0; i<m_nThreads; i++) {
+        if (futures[i].result() && (nBest < 0 || best.at(i).length() < best.at(nBest).length())) nBest = i;
+    }
+
+    if (nBest < 0) return false;
+    solution = best.at(nBest);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// The number of the sequence is written in base 12, the first move in the highest digit, so the sequences which come
+// one after another share their first moves. The draft in the table is MAX_PRE_MOVES - the number of pre-moves
+//---------------------------------------------------------------------------
+bool TParallelSearch::searchThread(const TCube& cube, qint64 nSequences, int nTimeBudget, const QElapsedTimer* pTimer,
+                                   const std::atomic<bool>* pCancel, QVector<ROTATIONS>* pBest)
+{
+    static const SIDECOLOR crossColors[] = { WHITE, BLUE, RED, ORANGE, GREEN, YELLOW };
+    TTranspositionStats stats;
+    QVector<ROTATIONS> plan, preMoves;
+    int nPreMoves[MAX_PRE_MOVES];
+    int nDepth, nDraft, nData, i, c;
+    qint64 nPlanned = 0, nPruned = 0;
+    bool bFound = false;
+
+    for (qint64 nSequence = m_nNext++; nSequence < nSequences; nSequence = m_nNext++) {
+        qint64 nIndex = nSequence, nCount = 1;
+        for (nDepth=0; nIndex >= nCount; nDepth++, nCount *= 12) nIndex -= nCount;
+        for (i=nDepth-1; i>=0; i--, nIndex /= 12) nPreMoves[i] = nIndex % 12;
+        for (i=1; i<nDepth && nPreMoves[i]/2 != nPreMoves[i-1]/2; i++);        // the same side twice is skipped, as in planShorterSolution
+        if (i < nDepth) continue;
+
+        TCube state(cube);
+        preMoves.clear();
+        for (i=0; i<nDepth; i++) {
+            state.makeMove((ROTATIONS)nPreMoves[i], FALSE);
+            preMoves.append((ROTATIONS)nPreMoves[i]);
+            if (i+1 < nDepth && m_pTable->probe(TTranspositionTable::stateKey(state), nDraft, nData, stats) &&
+                MAX_PRE_MOVES - nDraft < i+1) break;                            // a shorter sequence came here, it has all our continuations
+        }
+        quint64 nKey = TTranspositionTable::stateKey(state);
+        if (i < nDepth || (m_pTable->probe(nKey, nDraft, nData, stats) && MAX_PRE_MOVES - nDraft <= nDepth)) {
+            nPruned++;
+            continue;
+        }
+
+        m_pTable->store(nKey, MAX_PRE_MOVES - nDepth, 0, stats);               // before planning, so the other threads skip it at once
+        for (c=0; c<(int)ELEMENTS_OF(crossColors); c++) {
+            if (!state.planSolutionWithCross(crossColors[c], plan, MAX_SOLUTION_MOVES, pCancel)) continue;
+            plan = preMoves + plan;
+            optimizeMoves(plan);
+            int nBest = m_nBest;
+            while (plan.length() < nBest && !m_nBest.compare_exchange_weak(nBest, plan.length()));
+            if (plan.length() >= nBest) continue;
+            *pBest = plan;
+            bFound = true;
+        }
+        nPlanned++;
+        if (pTimer->elapsed() >= nTimeBudget || (pCancel && *pCancel)) break;
+    }
+
+    m_pTable->addStats(stats);
+    m_nPlanned += nPlanned;
+    m_nPruned += nPruned;
+    return bFound;
+}
+
+//---------------------------------------------------------------------------
+QString TParallelSearch::report(void) const
+{
+    return QString("Pre-move search: %1 threads, %2 positions planned, %3 duplicates cut off, table hit rate %4 %, occupancy %5 %")
+            .arg(m_nThreads).arg(m_nPlanned.load()).arg(m_nPruned.load()).arg(100.0 * m_pTable->hitRate(), 0, 'f', 1)
+            .arg(100.0 * m_pTable->occupancy(), 0, 'f', 3);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+QString TBatchResult::report(void) const
+{
+    return QString("Batch: %1/%2 solved on %3 threads in %4 ms, %5 solves/s, latency mean %6 ms p50 %7 ms p99 %8 ms, %9 moves")
+            .arg(nSolved).arg(nCubes).arg(nThreads).arg(fWallTime, 0, 'f', 1).arg(fSolvesPerSecond, 0, 'f', 0)
+            .arg(fMeanLatency, 0, 'f', 3).arg(fP50Latency, 0, 'f', 3).arg(fP99Latency, 0, 'f', 3).arg(fMeanMoves, 0, 'f', 1);
+}
+
+TSolutionCache* TBatchSolver::m_pCache = NULL;
+
+//---------------------------------------------------------------------------
+TBatchSolver::TBatchSolver(SOLVERSTRATEGY nStrategy, int nThreads)
+{
+    m_nStrategy = nStrategy;
+    m_nThreads = nThreads > 0 ? nThreads : QThread::idealThreadCount();
+}
+
+//---------------------------------------------------------------------------
+// Scrambling the cube to a uniformly random state; each seed always gives the same cube, independently of the thread
+//---------------------------------------------------------------------------
+void TBatchSolver::scramble(TCube& cube, quint32 nSeed)
+{
+    TScrambler scrambler(nSeed);
+
+    scrambler.scramble(cube);
+}
+
+//---------------------------------------------------------------------------
+// Solving a single cube of the batch on the calling thread. The colour neutral strategy runs the search with no time,
+// so only the six cross colors are tried, one after another - the batch already uses all cores
+//---------------------------------------------------------------------------
+bool TBatchSolver::planCube(SOLVERSTRATEGY nStrategy, const TCube& cube, QVector<ROTATIONS>& solution)
+{
+    switch (nStrategy) {
+    case STRATEGY_LBL :
+        if (!cube.planSolutionWithCross(WHITE, solution)) return false;
+        optimizeMoves(solution);
+        return true;
+    case STRATEGY_COLOUR_NEUTRAL :
+        return cube.planShorterSolution(solution, MAX_SOLUTION_MOVES+1, 0, NULL);
+    case STRATEGY_PRE_MOVES :
+        return cube.planShorterSolution(solution, MAX_SOLUTION_MOVES+1, RACE_DEADLINE, NULL);
+    case STRATEGIES :
+        break;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------------------------
+// A repeated state (also turned or with other colors) is answered from the cache; a new solution is stored in it
+//---------------------------------------------------------------------------
+bool TBatchSolver::solveCube(SOLVERSTRATEGY nStrategy, const TCube& cube, QVector<ROTATIONS>& solution)
+{
+    TSolutionCache* pCache = m_pCache;
+
+    if (pCache && pCache->find(cube, solution)) return true;
+    if (!planCube(nStrategy, cube, solution)) return false;
+    if (pCache) pCache->insert(cube, solution);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+TBatchResult TBatchSolver::run(int nCubes, const TCube* const* pCubes, const quint32* pSeeds, QVector<ROTATIONS>* pSolutions)
+{
+    QVector<TSlot> cubeSlots(nCubes);
+    std::atomic<int> nNext(0);
+    QThreadPool pool;
+    QVector<QFuture<void>> futures(m_nThreads);
+    QElapsedTimer timer;
+    TBatchResult result;
+    int i;
+
+    pool.setMaxThreadCount(m_nThreads);
+    timer.start();
+    for (i=0; i<m_nThreads; i++) {
+        futures[i] = QtConcurrent::run(&pool, [this, nCubes, pCubes, pSeeds, pSolutions, &cubeSlots, &nNext]() {
+            QVector<ROTATIONS> solutions[BATCH_LANES];                          // the state of the thread, reused for all its cubes
+            TCubeBatch batch;
+            QElapsedTimer latency;
+            int nFirst, nLanes, k;
+
+            while ((nFirst = nNext.fetch_add(BATCH_LANES, std::memory_order_relaxed)) < nCubes) {
+                nLanes = qMin(BATCH_LANES, nCubes - nFirst);
+                batch.reset();
+                for (k=0; k<nLanes; k++) {
+                    TCube cube(NULL);
+                    if (pCubes) cube.copyState(*pCubes[nFirst+k]);
+                    else scramble(cube, pSeeds[nFirst+k]);
+                    batch.setCube(k, cube);
+
+                    latency.start();
+                    cubeSlots[nFirst+k].bSolved = solveCube(m_nStrategy, cube, solutions[k]);
+                    cubeSlots[nFirst+k].nLatency = latency.nsecsElapsed();
+                    if (!cubeSlots[nFirst+k].bSolved) solutions[k].clear();
+                }
+
+                batch.makeMoves(solutions, nLanes);                             // the solutions are verified on all cubes at once
+                LANEMASK nSolved = batch.solvedMask();
+                for (k=0; k<nLanes; k++) {
+                    TSlot& slot = cubeSlots[nFirst+k];
+                    slot.bSolved = slot.bSolved && (nSolved >> k) & 1;
+                    slot.nMoves = slot.bSolved ? solutions[k].length() : 0;
+                    if (pSolutions) {                                           // each cube has its own element, no lock needed
+                        if (slot.bSolved) pSolutions[nFirst+k] = solutions[k];
+                        else pSolutions[nFirst+k].clear();
+                    }
+                }
+            }
+        });
+    }
+    for (i=0; i<m_nThreads; i++) futures[i].waitForFinished();
+
+    result.nCubes = nCubes;
+    result.nThreads = m_nThreads;
+    result.fWallTime = timer.nsecsElapsed() / 1e6;
+    if (nCubes == 0) return result;
+
+    QVector<qint64> latencies(nCubes);
+    qint64 nTotalLatency = 0, nTotalMoves = 0;
+    for (i=0; i<nCubes; i++) {
+        latencies[i] = cubeSlots.at(i).nLatency;
+        nTotalLatency += cubeSlots.at(i).nLatency;
+        if (!cubeSlots.at(i).bSolved) continue;
+        result.nSolved++;
+        nTotalMoves += cubeSlots.at(i).nMoves;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.fSolvesPerSecond = result.nSolved * 1000.0 / qMax(result.fWallTime, 1e-3);
+    result.fMeanLatency = nTotalLatency / 1e6 / nCubes;
+    result.fP50Latency = latencies.at((nCubes-1) / 2) / 1e6;
+    result.fP99Latency = latencies.at((nCubes*99 + 99) / 100 - 1) / 1e6;
+    result.fMeanMoves = result.nSolved ? (double)nTotalMoves / result.nSolved : 0;
+    return result;
+}
+
+//---------------------------------------------------------------------------
+TBatchResult TBatchSolver::solve(const QVector<const TCube*>& cubes, QVector<ROTATIONS>* pSolutions)
+{
+    return run(cubes.length(), cubes.constData(), NULL, pSolutions);
+}
+
+//---------------------------------------------------------------------------
+TBatchResult TBatchSolver::solveSeeds(const QVector<quint32>& seeds)
+{
+    return run(seeds.length(), NULL, seeds.constData(), NULL);
+}
@@ -0,0 +1,145 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QWaitCondition>
+#include <atomic>
+#include "cube.h"
+#include "transposition.h"
+
+class TSolutionCache;
+
+#define RACE_DEADLINE            300                                            // [ms] default time after which the race is stopped
+
+typedef enum {
+    STRATEGY_LBL,                                                               // layer by layer with the white cross
+    STRATEGY_COLOUR_NEUTRAL,                                                    // layer by layer with the best of six cross colors
+    STRATEGY_PRE_MOVES,                                                         // search of pre-move sequences before the colour neutral plans
+    STRATEGIES
+} SOLVERSTRATEGY;
+
+typedef enum {
+    POLICY_FIRST_FINISHED,                                                      // the first strategy which found a solution wins
+    POLICY_SHORTEST,                                                            // the shortest solution found before the deadline wins
+} RACEPOLICY;
+
+class TStrategyResult {
+public:
+    bool bSolved;
+    bool bCancelled;                                                            // the strategy was stopped before it finished
+    int nMoves;
+    qint64 nTime;                                                               // [us]
+    QVector<ROTATIONS> solution;
+    TStrategyResult()                                   { bSolved=false; bCancelled=false; nMoves=0; nTime=0; };
+};
+
+class TRaceResult {                                                             // outcome of a race run in the background
+public:
+    bool bSolved;
+    QVector<ROTATIONS> solution;
+    QString report;
+    TRaceResult()                                       { bSolved=false; };
+};
+
+//---------------------------------------------------------------------------
+// Portfolio solver: all strategies are started at the same time on their own threads and copies of the cube,
+// the policy decides which solution wins and the other strategies are cancelled (they check the cancel flag)
+//---------------------------------------------------------------------------
+class TPortfolioSolver {
+protected:
+    RACEPOLICY m_nPolicy;
+    int m_nDeadline;                                                            // [ms]
+    int m_nWinner;
+    int m_nFirst;                                                               // the first strategy which found a solution
+    int m_nFinished;
+    std::atomic<bool> m_bCancel;
+    QMutex m_Mutex;                                                             // protects the results and the counters above
+    QWaitCondition m_Finished;
+    TStrategyResult m_Results[STRATEGIES];
+
+    static bool runStrategy(SOLVERSTRATEGY nStrategy, const TCube& cube, QVector<ROTATIONS>& solution, int nDeadline, const std::atomic<bool>* pCancel);
+
+public:
+    TPortfolioSolver(RACEPOLICY nPolicy, int nDeadline = RACE_DEADLINE);
+    bool solve(const TCube& cube, QVector<ROTATIONS>& solution);
+    int winner(void) const                                        { return m_nWinner; };
+    const TStrategyResult& result(SOLVERSTRATEGY nStrategy) const { return m_Results[nStrategy]; };
+    QString report(void) const;
+    static QString strategyName(SOLVERSTRATEGY nStrategy);
+    static QString policyName(RACEPOLICY nPolicy);
+};
+
+//---------------------------------------------------------------------------
+// Search of the pre-move sequences (as TCube::planShorterSolution) on many threads. The sequences are taken by an
+// atomic counter, the shorter ones first. The position after each pre-move goes to a transposition table shared by
+// all threads: a sequence which comes to a position reached by a shorter one (R R R and R') is cut off there, and
+// a position reached by more sequences of the same length (R L and L R) is planned only once. The table is taken from
+// the released ones by TTranspositionTable::acquire(), so the next race does not allocate and zero it again
+//---------------------------------------------------------------------------
+class TParallelSearch {
+protected:
+    TTranspositionTable* m_pTable;
+    int m_nThreads;
+    std::atomic<qint64> m_nNext;                                                // the next sequence of the pre-moves
+    std::atomic<int> m_nBest;                                                   // length of the best solution of all threads
+    std::atomic<qint64> m_nPlanned, m_nPruned;
+
+    bool searchThread(const TCube& cube, qint64 nSequences, int nTimeBudget, const QElapsedTimer* pTimer,
+                      const std::atomic<bool>* pCancel, QVector<ROTATIONS>* pBest);   // false if it has no plan
+
+public:
+    TParallelSearch(int nThreads = 0, int nTableBits = TT_DEFAULT_BITS);       // 0 - all cores
+    ~TParallelSearch();
+    bool solve(const TCube& cube, QVector<ROTATIONS>& solution, int nMaxMoves, int nTimeBudget, const std::atomic<bool>* pCancel = NULL);
+    const TTranspositionTable& table(void) const        { return *m_pTable; };
+    QString report(void) const;
+};
+
+class TBatchResult {
+public:
+    int nCubes;
+    int nSolved;                                                                // solved and verified
+    int nThreads;
+    double fWallTime;                                                           // [ms]
+    double fSolvesPerSecond;
+    double fMeanLatency, fP50Latency, fP99Latency;                              // [ms] time of solving a single cube
+    double fMeanMoves;
+    TBatchResult()                                      { nCubes=0; nSolved=0; nThreads=0; fWallTime=0; fSolvesPerSecond=0;
+                                                          fMeanLatency=0; fP50Latency=0; fP99Latency=0; fMeanMoves=0; };
+    QString report(void) const;
+};
+
+//---------------------------------------------------------------------------
+// Batch solving engine: the cubes are solved on a fixed pool of threads, each thread takes the next BATCH_LANES cubes
+// by an atomic counter and writes its results to the cubes' own slots, so there are no locks while solving. The
+// solutions of these cubes are verified together on a TCubeBatch. The statistics are computed when all threads have finished
+//---------------------------------------------------------------------------
+class TBatchSolver {
+protected:
+    class TSlot {
+    public:
+        bool bSolved;
+        int nMoves;
+        qint64 nLatency;                                                        // [ns]
+    };
+
+    SOLVERSTRATEGY m_nStrategy;
+    int m_nThreads;
+    static TSolutionCache* m_pCache;
+
+    static bool planCube(SOLVERSTRATEGY nStrategy, const TCube& cube, QVector<ROTATIONS>& solution);
+
+    TBatchResult run(int nCubes, const TCube* const* pCubes, const quint32* pSeeds, QVector<ROTATIONS>* pSolutions);
+
+public:
+    TBatchSolver(SOLVERSTRATEGY nStrategy = STRATEGY_COLOUR_NEUTRAL, int nThreads = 0);   // 0 - all cores
+    TBatchResult solve(const QVector<const TCube*>& cubes, QVector<ROTATIONS>* pSolutions = NULL);   // a solution per cube, empty if not solved
+    TBatchResult solveSeeds(const QVector<quint32>& seeds);
+    static void scramble(TCube& cube, quint32 nSeed);
+    static bool solveCube(SOLVERSTRATEGY nStrategy, const TCube& cube, QVector<ROTATIONS>& solution);   // the cache is asked first
+    static void setCache(TSolutionCache* pCache)        { m_pCache = pCache; };   // NULL - no cache
+    static TSolutionCache* cache(void)                  { return m_pCache; };
+};
+
+#endif // SOLVER_H
@@ -0,0 +1,197 @@
+#define RC_BUILD_LIBRARY
+#include "solverapi.h"
+#include "algorithm.h"
+#include "cubebatch.h"
+#include "notation.h"
+#include "scrambler.h"
+#include "solutioncache.h"
+#include "solver.h"
+
+static_assert(RC_FACELETS == FACELETS && RC_MAX_MOVES == MAX_SOLUTION_MOVES, "the interface must match the solver");
+static_assert(RC_MOVE_UCCW == ROT_UCCW && RC_COLOR_WHITE == WHITE && RC_STRATEGY_PRE_MOVES == STRATEGY_PRE_MOVES, "the interface must match the solver");
+
+//---------------------------------------------------------------------------
+// The cube and the batch of a handle are created once; the solutions are the vectors of the solver, which the
+// strategies allocate again on every call
+//---------------------------------------------------------------------------
+struct rc_solver {
+    SOLVERSTRATEGY m_nStrategy;
+    TCube m_Cube;
+    TCubeBatch m_Batch;                                                         // checks the solutions of BATCH_LANES cubes at once
+    QVector<ROTATIONS> m_Solutions[BATCH_LANES];
+
+    rc_solver(SOLVERSTRATEGY nStrategy) : m_Cube(NULL)
+    {
+        m_nStrategy = nStrategy;
+    }
+};
+
+//---------------------------------------------------------------------------
+static bool readFacelets(const uint8_t* pFacelets, SIDECOLOR* nColors)          // false if the cube cannot be solved
+{
+    TCubieState state;
+
+    for (int i=0; i<FACELETS; i++) nColors[i] = (SIDECOLOR)pFacelets[i];
+    return TScrambler::stateFromFacelets(nColors, state);
+}
+
+//---------------------------------------------------------------------------
+int rc_version(void)
+{
+    return RC_API_VERSION;
+}
+
+//---------------------------------------------------------------------------
+rc_solver* rc_solver_create(int nStrategy)
+{
+    if (nStrategy < 0 || nStrategy >= STRATEGIES) return NULL;
+    try {
+        return new rc_solver((SOLVERSTRATEGY)nStrategy);
+    }
+    catch (...) {                                                               // no exception may leave the C interface
+        return NULL;
+    }
+}
+
+//---------------------------------------------------------------------------
+void rc_solver_destroy(rc_solver* pSolver)
+{
+    delete pSolver;
+}
+
+//---------------------------------------------------------------------------
+int rc_solve(rc_solver* pSolver, const uint8_t* pFacelets, uint8_t* pMoves, int nMaxMoves, int* pMoveCount)
+{
+    int nStatus;
+
+    return rc_solve_batch(pSolver, 1, pFacelets, pMoves, nMaxMoves, pMoveCount, &nStatus);
+}
+
+//---------------------------------------------------------------------------
+// The cubes are solved one by one in groups of BATCH_LANES; the solutions of a group are checked together on the
+// TCubeBatch before they are copied to the caller. When the buffer is too small, the move count is the needed size
+//---------------------------------------------------------------------------
+int rc_solve_batch(rc_solver* pSolver, int nCount, const uint8_t* pFacelets, uint8_t* pMoves, int nMaxMoves,
+                   int* pMoveCounts, int* pStatuses)
+{
+    SIDECOLOR nColors[FACELETS];
+    int nResult = RC_OK;
+
+    if (!pSolver || nCount < 0 || nMaxMoves < 0 || (nCount && (!pFacelets || !pMoveCounts || !pStatuses)) ||
+        (nCount && nMaxMoves && !pMoves)) return RC_INVALID_ARGUMENT;
+
+    try {
+        for (int nFirst=0; nFirst<nCount; nFirst+=BATCH_LANES) {
+            int nLanes = qMin(nCount - nFirst, BATCH_LANES), i;
+            LANEMASK nPlanned = 0;
+
+            for (i=0; i<nLanes; i++) {
+                QVector<ROTATIONS>& solution = pSolver->m_Solutions[i];
+                solution.resize(0);
+                pMoveCounts[nFirst+i] = 0;
+                pStatuses[nFirst+i] = RC_UNSOLVED;
+                if (!readFacelets(pFacelets + (size_t)(nFirst+i)*RC_FACELETS, nColors)) {
+                    pStatuses[nFirst+i] = RC_INVALID_CUBE;
+                    continue;
+                }
+                pSolver->m_Cube.setFacelets(nColors);
+                pSolver->m_Batch.setFacelets(i, nColors);
+                if (TBatchSolver::solveCube(pSolver->m_nStrategy, pSolver->m_Cube, solution)) nPlanned |= (LANEMASK)1 << i;
+                else solution.resize(0);
+            }
+
+            pSolver->m_Batch.makeMoves(pSolver->m_Solutions, nLanes);
+            LANEMASK nSolved = pSolver->m_Batch.solvedMask() & nPlanned;
+            for (i=0; i<nLanes; i++) {
+                const QVector<ROTATIONS>& solution = pSolver->m_Solutions[i];
+                if (!((nSolved >> i) & 1)) continue;
+                pMoveCounts[nFirst+i] = solution.length();
+                if (solution.length() > nMaxMoves) {
+                    pStatuses[nFirst+i] = RC_BUFFER_TOO_SMALL;
+                    continue;
+                }
+                uint8_t* pCubeMoves = pMoves + (size_t)(nFirst+i)*nMaxMoves;
+                for (int j=0; j<solution.length(); j++) pCubeMoves[j] = (uint8_t)solution.at(j);
+                pStatuses[nFirst+i] = RC_OK;
+            }
+            for (i=0; i<nLanes && nResult == RC_OK; i++) nResult = pStatuses[nFirst+i];
+        }
+    }
+    catch (...) {
+        return RC_INTERNAL_ERROR;
+    }
+    return nResult;
+}
+
+//---------------------------------------------------------------------------
+int rc_cache_open(const char* pFileName)
+{
+    if (!pFileName) return RC_INVALID_ARGUMENT;
+    try {
+        rc_cache_close();
+        TSolutionCache* pCache = new TSolutionCache;
+        if (!pCache->open(QString::fromUtf8(pFileName))) {
+            delete pCache;
+            return RC_INVALID_ARGUMENT;
+        }
+        TBatchSolver::setCache(pCache);
+    }
+    catch (...) {
+        return RC_INTERNAL_ERROR;
+    }
+    return RC_OK;
+}
+
+//---------------------------------------------------------------------------
+void rc_cache_close(void)
+{
+    TSolutionCache* pCache = TBatchSolver::cache();
+
+    TBatchSolver::setCache(NULL);
+    delete pCache;
+}
+
+//---------------------------------------------------------------------------
+int rc_scramble_facelets(const char* pText, size_t nLength, uint8_t* pFacelets)
+{
+    SIDECOLOR nColors[FACELETS];
+
+    if ((!pText && nLength) || !pFacelets) return RC_INVALID_ARGUMENT;
+    try {
+        TCube cube(NULL);
+        if (!TNotation::apply(std::string_view(pText, nLength), cube)) return RC_INVALID_ARGUMENT;
+        cube.getFacelets(nColors);
+    }
+    catch (...) {
+        return RC_INTERNAL_ERROR;
+    }
+    for (int i=0; i<FACELETS; i++) pFacelets[i] = (uint8_t)nColors[i];
+    return RC_OK;
+}
+
+//---------------------------------------------------------------------------
+// The same text as movesToString(), written straight to the buffer of the caller
+//---------------------------------------------------------------------------
+size_t rc_format_moves(const uint8_t* pMoves, int nCount, char* pText, size_t nSize)
+{
+    static const char faces[] = "RRLLFFBBDDUU";
+    char token[4];
+    size_t nLength = 0;
+
+    for (int i=0; i<nCount; i++) {
+        int nToken = 0;
+        if (pMoves[i] > ROT_UCCW) continue;
+        if (nLength) token[nToken++] = ' ';
+        token[nToken++] = faces[pMoves[i]];
+        if (i+1 < nCount && pMoves[i+1] == pMoves[i]) {
+            token[nToken++] = '2';
+            i++;
+        }
+        else if (pMoves[i] & 1) token[nToken++] = '\'';
+        for (int j=0; j<nToken; j++, nLength++) {
+            if (nLength + 1 < nSize) pText[nLength] = token[j];
+        }
+    }
+    if (nSize) pText[qMin(nLength, nSize - 1)] = '\0';
+    return nLength;
+}
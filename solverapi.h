@@ -0,0 +1,102 @@
+#ifndef SOLVERAPI_H
+#define SOLVERAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+// C interface of the solver for programs in other languages (C, Rust, Python ctypes ...). Only plain types cross
+// the interface and all buffers belong to the caller:
+//
+//   facelets - 54 bytes per cube, the colors in the order of the facelets of algorithm.h (side*9 + row*3 + column,
+//              sides R L U D F B) with the values of RC_COLOR_*
+//   moves    - one byte per quarter turn with the values of RC_MOVE_*, a half turn is two equal bytes
+//
+// The handle keeps the cube and the batch which checks the solutions. A solve call still allocates memory: the
+// planners build their move vectors for every cube, and the colour neutral strategy plans the six cross colors
+// as six tasks of the global QThreadPool (the pre-moves strategy starts a thread pool of its own for every cube).
+// A handle may be used by one thread at a time, any number of handles may be used at the same time
+//---------------------------------------------------------------------------
+
+#define RC_API_VERSION           1                                              // changed only when the interface is not compatible
+#define RC_FACELETS              54
+#define RC_MAX_MOVES             1000                                           // longest solution, the same as MAX_SOLUTION_MOVES
+
+#define RC_OK                    0
+#define RC_UNSOLVED              1                                              // no solution was found, or it did not pass the check
+#define RC_INVALID_CUBE          2                                              // not a cube which can be solved (colors, centers, twisted corner, flipped edge ...)
+#define RC_BUFFER_TOO_SMALL      3                                              // the solution is longer than the buffer of the caller
+#define RC_INVALID_ARGUMENT      4
+#define RC_INTERNAL_ERROR        5
+
+#define RC_STRATEGY_LBL              0                                          // values of SOLVERSTRATEGY
+#define RC_STRATEGY_COLOUR_NEUTRAL   1
+#define RC_STRATEGY_PRE_MOVES        2
+
+#define RC_COLOR_RED             0                                              // values of SIDECOLOR
+#define RC_COLOR_GREEN           1
+#define RC_COLOR_BLUE            2
+#define RC_COLOR_ORANGE          4
+#define RC_COLOR_YELLOW          5
+#define RC_COLOR_WHITE           7
+
+#define RC_MOVE_R                0                                              // values of ROTATIONS, the odd ones are counterclockwise
+#define RC_MOVE_RCCW             1
+#define RC_MOVE_L                2
+#define RC_MOVE_LCCW             3
+#define RC_MOVE_F                4
+#define RC_MOVE_FCCW             5
+#define RC_MOVE_B                6
+#define RC_MOVE_BCCW             7
+#define RC_MOVE_D                8
+#define RC_MOVE_DCCW             9
+#define RC_MOVE_U                10
+#define RC_MOVE_UCCW             11
+
+#if defined(_WIN32)
+#  if defined(RC_BUILD_LIBRARY)
+#    define RC_EXPORT            __declspec(dllexport)
+#  else
+#    define RC_EXPORT            __declspec(dllimport)
+#  endif
+#else
+#  define RC_EXPORT              __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rc_solver rc_solver;                                             // opaque handle
+
+RC_EXPORT int rc_version(void);                                                 // RC_API_VERSION of the library
+RC_EXPORT rc_solver* rc_solver_create(int nStrategy);                           // NULL for an unknown strategy
+RC_EXPORT void rc_solver_destroy(rc_solver* pSolver);
+
+// Solving one cube: the moves are written to pMoves (nMaxMoves bytes) and their number to pMoveCount
+RC_EXPORT int rc_solve(rc_solver* pSolver, const uint8_t* pFacelets, uint8_t* pMoves, int nMaxMoves, int* pMoveCount);
+
+// Solving nCount cubes: pFacelets holds nCount*RC_FACELETS bytes, pMoves nCount*nMaxMoves bytes (the moves of the
+// cube i start at i*nMaxMoves), pMoveCounts and pStatuses one int per cube. The result is RC_OK when all cubes
+// were solved, otherwise the first status which is not RC_OK
+RC_EXPORT int rc_solve_batch(rc_solver* pSolver, int nCount, const uint8_t* pFacelets, uint8_t* pMoves, int nMaxMoves,
+                             int* pMoveCounts, int* pStatuses);
+
+// Persistent cache of the solutions (repeated states are answered from it, also when the cube is turned or has
+// other colors). There is one cache in the process, not one per handle: it is used by all handles and by everything
+// else in the process that solves with TBatchSolver. Open and close it when nothing is solving; pFileName is UTF-8
+RC_EXPORT int rc_cache_open(const char* pFileName);
+RC_EXPORT void rc_cache_close(void);
+
+// Facelets of the cube after the moves (the usual notation, e.g. "R U R' F2") from the solved cube
+RC_EXPORT int rc_scramble_facelets(const char* pText, size_t nLength, uint8_t* pFacelets);
+
+// The moves in the usual notation, always terminated by zero; the result is the length of the whole text, so the
+// text was cut when it is not less than nSize
+RC_EXPORT size_t rc_format_moves(const uint8_t* pMoves, int nCount, char* pText, size_t nSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOLVERAPI_H
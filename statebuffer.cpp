@@ -0,0 +1,112 @@
+#include "statebuffer.h"
+
+//---------------------------------------------------------------------------
+TCubeSnapshot::TCubeSnapshot()
+{
+    for (int nAxis=0; nAxis<3; nAxis++) {
+        for (int nSection=0; nSection<cube_size; nSection++) m_nVersion[nAxis][nSection] = 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+void TCubeSnapshot::update(const TCube& cube, const quint64* pVersions)
+{
+    for (int nAxis=0; nAxis<3; nAxis++) {
+        for (int nSection=0; nSection<cube_size; nSection++) {
+            quint64 nVersion = pVersions[nAxis*cube_size + nSection];
+            if (m_nVersion[nAxis][nSection] == nVersion) continue;
+            for (int i=0; i<cube_size; i++) {
+                for (int j=0; j<cube_size; j++) {
+                    int x = nAxis == 0 ? nSection : i;
+                    int y = nAxis == 1 ? nSection : (nAxis == 0 ? i : j);
+                    int z = nAxis == 2 ? nSection : j;
+                    m_Pieces[x][y][z] = *cube.m_pPieces[x][y][z];
+                }
+            }
+            m_nVersion[nAxis][nSection] = nVersion;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+TDrawCount TCubeSnapshot::draw(void) const
+{
+    int nBorders = 0;
+    TDrawCount count;
+
+    for (int x=0; x<cube_size; x++) {
+        for (int y=0; y<cube_size; y++) {
+            for (int z=0; z<cube_size; z++) {
+                nBorders += m_Pieces[x][y][z].draw(x - (cube_size-1)/2.0f, y - (cube_size-1)/2.0f, z - (cube_size-1)/2.0f);
+            }
+        }
+    }
+    count.nDrawCalls = cube_size*cube_size*cube_size + nBorders;
+    count.nVertices = cube_size*cube_size*cube_size*24 + nBorders*4;
+    return count;
+}
+
+//---------------------------------------------------------------------------
+TStateBuffer::TStateBuffer()
+{
+    m_nWrite = 0;
+    m_nPresent = 1;
+    m_nRead = 2;
+    m_nNextVersion = 0;
+    m_nLayout = 0;
+}
+
+//---------------------------------------------------------------------------
+// The sections marked on the cubes since the last state get new versions and the written state copies them. Other
+// cubes or other offsets are a new layout: all their sections are marked, so every piece is copied and uploaded
+//---------------------------------------------------------------------------
+TFrameState& TStateBuffer::write(TCube* const* pCubes, const QVector3D* pOffsets, int nCubes)
+{
+    TFrameState& state = m_States[m_nWrite];
+    bool bLayout = nCubes == m_pCubes.length();
+    quint32 nSections[3];
+
+    for (int i=0; i<nCubes && bLayout; i++) bLayout = pCubes[i] == m_pCubes.at(i) && pOffsets[i] == m_Offsets.at(i);
+    if (!bLayout) {
+        m_pCubes.resize(nCubes);
+        m_Offsets.resize(nCubes);
+        m_nVersions.fill(0, nCubes * 3*cube_size);
+        for (int i=0; i<nCubes; i++) {
+            m_pCubes[i] = pCubes[i];
+            m_Offsets[i] = pOffsets[i];
+            pCubes[i]->markAllSections();
+        }
+        m_nLayout++;
+    }
+
+    state.cubes.resize(nCubes);
+    for (int i=0; i<nCubes; i++) {
+        quint64* pVersions = m_nVersions.data() + i * 3*cube_size;
+        if (pCubes[i]->takeDirtySections(nSections)) {
+            for (int nAxis=0; nAxis<3; nAxis++) {
+                for (int nSection=0; nSection<cube_size; nSection++) {
+                    if ((nSections[nAxis] >> nSection) & 1) pVersions[nAxis*cube_size + nSection] = ++m_nNextVersion;
+                }
+            }
+        }
+        state.cubes[i].update(*pCubes[i], pVersions);
+    }
+    state.offsets = m_Offsets;
+    state.nLayout = m_nLayout;
+    return state;
+}
+
+//---------------------------------------------------------------------------
+void TStateBuffer::publish(void)
+{
+    m_nWrite = m_nPresent.exchange(m_nWrite | STATE_FRESH, std::memory_order_acq_rel) & ~STATE_FRESH;
+}
+
+//---------------------------------------------------------------------------
+const TFrameState& TStateBuffer::take(void)
+{
+    if (m_nPresent.load(std::memory_order_acquire) & STATE_FRESH) {
+        m_nRead = m_nPresent.exchange(m_nRead, std::memory_order_acq_rel) & ~STATE_FRESH;
+    }
+    return m_States[m_nRead];
+}
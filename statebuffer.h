@@ -0,0 +1,66 @@
+#ifndef STATEBUFFER_H
+#define STATEBUFFER_H
+
+#include <QVector>
+#include <QVector3D>
+#include <QMatrix4x4>
+#include <atomic>
+#include "cube.h"
+
+#define STATE_BUFFERS            3                                              // written, published and drawn state
+#define STATE_FRESH              4                                              // flag of m_nPresent: not taken by the render thread yet
+
+//---------------------------------------------------------------------------
+// Copy of what is drawn of a cube: its pieces in their places and a version of each section. A version is given
+// to a section by every change marked on it, so a copy is brought up to date by the sections whose versions differ,
+// and the renderer uploads the same sections, however many states it has not drawn
+//---------------------------------------------------------------------------
+class TCubeSnapshot {
+public:
+    TCubePiece m_Pieces[cube_size][cube_size][cube_size];
+    quint64 m_nVersion[3][cube_size];                                           // 0 - not copied yet
+
+    TCubeSnapshot();
+    void update(const TCube& cube, const quint64* pVersions);                   // the sections of other versions from the cube
+    TDrawCount draw(void) const;                                                // in the immediate mode, as TCube::draw()
+};
+
+class TFrameState {                                                             // everything the render thread needs for a frame
+public:
+    QVector<TCubeSnapshot> cubes;
+    QVector<QVector3D> offsets;                                                 // center of each cube
+    int nLayout;                                                                // changed with the cubes or their offsets
+    QMatrix4x4 mxProjection;
+    QMatrix4x4 mxModel;
+    int nWidth, nHeight;                                                        // [pixels] of the window
+    bool bFrameStats;                                                           // the timing overlay is shown
+    TFrameState()                                       { nLayout = 0; nWidth = 0; nHeight = 0; bFrameStats = false; };
+};
+
+//---------------------------------------------------------------------------
+// Lock-free triple buffer of the frame states between the GUI thread, which owns the cubes, and the render thread.
+// The GUI thread writes its own state and publishes it by one atomic exchange with the present one; the render
+// thread takes the present state by another exchange. Neither thread ever waits for the other: a state published
+// twice before it is drawn is simply replaced, and the render thread always draws a whole state of every cube,
+// never a move applied only in part
+//---------------------------------------------------------------------------
+class TStateBuffer {
+protected:
+    TFrameState m_States[STATE_BUFFERS];
+    std::atomic<int> m_nPresent;                                                // the latest published state | STATE_FRESH
+    int m_nWrite;                                                               // owned by the GUI thread
+    int m_nRead;                                                                // owned by the render thread
+    QVector<const TCube*> m_pCubes;                                             // the cubes of the last written state
+    QVector<QVector3D> m_Offsets;
+    QVector<quint64> m_nVersions;                                               // of each section of each cube, 3*cube_size per cube
+    quint64 m_nNextVersion;                                                     // 64 bits never wrap
+    int m_nLayout;
+
+public:
+    TStateBuffer();
+    TFrameState& write(TCube* const* pCubes, const QVector3D* pOffsets, int nCubes);   // GUI thread, before publish()
+    void publish(void);
+    const TFrameState& take(void);                                              // render thread, the latest published state
+};
+
+#endif // STATEBUFFER_H
@@ -0,0 +1,211 @@
+#include "transposition.h"
+#include "algorithm.h"
+
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QMutex>
+
+#define TT_DRAFT(nSlot)          ((int)(((nSlot) >> 16) & 0xFF))
+#define TT_DATA(nSlot)           ((int)((nSlot) & 0xFFFF))
+
+class TFreeTables {                                                             // released by the finished searches
+public:
+    QMutex mutex;
+    QVector<TTranspositionTable*> tables;
+    ~TFreeTables()                                      { for (int i=0; i<tables.length(); i++) delete tables.at(i); };
+};
+
+static TFreeTables g_FreeTables;
+
+//---------------------------------------------------------------------------
+TTranspositionTable::TTranspositionTable(int nBits)
+{
+    m_nBits = qBound(4, nBits, 30);
+    m_nMask = (1ULL << m_nBits) - 1;
+    m_pLines = new TTranspositionLine[(m_nMask + 1) / TT_LINE_SLOTS];
+    m_nGeneration = TT_GENERATIONS - 1;                                         // the first clear() zeroes the slots
+    clear();
+}
+
+//---------------------------------------------------------------------------
+TTranspositionTable::~TTranspositionTable()
+{
+    delete[] m_pLines;
+}
+
+//---------------------------------------------------------------------------
+// Only a new generation is started, the slots are zeroed when the generations run out
+//---------------------------------------------------------------------------
+void TTranspositionTable::clear(void)
+{
+    if (++m_nGeneration == TT_GENERATIONS) {
+        for (quint64 i=0; i<=m_nMask; i++) m_pLines[i / TT_LINE_SLOTS].nSlots[i % TT_LINE_SLOTS].store(0, std::memory_order_relaxed);
+        m_nGeneration = 1;
+    }
+    m_nProbes = 0;
+    m_nHits = 0;
+    m_nStores = 0;
+}
+
+//---------------------------------------------------------------------------
+// A released table of the same size is cleared and given again, so a search does not allocate and zero its table
+//---------------------------------------------------------------------------
+TTranspositionTable* TTranspositionTable::acquire(int nBits)
+{
+    TTranspositionTable* pTable = NULL;
+
+    nBits = qBound(4, nBits, 30);
+    g_FreeTables.mutex.lock();
+    for (int i=0; i<g_FreeTables.tables.length(); i++) {
+        if (g_FreeTables.tables.at(i)->m_nBits != nBits) continue;
+        pTable = g_FreeTables.tables.takeAt(i);
+        break;
+    }
+    g_FreeTables.mutex.unlock();
+
+    if (!pTable) return new TTranspositionTable(nBits);
+    pTable->clear();
+    return pTable;
+}
+
+//---------------------------------------------------------------------------
+void TTranspositionTable::release(TTranspositionTable* pTable)
+{
+    QMutexLocker locker(&g_FreeTables.mutex);
+
+    g_FreeTables.tables.append(pTable);
+}
+
+//---------------------------------------------------------------------------
+bool TTranspositionTable::probe(quint64 nKey, int& nDraft, int& nData, TTranspositionStats& stats) const
+{
+    const std::atomic<quint64>* pBucket = bucket(nKey);
+    quint64 nTag = tag(nKey);
+
+    stats.nProbes++;
+    for (int i=0; i<TT_BUCKET; i++) {
+        quint64 nSlot = pBucket[i].load(std::memory_order_acquire);
+        if ((nSlot & ~TT_VALUE_MASK) != nTag) continue;
+        nDraft = TT_DRAFT(nSlot);
+        nData = TT_DATA(nSlot);
+        stats.nHits++;
+        return true;
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------
+// First the slot which already has the key is updated (only by a greater draft), then an empty slot is taken and
+// at last the shallowest entry of the bucket is replaced; a slot of an older generation is empty. A failed compare-and-swap
+// means that another thread changed the slot: the new value is checked again, or the entry is not stored
+//---------------------------------------------------------------------------
+bool TTranspositionTable::store(quint64 nKey, int nDraft, int nData, TTranspositionStats& stats)
+{
+    std::atomic<quint64>* pBucket = bucket(nKey);
+    quint64 nTag = tag(nKey);
+    quint64 nNew = nTag | ((quint64)(nDraft & 0xFF) << 16) | (quint64)(nData & 0xFFFF);
+    quint64 nVictim = 0;
+    int i, nVictimSlot = -1;
+
+    for (i=0; i<TT_BUCKET; i++) {
+        quint64 nSlot = pBucket[i].load(std::memory_order_acquire);
+        while ((nSlot & ~TT_VALUE_MASK) == nTag) {
+            if (TT_DRAFT(nSlot) >= nDraft) return false;                        // the position is already known as deep
+            if (pBucket[i].compare_exchange_weak(nSlot, nNew, std::memory_order_acq_rel)) {
+                stats.nStores++;
+                return true;
+            }
+        }
+    }
+
+    for (i=0; i<TT_BUCKET; i++) {
+        quint64 nSlot = pBucket[i].load(std::memory_order_acquire);
+        if (!isUsed(nSlot) && pBucket[i].compare_exchange_strong(nSlot, nNew, std::memory_order_acq_rel)) {
+            stats.nStores++;
+            return true;
+        }
+        if (nVictimSlot < 0 || TT_DRAFT(nSlot) < TT_DRAFT(nVictim)) {          // nSlot is the present value of the slot
+            nVictimSlot = i;
+            nVictim = nSlot;
+        }
+    }
+
+    if (TT_DRAFT(nVictim) > nDraft) return false;                               // all entries of the bucket are deeper
+    if (!pBucket[nVictimSlot].compare_exchange_strong(nVictim, nNew, std::memory_order_acq_rel)) return false;
+    stats.nStores++;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void TTranspositionTable::addStats(const TTranspositionStats& stats)
+{
+    m_nProbes += stats.nProbes;
+    m_nHits += stats.nHits;
+    m_nStores += stats.nStores;
+}
+
+//---------------------------------------------------------------------------
+double TTranspositionTable::occupancy(void) const
+{
+    quint64 nUsed = 0;
+
+    for (quint64 i=0; i<=m_nMask; i++) nUsed += isUsed(m_pLines[i / TT_LINE_SLOTS].nSlots[i % TT_LINE_SLOTS].load(std::memory_order_relaxed));
+    return (double)nUsed / (m_nMask + 1);
+}
+
+//---------------------------------------------------------------------------
+quint64 TTranspositionTable::stateKey(const TCube& cube)
+{
+    SIDECOLOR nColors[FACELETS];
+    quint64 nKey = 0xCBF29CE484222325ULL;                                       // FNV-1a, mixed as in TCanonicalState
+
+    cube.getFacelets(nColors);
+    for (int i=0; i<FACELETS; i++) nKey = (nKey ^ nColors[i]) * 0x100000001B3ULL;
+    nKey ^= nKey >> 31;
+    nKey *= 0x9E3779B97F4A7C15ULL;
+    nKey ^= nKey >> 29;
+    return nKey;
+}
+
+//---------------------------------------------------------------------------
+// The same work on 1, 2, 4 ... nMaxThreads threads: every thread probes keys from a set a bit smaller than the
+// table and stores the missing ones, as a search would. Without a lock the operations per second grow with the threads
+//---------------------------------------------------------------------------
+QString TTranspositionTable::benchmark(int nMaxThreads)
+{
+    const int nBits = 22, nOperations = 1 << 21;
+    QString report;
+
+    for (int nThreads=1; ; nThreads=qMin(2*nThreads, nMaxThreads)) {
+        TTranspositionTable table(nBits);
+        QThreadPool pool;
+        QVector<QFuture<void>> futures;
+        QElapsedTimer timer;
+
+        pool.setMaxThreadCount(nThreads);
+        timer.start();
+        for (int t=0; t<nThreads; t++) {
+            TTranspositionTable* pTable = &table;
+            futures.append(QtConcurrent::run(&pool, [pTable, t]() {
+                TTranspositionStats stats;
+                quint64 x = 0x9E3779B97F4A7C15ULL * (t + 1);
+                int nDraft, nData;
+                for (int i=0; i<nOperations; i++) {
+                    x ^= x << 13; x ^= x >> 7; x ^= x << 17;                    // xorshift, the keys of this thread
+                    quint64 nKey = (x % (3ULL << (nBits - 2))) * 0xD6E8FEB86659FD93ULL;
+                    if (!pTable->probe(nKey, nDraft, nData, stats)) pTable->store(nKey, (int)(x >> 60), i, stats);
+                }
+                pTable->addStats(stats);
+            }));
+        }
+        for (int t=0; t<nThreads; t++) futures[t].waitForFinished();
+
+        double fTime = timer.nsecsElapsed() / 1e9;
+        report += QString("Table: %1 threads, %2 M operations/s, hit rate %3 %, occupancy %4 %\n")
+                  .arg(nThreads).arg(table.probes() / fTime / 1e6, 0, 'f', 1)
+                  .arg(100.0 * table.hitRate(), 0, 'f', 1).arg(100.0 * table.occupancy(), 0, 'f', 1);
+        if (nThreads >= nMaxThreads) break;
+    }
+    return report;
+}
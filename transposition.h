@@ -0,0 +1,68 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <QString>
+#include <atomic>
+#include "cube.h"
+
+#define TT_DEFAULT_BITS          20                                             // 2^20 slots, 8 MB
+#define TT_BUCKET                4                                              // slots probed for one key, 32 bytes of one cache line
+#define TT_VALUE_BITS            24                                             // the slot: key tag (32 bits) | generation (8) | draft (8) | data (16)
+#define TT_VALUE_MASK            ((1ULL << TT_VALUE_BITS) - 1)
+#define TT_TAG_MASK              0xFFFFFFFF00000000ULL                          // bits of the key kept in the slot
+#define TT_GENERATIONS           256                                            // clear() counts them, the slots are zeroed once per round
+#define TT_LINE_SLOTS            8                                              // 64 bytes, two buckets in a cache line
+
+class TTranspositionStats {                                                     // counted by each thread, added to the table at the end
+public:
+    qint64 nProbes;
+    qint64 nHits;
+    qint64 nStores;
+    TTranspositionStats()                               { nProbes=0; nHits=0; nStores=0; };
+};
+
+class alignas(8 * TT_LINE_SLOTS) TTranspositionLine {                           // new[] aligns it, so no bucket crosses a cache line
+public:
+    std::atomic<quint64> nSlots[TT_LINE_SLOTS];
+};
+
+//---------------------------------------------------------------------------
+// Fixed-size hash table shared by the search threads without any lock. Each slot is one 64-bit word holding the tag
+// of the key and the value, so it is always read and written whole and changed only by compare-and-swap. A key may
+// be in any slot of its bucket (open addressing); when the bucket is full, the entry with the smallest draft (the
+// remaining search depth) is replaced, but only by an entry with the same or a greater draft. A lost race or a
+// replaced entry only means that a position is searched again, so the table never has to wait.
+// Each slot holds the generation of the table it was stored in: clear() only starts a new generation and the slots
+// of the older ones are empty, so a table taken again by acquire() is ready for the next search at once
+//---------------------------------------------------------------------------
+class TTranspositionTable {
+protected:
+    TTranspositionLine* m_pLines;
+    quint64 m_nMask;                                                            // number of slots - 1
+    int m_nBits;
+    quint64 m_nGeneration;                                                      // 1 .. TT_GENERATIONS-1, so no used slot is zero
+    std::atomic<qint64> m_nProbes, m_nHits, m_nStores;
+
+    std::atomic<quint64>* bucket(quint64 nKey) const    { quint64 n = nKey & m_nMask & ~(quint64)(TT_BUCKET-1);
+                                                          return m_pLines[n / TT_LINE_SLOTS].nSlots + n % TT_LINE_SLOTS; };
+    quint64 tag(quint64 nKey) const                     { return (nKey & TT_TAG_MASK) | (m_nGeneration << TT_VALUE_BITS); };
+    bool isUsed(quint64 nSlot) const                    { return ((nSlot >> TT_VALUE_BITS) & (TT_GENERATIONS-1)) == m_nGeneration; };
+
+public:
+    TTranspositionTable(int nBits = TT_DEFAULT_BITS);
+    ~TTranspositionTable();
+    void clear(void);                                                           // only when no thread uses the table
+    static TTranspositionTable* acquire(int nBits = TT_DEFAULT_BITS);           // a cleared table, reused if one was released
+    static void release(TTranspositionTable* pTable);
+    bool probe(quint64 nKey, int& nDraft, int& nData, TTranspositionStats& stats) const;
+    bool store(quint64 nKey, int nDraft, int nData, TTranspositionStats& stats);   // false if a deeper or equal entry was there
+    void addStats(const TTranspositionStats& stats);
+    qint64 size(void) const                             { return m_nMask + 1; };
+    double occupancy(void) const;                                               // used slots / all slots
+    double hitRate(void) const                          { return m_nProbes ? (double)m_nHits / m_nProbes : 0.0; };
+    qint64 probes(void) const                           { return m_nProbes; };
+    static quint64 stateKey(const TCube& cube);                                 // hash of the facelets
+    static QString benchmark(int nMaxThreads);                                  // probes and stores from 1 .. nMaxThreads threads
+};
+
+#endif // TRANSPOSITION_H